@@ -111,7 +111,7 @@ struct _EggTimelinePrivate
 
   gint skipped_frames;
 
-  GTimeVal prev_frame_timeval;
+  gint64 prev_frame_time; /* monotonic, 0 while not running */
   guint  msecs_delta;
 
   GHashTable *markers_by_frame;
@@ -584,7 +584,7 @@ timeline_timeout_func (gpointer data)
 {
   EggTimeline        *timeline = data;
   EggTimelinePrivate *priv;
-  GTimeVal                timeval;
+  gint64                  now;
   guint                   n_frames;
   gulong                  msecs;
 
@@ -593,24 +593,23 @@ timeline_timeout_func (gpointer data)
   g_object_ref (timeline);
 
   /* Figure out potential frame skips */
-  g_get_current_time (&timeval);
+  now = g_get_monotonic_time ();
 
   EGG_TIMESTAMP (SCHEDULER, "Timeline [%p] activated (cur: %d)\n",
                      timeline,
                      priv->current_frame_num);
 
-  if (!priv->prev_frame_timeval.tv_sec)
+  if (!priv->prev_frame_time)
     {
       EGG_NOTE (SCHEDULER,
                     "Timeline [%p] recieved timeout before being initialised!",
                     timeline);
-      priv->prev_frame_timeval = timeval;
+      priv->prev_frame_time = now;
     }
 
-  /* Interpolate the current frame based on the timeval of the
+  /* Interpolate the current frame based on the time of the
    * previous frame */
-  msecs = (timeval.tv_sec - priv->prev_frame_timeval.tv_sec) * 1000;
-  msecs += (timeval.tv_usec - priv->prev_frame_timeval.tv_usec) / 1000;
+  msecs = (now - priv->prev_frame_time) / 1000;
   priv->msecs_delta = msecs;
   n_frames = msecs / (1000 / priv->fps);
   if (n_frames == 0)
@@ -624,7 +623,7 @@ timeline_timeout_func (gpointer data)
                        timeline,
                        priv->skipped_frames);
 
-  priv->prev_frame_timeval = timeval;
+  priv->prev_frame_time = now;
 
   /* Advance frames */
   if (priv->direction == EGG_TIMELINE_FORWARD)
@@ -762,8 +761,7 @@ timeline_timeout_func (gpointer data)
         {
           egg_timeline_rewind (timeline);
 
-          priv->prev_frame_timeval.tv_sec = 0;
-          priv->prev_frame_timeval.tv_usec = 0;
+          priv->prev_frame_time = 0;
 
           g_object_unref (timeline);
           return FALSE;
@@ -779,15 +777,11 @@ timeline_timeout_add (EggTimeline *timeline,
                       GDestroyNotify notify)
 {
   EggTimelinePrivate *priv;
-  GTimeVal timeval;
 
   priv = timeline->priv;
 
-  if (priv->prev_frame_timeval.tv_sec == 0)
-    {
-      g_get_current_time (&timeval);
-      priv->prev_frame_timeval = timeval;
-    }
+  if (priv->prev_frame_time == 0)
+    priv->prev_frame_time = g_get_monotonic_time ();
   priv->skipped_frames   = 0;
   priv->msecs_delta      = 0;
 
@@ -877,8 +871,7 @@ egg_timeline_pause (EggTimeline *timeline)
       priv->timeout_id = 0;
     }
 
-  priv->prev_frame_timeval.tv_sec = 0;
-  priv->prev_frame_timeval.tv_usec = 0;
+  priv->prev_frame_time = 0;
 
   g_signal_emit (timeline, timeline_signals[PAUSED], 0);
 }
@@ -39,8 +39,8 @@
 
 typedef struct _EggTimeout  EggTimeout;
 typedef enum {
-  EGG_TIMEOUT_NONE   = 0,
-  EGG_TIMEOUT_READY  = 1 << 1
+  EGG_TIMEOUT_NONE    = 0,
+  EGG_TIMEOUT_REMOVED = 1 << 1
 } EggTimeoutFlags;
 
 struct _EggTimeout
@@ -49,8 +49,12 @@ struct _EggTimeout
   EggTimeoutFlags flags;
   gint refcount;
 
-  guint interval;
-  guint last_time;
+  /* position inside the heap, -1 while being dispatched */
+  gint slot;
+
+  /* both in microseconds, relative to the creation of the pool */
+  gint64 interval;
+  gint64 last_time;
 
   GSourceFunc func;
   gpointer data;
@@ -63,14 +67,23 @@ struct _EggTimeoutPool
 
   guint next_id;
 
-  GTimeVal start_time;
-  GList *timeouts, *dispatched_timeouts;
-  gint ready;
+  gint64 start_time;
+
+  /* binary min-heap of EggTimeout, ordered by expiration */
+  GPtrArray *heap;
+
+  /* id -> EggTimeout, holds the reference of the pool */
+  GHashTable *index;
+
+  /* timeouts taken off the heap for the running dispatch */
+  GPtrArray *dispatched;
 
   guint id;
 };
 
-#define TIMEOUT_READY(timeout)   (timeout->flags & EGG_TIMEOUT_READY)
+#define TIMEOUT_REMOVED(timeout)     (timeout->flags & EGG_TIMEOUT_REMOVED)
+#define TIMEOUT_EXPIRATION(timeout)  (timeout->last_time + timeout->interval)
+#define HEAP_AT(pool, i)             ((EggTimeout *) g_ptr_array_index (pool->heap, i))
 
 static gboolean egg_timeout_pool_prepare  (GSource     *source,
                                                gint        *next_timeout);
@@ -88,51 +101,112 @@ static GSourceFuncs egg_timeout_pool_funcs =
   egg_timeout_pool_finalize
 };
 
-static gint
-egg_timeout_sort (gconstpointer a,
-                      gconstpointer b)
+/* earlier expiration first, timeouts expiring at the same time are run
+ * in the order they were added */
+static gboolean
+egg_timeout_before (const EggTimeout *t_a,
+                    const EggTimeout *t_b)
+{
+  gint64 comparison;
+
+  comparison = TIMEOUT_EXPIRATION (t_a) - TIMEOUT_EXPIRATION (t_b);
+  if (comparison != 0)
+    return comparison < 0;
+
+  return t_a->id < t_b->id;
+}
+
+static void
+egg_timeout_heap_set (EggTimeoutPool *pool,
+                      gint            slot,
+                      EggTimeout     *timeout)
 {
-  const EggTimeout *t_a = a;
-  const EggTimeout *t_b = b;
-  gint comparison;
+  g_ptr_array_index (pool->heap, slot) = timeout;
+  timeout->slot = slot;
+}
 
-  /* Keep 'ready' timeouts at the front */
-  if (TIMEOUT_READY (t_a))
-    return -1;
+static void
+egg_timeout_heap_sift_up (EggTimeoutPool *pool,
+                          gint            slot)
+{
+  EggTimeout *timeout = HEAP_AT (pool, slot);
 
-  if (TIMEOUT_READY (t_b))
-    return 1;
+  while (slot > 0)
+    {
+      gint parent = (slot - 1) / 2;
 
-  /* Otherwise sort by expiration time */
-  comparison = (t_a->last_time + t_a->interval)
-    - (t_b->last_time + t_b->interval);
-  if (comparison < 0)
-    return -1;
+      if (!egg_timeout_before (timeout, HEAP_AT (pool, parent)))
+        break;
 
-  if (comparison > 0)
-    return 1;
+      egg_timeout_heap_set (pool, slot, HEAP_AT (pool, parent));
+      slot = parent;
+    }
 
-  return 0;
+  egg_timeout_heap_set (pool, slot, timeout);
 }
 
-static gint
-egg_timeout_find_by_id (gconstpointer a,
-                            gconstpointer b)
+static void
+egg_timeout_heap_sift_down (EggTimeoutPool *pool,
+                            gint            slot)
 {
-  const EggTimeout *t_a = a;
+  EggTimeout *timeout = HEAP_AT (pool, slot);
+  gint len = pool->heap->len;
+
+  for (;;)
+    {
+      gint child = 2 * slot + 1;
 
-  return t_a->id == GPOINTER_TO_UINT (b) ? 0 : 1;
+      if (child >= len)
+        break;
+
+      if (child + 1 < len &&
+          egg_timeout_before (HEAP_AT (pool, child + 1),
+                              HEAP_AT (pool, child)))
+        child++;
+
+      if (!egg_timeout_before (HEAP_AT (pool, child), timeout))
+        break;
+
+      egg_timeout_heap_set (pool, slot, HEAP_AT (pool, child));
+      slot = child;
+    }
+
+  egg_timeout_heap_set (pool, slot, timeout);
 }
 
-static guint
-egg_timeout_pool_get_ticks (EggTimeoutPool *pool)
+static void
+egg_timeout_heap_push (EggTimeoutPool *pool,
+                       EggTimeout     *timeout)
 {
-  GTimeVal time_now;
+  g_ptr_array_add (pool->heap, timeout);
+  egg_timeout_heap_sift_up (pool, pool->heap->len - 1);
+}
 
-  g_source_get_current_time ((GSource *) pool, &time_now);
-  
-  return (time_now.tv_sec - pool->start_time.tv_sec) * 1000
-    + (time_now.tv_usec - pool->start_time.tv_usec) / 1000;
+/* takes the timeout at slot off the heap, in O(log n) */
+static EggTimeout *
+egg_timeout_heap_remove (EggTimeoutPool *pool,
+                         gint            slot)
+{
+  EggTimeout *timeout = HEAP_AT (pool, slot);
+  EggTimeout *last;
+
+  last = g_ptr_array_remove_index_fast (pool->heap, pool->heap->len - 1);
+  if (last != timeout)
+    {
+      egg_timeout_heap_set (pool, slot, last);
+      egg_timeout_heap_sift_up (pool, slot);
+      egg_timeout_heap_sift_down (pool, last->slot);
+    }
+
+  timeout->slot = -1;
+
+  return timeout;
+}
+
+static gint64
+egg_timeout_pool_get_ticks (EggTimeoutPool *pool)
+{
+  return g_source_get_time ((GSource *) pool) - pool->start_time;
 }
 
 static gboolean
@@ -140,20 +214,10 @@ egg_timeout_prepare (EggTimeoutPool *pool,
                          EggTimeout     *timeout,
                          gint               *next_timeout)
 {
-  guint now = egg_timeout_pool_get_ticks (pool);
+  gint64 now = egg_timeout_pool_get_ticks (pool);
+  gint64 remaining = TIMEOUT_EXPIRATION (timeout) - now;
 
-  /* If time has gone backwards or the time since the last frame is
-     greater than the two frames worth then reset the time and do a
-     frame now */
-  if (timeout->last_time > now || now - timeout->last_time
-      > timeout->interval * 2)
-    {
-      timeout->last_time = now - timeout->interval;
-      if (next_timeout)
-	*next_timeout = 0;
-      return TRUE;
-    }
-  else if (now - timeout->last_time >= timeout->interval)
+  if (remaining <= 0)
     {
       if (next_timeout)
 	*next_timeout = 0;
@@ -161,8 +225,9 @@ egg_timeout_prepare (EggTimeoutPool *pool,
     }
   else
     {
+      /* round up, waking up early would only cost another iteration */
       if (next_timeout)
-	*next_timeout = timeout->interval + timeout->last_time - now;
+	*next_timeout = (gint) MIN ((remaining + 999) / 1000, G_MAXINT);
       return FALSE;
     }
 }
@@ -171,6 +236,8 @@ static gboolean
 egg_timeout_dispatch (GSource        *source,
                           EggTimeout *timeout)
 {
+  EggTimeoutPool *pool = (EggTimeoutPool *) source;
+  gint64 now = egg_timeout_pool_get_ticks (pool);
   gboolean retval = FALSE;
 
   if (G_UNLIKELY (!timeout->func))
@@ -179,6 +246,11 @@ egg_timeout_dispatch (GSource        *source,
       return FALSE;
     }
 
+  /* If the time since the last frame is greater than two frames worth
+     then reset the time and do a frame now */
+  if (now - timeout->last_time > timeout->interval * 2)
+    timeout->last_time = now - timeout->interval;
+
   if (timeout->func (timeout->data))
     {
       timeout->last_time += timeout->interval;
@@ -195,9 +267,10 @@ egg_timeout_new (guint interval)
   EggTimeout *timeout;
 
   timeout = g_slice_new0 (EggTimeout);
-  timeout->interval = interval;
+  timeout->interval = (gint64) interval * 1000;
   timeout->flags = EGG_TIMEOUT_NONE;
   timeout->refcount = 1;
+  timeout->slot = -1;
 
   return timeout;
 }
@@ -251,14 +324,10 @@ egg_timeout_pool_prepare (GSource *source,
                               gint    *next_timeout)
 {
   EggTimeoutPool *pool = (EggTimeoutPool *) source;
-  GList *l = pool->timeouts;
 
   /* the pool is ready if the first timeout is ready */
-  if (l && l->data)
-    {
-      EggTimeout *timeout = l->data;
-      return egg_timeout_prepare (pool, timeout, next_timeout);
-    }
+  if (pool->heap->len)
+    return egg_timeout_prepare (pool, HEAP_AT (pool, 0), next_timeout);
   else
     {
       *next_timeout = -1;
@@ -270,31 +339,16 @@ static gboolean
 egg_timeout_pool_check (GSource *source)
 {
   EggTimeoutPool *pool = (EggTimeoutPool *) source;
-  GList *l = pool->timeouts;
+  gboolean retval;
 
   egg_threads_enter ();
 
-  for (l = pool->timeouts; l; l = l->next)
-    {
-      EggTimeout *timeout = l->data;
-
-      /* since the timeouts are sorted by expiration, as soon
-       * as we get a check returning FALSE we know that the
-       * following timeouts are not expiring, so we break as
-       * soon as possible
-       */
-      if (egg_timeout_prepare (pool, timeout, NULL))
-        {
-          timeout->flags |= EGG_TIMEOUT_READY;
-          pool->ready += 1;
-        }
-      else
-        break;
-    }
+  retval = pool->heap->len &&
+           egg_timeout_prepare (pool, HEAP_AT (pool, 0), NULL);
 
   egg_threads_leave ();
 
-  return (pool->ready > 0);
+  return retval;
 }
 
 static gboolean
@@ -303,93 +357,53 @@ egg_timeout_pool_dispatch (GSource     *source,
                                gpointer     data)
 {
   EggTimeoutPool *pool = (EggTimeoutPool *) source;
-  GList *dispatched_timeouts;
-
-  /* the main loop might have predicted this, so we repeat the
-   * check for ready timeouts.
-   */
-  if (!pool->ready)
-    egg_timeout_pool_check (source);
+  guint i;
 
   egg_threads_enter ();
 
-  /* Iterate by moving the actual start of the list along so that it
-   * can cope with adds and removes while a timeout is being dispatched
+  /* Take every expired timeout off the heap first, so that timeouts
+   * added while dispatching, or ones re-inserted with their next
+   * expiration, don't get run twice in the same iteration
    */
-  while (pool->timeouts && pool->timeouts->data && pool->ready-- > 0)
+  while (pool->heap->len &&
+         egg_timeout_prepare (pool, HEAP_AT (pool, 0), NULL))
     {
-      EggTimeout *timeout = pool->timeouts->data;
-      GList *l;
-
-      /* One of the ready timeouts may have been removed during dispatch,
-       * in which case pool->ready will be wrong, but the ready timeouts
-       * are always kept at the start of the list so we can stop once
-       * we've reached the first non-ready timeout
-       */
-      if (!(TIMEOUT_READY (timeout)))
-	break;
+      EggTimeout *timeout = egg_timeout_heap_remove (pool, 0);
 
       /* Add a reference to the timeout so it can't disappear
        * while it's being dispatched
        */
-      egg_timeout_ref (timeout);
-
-      timeout->flags &= ~EGG_TIMEOUT_READY;
-
-      /* Move the list node to a list of dispatched timeouts */
-      l = pool->timeouts;
-      if (l->next)
-	l->next->prev = NULL;
-
-      pool->timeouts = l->next;
-
-      if (pool->dispatched_timeouts)
-	pool->dispatched_timeouts->prev = l;
-
-      l->prev = NULL;
-      l->next = pool->dispatched_timeouts;
-      pool->dispatched_timeouts = l;
-
-      if (!egg_timeout_dispatch (source, timeout))
-	{
-	  /* The timeout may have already been removed, but nothing
-           * can be added to the dispatched_timeout list except in this
-           * function so it will always either be at the head of the
-           * dispatched list or have been removed
-           */
-          if (pool->dispatched_timeouts &&
-              pool->dispatched_timeouts->data == timeout)
-	    {
-	      pool->dispatched_timeouts =
-                g_list_delete_link (pool->dispatched_timeouts,
-                                    pool->dispatched_timeouts);
-
-	      /* Remove the reference that was held by it being in the list */
-	      egg_timeout_unref (timeout);
-	    }
-	}
-
-      egg_timeout_unref (timeout);
+      g_ptr_array_add (pool->dispatched, egg_timeout_ref (timeout));
     }
 
-  /* Re-insert the dispatched timeouts in sorted order */
-  dispatched_timeouts = pool->dispatched_timeouts;
-  while (dispatched_timeouts)
+  for (i = 0; i < pool->dispatched->len; i++)
     {
-      EggTimeout *timeout = dispatched_timeouts->data;
-      GList *next = dispatched_timeouts->next;
+      EggTimeout *timeout = g_ptr_array_index (pool->dispatched, i);
 
-      if (timeout)
-        pool->timeouts = g_list_insert_sorted (pool->timeouts, timeout,
-                                               egg_timeout_sort);
+      /* removed by one of the timeouts dispatched before it */
+      if (TIMEOUT_REMOVED (timeout))
+        continue;
 
-      dispatched_timeouts = next;
+      if (egg_timeout_dispatch (source, timeout))
+        {
+          /* it may have removed itself and still returned TRUE */
+          if (!TIMEOUT_REMOVED (timeout))
+            egg_timeout_heap_push (pool, timeout);
+        }
+      else if (!TIMEOUT_REMOVED (timeout))
+        {
+          timeout->flags |= EGG_TIMEOUT_REMOVED;
+
+          /* Remove the reference that was held by it being in the pool */
+          g_hash_table_remove (pool->index, GUINT_TO_POINTER (timeout->id));
+          egg_timeout_unref (timeout);
+        }
     }
 
-  g_list_free (pool->dispatched_timeouts);
-  pool->dispatched_timeouts = NULL;
+  for (i = 0; i < pool->dispatched->len; i++)
+    egg_timeout_unref (g_ptr_array_index (pool->dispatched, i));
 
-  pool->ready = 0;
+  g_ptr_array_set_size (pool->dispatched, 0);
 
   egg_threads_leave ();
 
@@ -402,8 +416,10 @@ egg_timeout_pool_finalize (GSource *source)
   EggTimeoutPool *pool = (EggTimeoutPool *) source;
 
   /* force destruction */
-  g_list_foreach (pool->timeouts, (GFunc) egg_timeout_free, NULL);
-  g_list_free (pool->timeouts);
+  g_ptr_array_foreach (pool->heap, (GFunc) egg_timeout_free, NULL);
+  g_ptr_array_free (pool->heap, TRUE);
+  g_ptr_array_free (pool->dispatched, TRUE);
+  g_hash_table_destroy (pool->index);
 }
 
 /**
@@ -415,9 +431,11 @@ egg_timeout_pool_finalize (GSource *source)
  * multiple timeout functions, running at the same priority, are needed and
  * the g_timeout_add() API might lead to starvation of the time slice of
  * the main loop. A timeout pool allocates a single time slice of the main
- * loop and runs every timeout function inside it. The timeout pool is
- * always sorted, so that the extraction of the next timeout function is
- * a constant time operation.
+ * loop and runs every timeout function inside it. The timeouts are kept
+ * in a binary heap ordered by expiration, so that looking up the next
+ * timeout function is a constant time operation, while adding and removing
+ * one are O(log n). Expirations are based on the monotonic clock, so
+ * changes to the wall-clock time don't stall or skip timeouts.
  *
  * Inside Egg, every #EggTimeline share the same timeout pool, unless
  * the EGG_TIMELINE=no-pool environment variable is set.
@@ -448,8 +466,11 @@ egg_timeout_pool_new (gint priority)
 
   pool = (EggTimeoutPool *) source;
 
-  g_get_current_time (&pool->start_time);
+  pool->start_time = g_get_monotonic_time ();
   pool->next_id = 1;
+  pool->heap = g_ptr_array_new ();
+  pool->index = g_hash_table_new (g_direct_hash, g_direct_equal);
+  pool->dispatched = g_ptr_array_new ();
   pool->id = g_source_attach (source, NULL);
 
   /* let the default GLib context manage the pool */
@@ -498,15 +519,20 @@ egg_timeout_pool_add (EggTimeoutPool *pool,
 
   timeout = egg_timeout_new (interval);
 
+  /* ids are only handed out once, skip 0 after wrapping around */
+  if (G_UNLIKELY (pool->next_id == 0))
+    pool->next_id = 1;
+
   retval = timeout->id = pool->next_id++;
 
-  timeout->last_time = egg_timeout_pool_get_ticks (pool);
+  /* the time of the main loop iteration may be stale by now */
+  timeout->last_time = g_get_monotonic_time () - pool->start_time;
   timeout->func = func;
   timeout->data = data;
   timeout->notify = notify;
 
-  pool->timeouts = g_list_insert_sorted (pool->timeouts, timeout,
-                                         egg_timeout_sort);
+  g_hash_table_insert (pool->index, GUINT_TO_POINTER (retval), timeout);
+  egg_timeout_heap_push (pool, timeout);
 
   return retval;
 }
@@ -526,20 +552,18 @@ void
 egg_timeout_pool_remove (EggTimeoutPool *pool,
                              guint               id)
 {
-  GList *l;
+  EggTimeout *timeout;
 
-  if ((l = g_list_find_custom (pool->timeouts, GUINT_TO_POINTER (id),
-			       egg_timeout_find_by_id)))
-    {
-      egg_timeout_unref (l->data);
-      pool->timeouts = g_list_delete_link (pool->timeouts, l);
-    }
-  else if ((l = g_list_find_custom (pool->dispatched_timeouts,
-				    GUINT_TO_POINTER (id),
-				    egg_timeout_find_by_id)))
-    {
-      egg_timeout_unref (l->data);
-      pool->dispatched_timeouts
-	= g_list_delete_link (pool->dispatched_timeouts, l);
-    }
+  timeout = g_hash_table_lookup (pool->index, GUINT_TO_POINTER (id));
+  if (!timeout)
+    return;
+
+  g_hash_table_remove (pool->index, GUINT_TO_POINTER (id));
+  timeout->flags |= EGG_TIMEOUT_REMOVED;
+
+  /* while being dispatched it's only referenced by the dispatch-list */
+  if (timeout->slot >= 0)
+    egg_timeout_heap_remove (pool, timeout->slot);
+
+  egg_timeout_unref (timeout);
 }
@@ -7,11 +7,21 @@
  * forward multiple frames */
 #define TEST_TIMELINE_FPS 10
 #define TEST_TIMELINE_FRAME_COUNT 20
+/* frames the pool may skip, e.g. on a busy box, before this fails */
+#define TEST_MAX_SKIPPED 2
+#define TEST_WATCHDOG_SECONDS 30
+/* the number of skipped frames depends on how busy the machine is, it's
+ * only limited that tightly when asked for, otherwise at most half of the
+ * frames may be skipped */
+#define TEST_TIMING_ENV "NOTIFY_OSD_TEST_TIMING"
+#define TEST_LOOSE_MAX_SKIPPED TEST_TIMELINE_FRAME_COUNT
 
 typedef struct _TestState {
   EggTimeline *timeline;
   gint prev_frame;
   gint completion_count;
+  gint dispatches;
+  gint skipped;
   gint passed;
 }TestState;
 
@@ -22,7 +32,10 @@ new_frame_cb (EggTimeline *timeline,
               TestState *state)
 {
   gint current_frame = egg_timeline_get_current_frame (state->timeline);
-  
+
+  state->dispatches++;
+  state->skipped += egg_timeline_get_delta (state->timeline, NULL) - 1;
+
   if (state->prev_frame != egg_timeline_get_current_frame (state->timeline))
     {
       g_print("timeline previous frame=%-4i actual frame=%-4i (OK)\n",
@@ -46,10 +59,26 @@ static void
 completed_cb (EggTimeline *timeline,
               TestState *state)
 {
+  gint expected = 2 * TEST_TIMELINE_FRAME_COUNT;
+
   state->completion_count++;
 
   if (state->completion_count == 2)
     {
+        g_print ("dispatches=%d (expected %d) skipped=%d\n",
+                 state->dispatches,
+                 expected,
+                 state->skipped);
+
+        /* every frame is either dispatched or skipped, never both, and
+         * skipped frames overshooting the end of the last loop don't
+         * count towards the expected ones */
+        if (state->dispatches > expected ||
+            state->dispatches + state->skipped < expected ||
+            state->skipped > (g_getenv (TEST_TIMING_ENV) ?
+                              TEST_MAX_SKIPPED : TEST_LOOSE_MAX_SKIPPED))
+          state->passed = FALSE;
+
         if (state->passed)
           {
               g_print("Passed\n");
@@ -64,6 +93,16 @@ completed_cb (EggTimeline *timeline,
 }
 
 
+static gboolean
+watchdog_cb (gpointer data)
+{
+  g_print ("Failed, timeline never completed\n");
+  exit (EXIT_FAILURE);
+
+  return FALSE;
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -86,8 +125,12 @@ main(int argc, char **argv)
 
   state.prev_frame = -1;
   state.completion_count = 0;
+  state.dispatches = 0;
+  state.skipped = 0;
   state.passed = TRUE;
 
+  g_timeout_add_seconds (TEST_WATCHDOG_SECONDS, watchdog_cb, NULL);
+
   egg_timeline_start (state.timeline);
   
   egg_main();
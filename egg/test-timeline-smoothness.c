@@ -5,14 +5,24 @@
 #define TEST_TIMELINE_FPS 10
 #define TEST_TIMELINE_FRAME_COUNT 20
 #define TEST_ERROR_TOLERANCE 5
+/* frames allowed to be off by more than the tolerance, e.g. on a busy box */
+#define TEST_MAX_BUMPS 2
+#define TEST_WATCHDOG_SECONDS 30
+/* the tight limits above only apply when asked for, a loaded build-machine
+ * would make "make check" fail at random otherwise, it always has to stay
+ * within this many frame-intervals of mean jitter though */
+#define TEST_TIMING_ENV "NOTIFY_OSD_TEST_TIMING"
+#define TEST_LOOSE_JITTER_FRAMES 2
 
 typedef struct _TestState {
   EggTimeline *timeline;
-  GTimeVal start_time;
-  GTimeVal prev_frame_time;
+  gint64 start_time;
+  gint64 prev_frame_time;
   guint frame;
   gint completion_count;
-  gint passed;
+  gint bumps;
+  gint64 total_jitter_us;
+  gint64 max_jitter_us;
 }TestState;
 
 
@@ -21,37 +31,38 @@ new_frame_cb (EggTimeline *timeline,
               gint frame_num,
               TestState *state)
 {
-  GTimeVal current_time;
-  glong total_elapsed_ms;
-  glong frame_elapsed_ms = 0;
+  gint64 current_time;
+  gint64 total_elapsed_us;
+  gint64 frame_elapsed_us = 0;
+  gint64 jitter_us;
   gchar *bump = "";
-  
-  g_get_current_time (&current_time);
-  
-  total_elapsed_ms = (current_time.tv_sec - state->start_time.tv_sec) * 1000;
-  total_elapsed_ms += (current_time.tv_usec - state->start_time.tv_usec)/1000;
+
+  current_time = g_get_monotonic_time ();
+
+  total_elapsed_us = current_time - state->start_time;
 
   if (state->frame>0)
     {
-        frame_elapsed_ms = 
-          (current_time.tv_sec - state->prev_frame_time.tv_sec) * 1000;
-        frame_elapsed_ms += 
-          (current_time.tv_usec - state->prev_frame_time.tv_usec)/1000;
+        frame_elapsed_us = current_time - state->prev_frame_time;
+
+        jitter_us = ABS (frame_elapsed_us
+                         - (G_USEC_PER_SEC / TEST_TIMELINE_FPS));
+        state->total_jitter_us += jitter_us;
+        state->max_jitter_us = MAX (state->max_jitter_us, jitter_us);
 
-        if (ABS(frame_elapsed_ms - (1000/TEST_TIMELINE_FPS)) 
-	      > TEST_ERROR_TOLERANCE)
+        if (jitter_us > TEST_ERROR_TOLERANCE * 1000)
           {
-              state->passed = FALSE;
+              state->bumps++;
 	      bump = " (BUMP)";
           }
     }
-  
+
   g_print ("timeline frame=%-2d total elapsed=%-4li(ms) since last frame=%-4li(ms)%s\n",
            egg_timeline_get_current_frame(state->timeline),
-           total_elapsed_ms,
-           frame_elapsed_ms,
+           (glong) (total_elapsed_us / 1000),
+           (glong) (frame_elapsed_us / 1000),
 	   bump);
-  
+
   state->prev_frame_time = current_time;
   state->frame++;
 }
@@ -61,11 +72,39 @@ static void
 completed_cb (EggTimeline *timeline,
               TestState *state)
 {
+  gdouble mean_jitter_ms;
+
   state->completion_count++;
 
   if (state->completion_count == 2)
     {
-        if (state->passed)
+        mean_jitter_ms = state->frame > 1
+                         ? state->total_jitter_us / 1000.0 / (state->frame - 1)
+                         : 0.0;
+
+        g_print ("frames=%u mean jitter=%.2f(ms) max jitter=%.2f(ms) bumps=%d\n",
+                 state->frame,
+                 mean_jitter_ms,
+                 state->max_jitter_us / 1000.0,
+                 state->bumps);
+
+        if (!g_getenv (TEST_TIMING_ENV))
+          {
+              if (state->frame <= 2 * TEST_TIMELINE_FRAME_COUNT &&
+                  mean_jitter_ms <= TEST_LOOSE_JITTER_FRAMES * 1000.0 /
+                                    TEST_TIMELINE_FPS)
+                {
+                    g_print ("Passed (set " TEST_TIMING_ENV
+                             " for the tight limits)\n");
+                    exit (EXIT_SUCCESS);
+                }
+
+              g_print ("Failed\n");
+              exit (EXIT_FAILURE);
+          }
+
+        if (mean_jitter_ms <= TEST_ERROR_TOLERANCE &&
+            state->bumps <= TEST_MAX_BUMPS)
           {
               g_print("Passed\n");
               exit(EXIT_SUCCESS);
@@ -79,6 +118,16 @@ completed_cb (EggTimeline *timeline,
 }
 
 
+static gboolean
+watchdog_cb (gpointer data)
+{
+  g_print ("Failed, timeline never completed\n");
+  exit (EXIT_FAILURE);
+
+  return FALSE;
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -101,9 +150,13 @@ main(int argc, char **argv)
 
   state.frame = 0;
   state.completion_count = 0;
-  state.passed = TRUE;
+  state.bumps = 0;
+  state.total_jitter_us = 0;
+  state.max_jitter_us = 0;
+
+  g_timeout_add_seconds (TEST_WATCHDOG_SECONDS, watchdog_cb, NULL);
 
-  g_get_current_time (&state.start_time);
+  state.start_time = g_get_monotonic_time ();
   egg_timeline_start (state.timeline);
 
   egg_main();
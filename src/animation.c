@@ -0,0 +1,269 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** animation.c - single frame-clock driving all fades, glows and pointer-polls
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <string.h>
+
+#include <glib.h>
+#include <egg/egg-timeline.h>
+#include <egg/egg-alpha.h>
+
+#include "animation.h"
+
+// resolution of the timelines the EggAlpha-functions read their progress from
+#define ANIMATION_STEPS 1000
+
+struct _Animation
+{
+	gint64             start;    // usec, monotonic
+	gint64             duration; // usec, 0 for open-ended ones
+	EggTimeline*       timeline; // never started, only feeds alpha
+	EggAlpha*          alpha;
+	gdouble            value;
+	AnimationFrameFunc frame;
+	AnimationDoneFunc  done;
+	gpointer           data;
+	gboolean           finished; // stopped or done, freed after the tick
+};
+
+static GPtrArray*     g_animations  = NULL;
+static guint          g_clock_id    = 0;
+static gint64         g_last_tick   = 0; // 0 while the clock sleeps
+static gboolean       g_dispatching = FALSE;
+static AnimationStats g_stats       = { 0 };
+
+//-- private functions ---------------------------------------------------------
+
+static void
+_animation_free (Animation* animation)
+{
+	if (animation->alpha)
+		g_object_unref (animation->alpha);
+
+	if (animation->timeline)
+		g_object_unref (animation->timeline);
+
+	g_free (animation);
+}
+
+// the easing-functions work on frame-numbers, so the timeline is moved to
+// the frame matching the elapsed time before asking the alpha
+static gdouble
+_ease (Animation* animation,
+       gdouble    progress)
+{
+	if (!animation->alpha)
+		return progress;
+
+	egg_timeline_advance (animation->timeline,
+			      (guint) (progress * ANIMATION_STEPS + 0.5f));
+
+	return (gdouble) egg_alpha_get_alpha (animation->alpha) /
+	       (gdouble) EGG_ALPHA_MAX_ALPHA;
+}
+
+static void
+_stop_clock (void)
+{
+	if (g_clock_id)
+		g_source_remove (g_clock_id);
+
+	g_clock_id  = 0;
+	g_last_tick = 0;
+}
+
+static gboolean
+_clock_cb (gpointer data G_GNUC_UNUSED)
+{
+	animation_advance (g_get_monotonic_time ());
+
+	if (g_animations->len)
+		return TRUE;
+
+	// nothing left to animate, sleep until the next animation_start()
+	g_clock_id  = 0;
+	g_last_tick = 0;
+
+	return FALSE;
+}
+
+//-- public functions ----------------------------------------------------------
+
+Animation*
+animation_start (guint              msecs,
+		 EggAlphaFunc       easing,
+		 AnimationFrameFunc frame,
+		 AnimationDoneFunc  done,
+		 gpointer           data)
+{
+	Animation* animation;
+
+	if (!g_animations)
+		g_animations = g_ptr_array_new ();
+
+	animation           = g_new0 (Animation, 1);
+	animation->start    = g_get_monotonic_time ();
+	animation->duration = (gint64) msecs * 1000;
+	animation->frame    = frame;
+	animation->done     = done;
+	animation->data     = data;
+
+	if (msecs && easing)
+	{
+		animation->timeline = egg_timeline_new (ANIMATION_STEPS,
+							ANIMATION_FPS);
+		animation->alpha = g_object_ref_sink (
+			egg_alpha_new_full (animation->timeline,
+					    easing,
+					    NULL,
+					    NULL));
+	}
+
+	// e.g. a decreasing ramp has to start out at 1.0 already
+	if (msecs)
+		animation->value = _ease (animation, 0.0f);
+
+	g_ptr_array_add (g_animations, animation);
+
+	if (!g_clock_id)
+	{
+		g_last_tick = 0;
+		g_clock_id  = g_timeout_add (1000 / ANIMATION_FPS,
+					     _clock_cb,
+					     NULL);
+	}
+
+	return animation;
+}
+
+void
+animation_stop (Animation* animation)
+{
+	if (!animation || animation->finished)
+		return;
+
+	animation->finished = TRUE;
+
+	// swept once the current tick is through
+	if (g_dispatching)
+		return;
+
+	g_ptr_array_remove (g_animations, animation);
+	_animation_free (animation);
+
+	if (!g_animations->len)
+		_stop_clock ();
+}
+
+gdouble
+animation_get_value (Animation* animation)
+{
+	if (!animation)
+		return 0.0f;
+
+	return animation->value;
+}
+
+void
+animation_advance (gint64 now)
+{
+	const gint64 interval = G_USEC_PER_SEC / ANIMATION_FPS;
+	Animation*   animation;
+	gdouble      progress;
+	guint        n;
+	guint        i;
+
+	// a tick coming in more than half a frame late means frames were lost
+	if (g_last_tick && now - g_last_tick > interval * 3 / 2)
+		g_stats.dropped += (now - g_last_tick + interval / 2) /
+				   interval - 1;
+
+	g_last_tick = now;
+	g_stats.frames++;
+
+	if (!g_animations)
+		return;
+
+	// animations started from within callbacks get their first frame with
+	// the next tick
+	g_dispatching = TRUE;
+	n = g_animations->len;
+	for (i = 0; i < n; i++)
+	{
+		animation = g_ptr_array_index (g_animations, i);
+		if (animation->finished)
+			continue;
+
+		progress = 0.0f;
+		if (animation->duration)
+		{
+			progress = CLAMP ((gdouble) (now - animation->start) /
+					  (gdouble) animation->duration,
+					  0.0f,
+					  1.0f);
+			animation->value = _ease (animation, progress);
+		}
+
+		if (animation->frame)
+			animation->frame (animation,
+					  animation->value,
+					  animation->data);
+
+		if (animation->finished || !animation->duration || progress < 1.0f)
+			continue;
+
+		animation->finished = TRUE;
+		if (animation->done)
+			animation->done (animation, animation->data);
+	}
+	g_dispatching = FALSE;
+
+	for (i = g_animations->len; i > 0; i--)
+	{
+		animation = g_ptr_array_index (g_animations, i - 1);
+		if (!animation->finished)
+			continue;
+
+		g_ptr_array_remove_index (g_animations, i - 1);
+		_animation_free (animation);
+	}
+}
+
+void
+animation_get_stats (AnimationStats* stats)
+{
+	if (!stats)
+		return;
+
+	*stats        = g_stats;
+	stats->active = g_animations ? g_animations->len : 0;
+}
+
+void
+animation_reset_stats (void)
+{
+	memset (&g_stats, 0, sizeof (AnimationStats));
+
+	// late ticks are only counted against ticks since the reset
+	g_last_tick = 0;
+}
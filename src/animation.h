@@ -0,0 +1,85 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** animation.h - single frame-clock driving all fades, glows and pointer-polls
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __ANIMATION_H
+#define __ANIMATION_H
+
+#include <glib.h>
+#include <egg/egg-alpha.h>
+
+G_BEGIN_DECLS
+
+#define ANIMATION_FPS 60
+
+typedef struct _Animation Animation;
+
+typedef struct _AnimationStats
+{
+	guint frames;  // ticks of the frame-clock
+	guint dropped; // frames missed because a tick came in late
+	guint active;  // animations currently running
+} AnimationStats;
+
+// value is the eased progress (0.0 - 1.0), always 0.0 for open-ended ones
+typedef void (*AnimationFrameFunc) (Animation* animation,
+				    gdouble    value,
+				    gpointer   data);
+
+// called right after the last frame, the animation is freed once it returns
+typedef void (*AnimationDoneFunc) (Animation* animation,
+				   gpointer   data);
+
+// runs for msecs (0: until stopped) with easing being any of the EggAlpha-
+// functions, e.g. EGG_ALPHA_RAMP_INC (NULL: linear), progress is derived from
+// the monotonic time passed since the start and not from counted frames, the
+// frame-clock itself only runs while there's at least one animation
+Animation*
+animation_start (guint              msecs,
+		 EggAlphaFunc       easing,
+		 AnimationFrameFunc frame,
+		 AnimationDoneFunc  done,
+		 gpointer           data);
+
+// done is not called, safe from within frame- or done-callbacks
+void
+animation_stop (Animation* animation);
+
+// eased value of the most recent frame
+gdouble
+animation_get_value (Animation* animation);
+
+// ticks all animations as of now (g_get_monotonic_time()), called by the
+// frame-clock, exposed for the unit-tests
+void
+animation_advance (gint64 now);
+
+void
+animation_get_stats (AnimationStats* stats);
+
+void
+animation_reset_stats (void);
+
+G_END_DECLS
+
+#endif /* __ANIMATION_H */
@@ -0,0 +1,64 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** atoms.c - X atoms interned once and shared by all modules
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+#include <gdk/gdkx.h>
+#include <X11/Xlib.h>
+
+#include "atoms.h"
+
+static char* g_atom_names[ATOM_LAST] = {
+	"_NET_WORKAREA",
+	"_NET_SUPPORTING_WM_CHECK",
+	"_NET_WM_NAME",
+	"_COMPIZ_WM_WINDOW_BLUR"
+};
+
+static Atom     g_atoms[ATOM_LAST];
+static gboolean g_initialized = FALSE;
+
+//-- public functions ----------------------------------------------------------
+
+void
+atoms_init (Display* dpy)
+{
+	g_return_if_fail (dpy != NULL);
+
+	if (g_initialized)
+		return;
+
+	XInternAtoms (dpy, g_atom_names, ATOM_LAST, False, g_atoms);
+	g_initialized = TRUE;
+}
+
+Atom
+atoms_get (AtomName name)
+{
+	g_return_val_if_fail (name < ATOM_LAST, None);
+
+	if (!g_initialized)
+		atoms_init (gdk_x11_display_get_xdisplay (gdk_display_get_default ()));
+
+	return g_atoms[name];
+}
@@ -0,0 +1,53 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** atoms.h - X atoms interned once and shared by all modules
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __ATOMS_H
+#define __ATOMS_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	ATOM_NET_WORKAREA = 0,
+	ATOM_NET_SUPPORTING_WM_CHECK,
+	ATOM_NET_WM_NAME,
+	ATOM_COMPIZ_WM_WINDOW_BLUR,
+	ATOM_LAST
+} AtomName;
+
+// interns all atoms with a single round-trip, called once at startup, the
+// display has to stay the same for the lifetime of the process
+void
+atoms_init (Display* dpy);
+
+// falls back to atoms_init() on the default display if that wasn't done yet
+Atom
+atoms_get (AtomName name);
+
+G_END_DECLS
+
+#endif /* __ATOMS_H */
@@ -0,0 +1,152 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** backlog.c - shorter on-screen times while the queue is backed up
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "backlog.h"
+
+// queue-depth up to which bubbles keep their full on-screen time, 0 disables
+// the backlog-policy
+gint BACKLOG_THRESHOLD = 0;
+
+// on-screen time (ms) bubbles never get shortened below
+gint BACKLOG_MIN_TIMEOUT = 1500;
+
+// queued bubbles of a sender beyond this many get collapsed into a single
+// "N more from X"-bubble, 0 disables collapsing
+gint BACKLOG_COLLAPSE = 0;
+
+// the drain-rate is measured over this many usec
+#define RATE_WINDOW (60 * G_USEC_PER_SEC)
+
+// the last drains remembered, must be a power of two
+#define RATE_SAMPLES 128
+
+struct _Backlog
+{
+	gint64 drained[RATE_SAMPLES]; // ring of monotonic timestamps
+	guint  head;                  // index of the next one to be written
+	guint  count;
+};
+
+//-- private functions ---------------------------------------------------------
+
+// factor the times get scaled with, as threshold / depth
+static gboolean
+_get_scale (guint  depth,
+	    guint* num,
+	    guint* den)
+{
+	if (BACKLOG_THRESHOLD <= 0 || depth <= (guint) BACKLOG_THRESHOLD)
+		return FALSE;
+
+	*num = BACKLOG_THRESHOLD;
+	*den = depth;
+
+	return TRUE;
+}
+
+//-- public functions ----------------------------------------------------------
+
+Backlog*
+backlog_new (void)
+{
+	return g_new0 (Backlog, 1);
+}
+
+void
+backlog_free (Backlog* self)
+{
+	g_free (self);
+}
+
+guint
+backlog_scale_timeout (guint timeout,
+		       guint depth)
+{
+	guint num;
+	guint den;
+	guint floor;
+
+	if (!_get_scale (depth, &num, &den))
+		return timeout;
+
+	floor = MIN ((guint) MAX (BACKLOG_MIN_TIMEOUT, 0), timeout);
+
+	return MAX ((guint) ((guint64) timeout * num / den), floor);
+}
+
+guint
+backlog_scale_fade (guint msecs,
+		    guint depth)
+{
+	guint num;
+	guint den;
+
+	if (!_get_scale (depth, &num, &den) || msecs == 0)
+		return msecs;
+
+	// 0 would mean no fade at all, which callers treat differently
+	return MAX (1, (guint) ((guint64) msecs * num / den));
+}
+
+void
+backlog_note_drained (Backlog* self,
+		      gint64   now)
+{
+	g_return_if_fail (self != NULL);
+
+	self->drained[self->head] = now;
+	self->head = (self->head + 1) & (RATE_SAMPLES - 1);
+	if (self->count < RATE_SAMPLES)
+		self->count++;
+}
+
+guint
+backlog_get_drain_rate (Backlog* self,
+			gint64   now)
+{
+	gint64 oldest = now;
+	guint  n      = 0;
+	guint  i;
+
+	g_return_val_if_fail (self != NULL, 0);
+
+	for (i = 1; i <= self->count; i++)
+	{
+		gint64 time = self->drained[(self->head - i) & (RATE_SAMPLES - 1)];
+
+		if (now - time > RATE_WINDOW)
+			break;
+
+		oldest = time;
+		n++;
+	}
+
+	// more drains than fit into the ring, extrapolate from the ones held
+	if (n == RATE_SAMPLES && now > oldest)
+		return (guint) ((guint64) n * RATE_WINDOW / (now - oldest));
+
+	return n;
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** backlog.h - shorter on-screen times while the queue is backed up
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __BACKLOG_H
+#define __BACKLOG_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _Backlog Backlog;
+
+Backlog*
+backlog_new (void);
+
+void
+backlog_free (Backlog* self);
+
+// on-screen time (ms) of a bubble with depth others still queued behind it,
+// shrinks with the depth once it exceeds BACKLOG_THRESHOLD, but never below
+// BACKLOG_MIN_TIMEOUT (or the original timeout, if that's shorter already)
+guint
+backlog_scale_timeout (guint timeout,
+		       guint depth);
+
+// same for the duration of a fade, which goes down to 1 msec (but a fade of 0
+// msecs stays at 0)
+guint
+backlog_scale_fade (guint msecs,
+		    guint depth);
+
+// notes a bubble leaving the queue, now is g_get_monotonic_time()
+void
+backlog_note_drained (Backlog* self,
+		      gint64   now);
+
+// bubbles which left the queue per minute, over the last minute
+guint
+backlog_get_drain_rate (Backlog* self,
+			gint64   now);
+
+G_END_DECLS
+
+#endif /* __BACKLOG_H */
@@ -50,6 +50,13 @@
 #include "bubble-window.h"
 #include "raico-blur.h"
 #include "tile.h"
+#include "icon-cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "animation.h"
+#include "timer-wheel.h"
+#include "backlog.h"
+#include "atoms.h"
 
 G_DEFINE_TYPE (Bubble, bubble, G_TYPE_OBJECT);
 
@@ -63,12 +70,20 @@ struct _BubblePrivate {
 	guint            timer_id;
 	gboolean         mouse_over;
 	gfloat           distance;
+	gfloat           painted_distance; // of the last repaint, < 0 if none
+	gdouble          opacity;          // of the window, maybe not written yet
+	gint             applied_alpha;    // opacity last written (0..255)
+	gboolean         opacity_dirty;
+	gulong           blur_xid;     // window _COMPIZ_WM_WINDOW_BLUR is set on
+	glong            blur_data[8]; // and its value, to skip identical writes
+	gint             shape_width;  // key of the shape last set on the window,
+	gint             shape_height; // width is -1 if there's none yet
+	gboolean         shape_mouse_over;
+	gboolean         shape_composited;
 	gchar*           synchronous;
 	gboolean         composited;
-	EggAlpha*        alpha;
-	EggTimeline*     timeline;
-	guint            draw_handler_id;
-	guint            pointer_update_id;
+	Animation*       animation; // fade or glow, NULL if none is running
+	Animation*       hover;     // polls the pointer while being shown
 	tile_t*          tile_background_part;
 	tile_t*          tile_background;
 	tile_t*          tile_icon;
@@ -91,15 +106,38 @@ struct _BubblePrivate {
 	gboolean         message_body_needs_refresh;
 	guint            id;
 	GdkPixbuf*       icon_pixbuf;
+	cairo_surface_t* icon_surface; // padded, from image_data, no pixbuf then
+	gint             icon_tile_size; // pixel-size tile_icon was rendered at
 	gint             value; // "empty": -2, valid range: -1..101, -1/101 trigger "over/undershoot"-effect
 	gchar*           sender;
-	guint            timeout;
+	gchar*           app_name;
+	guint            timeout; // as requested by the client
+	guint            backlog_depth; // queue-depth scaling timeout on timer-start
+	guint            fade_out_time; // ms
 	guint            urgency;
 	//notification_t* notification;
 
 	// used to prevent unneeded updates of the tile-cache, for append-,
 	// update or replace-cases, needs to move into class Notification
 	GString*         old_icon_filename;
+
+	// icon is still being decoded in the background, the layout is done as
+	// if it was already there (its size is known upfront anyway)
+	gboolean         icon_pending;
+	GCancellable*    icon_cancellable;
+	guint            icon_wait_id;
+
+	// icon to be loaded right away, but only once the bubble is laid out,
+	// so the D-Bus reply doesn't wait for it
+	gchar*           icon_deferred;
+	gchar*           icon_deferred_preferred;
+
+	// monotonic time the last Notify for this bubble came in, reset to 0
+	// once the first frame for it has been drawn
+	gint64           notify_time;
+
+	// rendered into image-surfaces only, see bubble_set_offscreen()
+	gboolean         offscreen;
 };
 
 enum
@@ -108,6 +146,7 @@ enum
 	VALUE_CHANGED,
 	MESSAGE_BODY_DELETED,
 	MESSAGE_BODY_INSERTED,
+	ICON_READY,
 	LAST_SIGNAL
 };
 
@@ -158,7 +197,6 @@ float BUBBLE_BG_COLOR_A  = 0.9f;
 #define INDICATOR_LIT_B    1.0f
 #define INDICATOR_LIT_A    1.0f
 
-#define FPS                 60
 #define PROXIMITY_THRESHOLD 40
 #define WINDOW_MIN_OPACITY  0.4f
 #define WINDOW_MAX_OPACITY  1.0f
@@ -170,11 +208,130 @@ float BUBBLE_BG_COLOR_A  = 0.9f;
 gboolean BUBBLE_PREVENT_FADE   = FALSE;
 gboolean BUBBLE_CLOSE_ON_CLICK = FALSE;
 
+// max. time in ms a new bubble waits for its icon before it's shown without
+gint BUBBLE_ICON_LOAD_TIMEOUT = 250;
+
+// resolution offscreen bubbles lay out their text with
+#define BUBBLE_OFFSCREEN_DPI 96.0f
+
 //-- private functions ---------------------------------------------------------
 
 static guint g_bubble_signals[LAST_SIGNAL] = { 0 };
 gint         g_pointer[2];
 
+// bubbles whose window-opacity changed during the current frame
+static GSList* g_opacity_dirty    = NULL;
+static guint   g_opacity_flush_id = 0;
+
+// _NET_WM_WINDOW_OPACITY can't show finer steps than that anyway
+static gint
+_opacity_to_alpha (gdouble opacity)
+{
+	return (gint) (CLAMP (opacity, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static void
+_apply_opacity (Bubble* self)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+	gint           alpha;
+
+	priv->opacity_dirty = FALSE;
+
+	alpha = _opacity_to_alpha (priv->opacity);
+	if (alpha == priv->applied_alpha)
+		return;
+
+	priv->applied_alpha = alpha;
+	gtk_window_set_opacity (GTK_WINDOW (priv->widget),
+				(gdouble) alpha / 255.0f);
+}
+
+static gboolean
+_flush_opacity (gpointer data)
+{
+	GSList* dirty = g_opacity_dirty;
+	GSList* l;
+
+	g_opacity_dirty    = NULL;
+	g_opacity_flush_id = 0;
+
+	for (l = dirty; l; l = l->next)
+		_apply_opacity (BUBBLE (l->data));
+
+	g_slist_free (dirty);
+
+	return FALSE;
+}
+
+// fades and the mouse-over only change the window-opacity, never the content,
+// so no repaint is queued, the property-writes of all bubbles are done once
+// per frame after all of them were updated and unchanged values are skipped
+static void
+_set_opacity (Bubble* self,
+	      gdouble opacity)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+
+	priv->opacity = opacity;
+
+	if (priv->opacity_dirty ||
+	    _opacity_to_alpha (opacity) == priv->applied_alpha)
+		return;
+
+	priv->opacity_dirty = TRUE;
+	g_opacity_dirty = g_slist_prepend (g_opacity_dirty, self);
+
+	if (!g_opacity_flush_id)
+		g_opacity_flush_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+						      _flush_opacity,
+						      NULL,
+						      NULL);
+}
+
+// for opacities which have to be in place before the window is mapped
+static void
+_set_opacity_now (Bubble* self,
+		  gdouble opacity)
+{
+	GET_PRIVATE (self)->opacity = opacity;
+	_apply_opacity (self);
+}
+
+// offscreen bubbles must not depend on the settings of whatever screen they
+// happen to run on, otherwise renderings can't be compared across machines
+static const cairo_font_options_t*
+_get_font_options (Bubble* self)
+{
+	static cairo_font_options_t* options = NULL;
+	BubblePrivate*               priv    = GET_PRIVATE (self);
+
+	if (!priv->offscreen)
+		return gdk_screen_get_font_options (
+			gtk_widget_get_screen (priv->widget));
+
+	if (!options)
+	{
+		options = cairo_font_options_create ();
+		cairo_font_options_set_antialias (options, CAIRO_ANTIALIAS_GRAY);
+		cairo_font_options_set_hint_style (options, CAIRO_HINT_STYLE_SLIGHT);
+		cairo_font_options_set_hint_metrics (options, CAIRO_HINT_METRICS_OFF);
+		cairo_font_options_set_subpixel_order (options,
+						       CAIRO_SUBPIXEL_ORDER_DEFAULT);
+	}
+
+	return options;
+}
+
+static gdouble
+_get_dpi (Bubble* self)
+{
+	if (GET_PRIVATE (self)->offscreen)
+		return BUBBLE_OFFSCREEN_DPI;
+
+	return defaults_get_screen_dpi (self->defaults);
+}
+
 static void
 draw_round_rect (cairo_t* cr,
 		 gdouble  aspect,        // aspect-ratio
@@ -628,6 +785,7 @@ _refresh_background (Bubble* self)
 	raico_blur_t*    blur       = NULL;
 	gint             width;
 	gint             height;
+	gint64           start      = g_get_monotonic_time ();
 
 	bubble_get_size (self, &width, &height);
 
@@ -883,6 +1041,9 @@ _refresh_background (Bubble* self)
 		priv->tile_background = tile_new_for_padding (normal, blurred);
 	else
 		priv->tile_background = tile_new_for_padding (normal, normal);
+	stats_add_sample (STATS_TILE_BACKGROUND,
+			  g_get_monotonic_time () - start);
+	trace_span (TRACE_REFRESH_BACKGROUND, priv->id, start);
 
 	// clean up
 	if (priv->composited)
@@ -892,6 +1053,9 @@ _refresh_background (Bubble* self)
 	cairo_surface_destroy (scratch);
 }
 
+// renders the source-icon (pixbuf or image_data surface) at the current
+// icon-size into the padded surface the icon-tile is created from, does
+// nothing if the tile is still up to date, so it's cheap to call
 void
 _refresh_icon (Bubble* self)
 {
@@ -899,17 +1063,42 @@ _refresh_icon (Bubble* self)
 	Defaults*        d      = self->defaults;
 	cairo_surface_t* normal = NULL;
 	cairo_t*         cr     = NULL;
+	gint             icon_size;
+	gint             width;
+	gint             height;
+	gdouble          scale;
+	gint64           start  = g_get_monotonic_time ();
 
-	if (!priv->icon_pixbuf)
+	if (!priv->icon_pixbuf && !priv->icon_surface)
+		return;
+
+	icon_size = EM2PIXELS (defaults_get_icon_size (d), d);
+
+	// neither source nor pixel-size changed
+	if (priv->tile_icon && priv->icon_tile_size == icon_size)
+		return;
+
+	// image_data icons are converted to their final, padded form already
+	if (!priv->icon_pixbuf &&
+	    cairo_image_surface_get_width (priv->icon_surface) ==
+	    icon_size + 2 * BUBBLE_CONTENT_BLUR_RADIUS)
+	{
+		if (priv->tile_icon)
+			tile_destroy (priv->tile_icon);
+		priv->tile_icon = tile_new (priv->icon_surface,
+					    BUBBLE_CONTENT_BLUR_RADIUS/2);
+		priv->icon_tile_size = icon_size;
+		stats_add_sample (STATS_TILE_ICON,
+				  g_get_monotonic_time () - start);
+		trace_span (TRACE_REFRESH_ICON, priv->id, start);
 		return;
+	}
 
 	// create temp. scratch surface
 	normal = cairo_image_surface_create (
 			CAIRO_FORMAT_ARGB32,
-			EM2PIXELS (defaults_get_icon_size (d), d) +
-			2 * BUBBLE_CONTENT_BLUR_RADIUS,
-			EM2PIXELS (defaults_get_icon_size (d), d) +
-			2 * BUBBLE_CONTENT_BLUR_RADIUS);
+			icon_size + 2 * BUBBLE_CONTENT_BLUR_RADIUS,
+			icon_size + 2 * BUBBLE_CONTENT_BLUR_RADIUS);
 	if (cairo_surface_status (normal) != CAIRO_STATUS_SUCCESS)
 		return;
 
@@ -927,17 +1116,45 @@ _refresh_icon (Bubble* self)
 	cairo_paint (cr);
 	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
 
+	if (priv->icon_pixbuf)
+	{
+		width  = gdk_pixbuf_get_width (priv->icon_pixbuf);
+		height = gdk_pixbuf_get_height (priv->icon_pixbuf);
+	}
+	else
+	{
+		// size of the image_data surface without its padding
+		width  = cairo_image_surface_get_width (priv->icon_surface) -
+			 2 * BUBBLE_CONTENT_BLUR_RADIUS;
+		height = width;
+	}
+
+	// always scale from the source, keep the aspect-ratio and center it
+	scale = (gdouble) icon_size / (gdouble) MAX (width, height);
+	cairo_translate (cr,
+			 BUBBLE_CONTENT_BLUR_RADIUS +
+			 (icon_size - width * scale) / 2.0f,
+			 BUBBLE_CONTENT_BLUR_RADIUS +
+			 (icon_size - height * scale) / 2.0f);
+	cairo_scale (cr, scale, scale);
+
 	// render icon into normal surface
-	gdk_cairo_set_source_pixbuf (cr,
-				     priv->icon_pixbuf,
-				     BUBBLE_CONTENT_BLUR_RADIUS,
-				     BUBBLE_CONTENT_BLUR_RADIUS);
+	if (priv->icon_pixbuf)
+		gdk_cairo_set_source_pixbuf (cr, priv->icon_pixbuf, 0.0f, 0.0f);
+	else
+		cairo_set_source_surface (cr,
+					  priv->icon_surface,
+					  -BUBBLE_CONTENT_BLUR_RADIUS,
+					  -BUBBLE_CONTENT_BLUR_RADIUS);
 	cairo_paint (cr);
 
 	// create the surface/blur-cache from the normal surface
 	if (priv->tile_icon)
 		tile_destroy (priv->tile_icon);
 	priv->tile_icon = tile_new (normal, BUBBLE_CONTENT_BLUR_RADIUS/2);
+	priv->icon_tile_size = icon_size;
+	stats_add_sample (STATS_TILE_ICON, g_get_monotonic_time () - start);
+	trace_span (TRACE_REFRESH_ICON, priv->id, start);
 
 	// clean up
 	cairo_destroy (cr);
@@ -955,6 +1172,7 @@ _refresh_title (Bubble* self)
 	PangoLayout*          layout         = NULL;
 	raico_blur_t*         blur           = NULL;
 	gchar*                text_font_face = NULL;
+	gint64                start          = g_get_monotonic_time ();
 
 	// create temp. scratch surface
 	normal = cairo_image_surface_create (
@@ -1003,13 +1221,11 @@ _refresh_title (Bubble* self)
 	pango_layout_set_text (layout, priv->title->str, priv->title->len);
 
 	// make sure system-wide font-options like hinting, antialiasing etc.
-	// are taken into account
-	pango_cairo_context_set_font_options (
-		pango_layout_get_context (layout),
-		gdk_screen_get_font_options (
-			gtk_widget_get_screen (priv->widget)));
+	// are taken into account, offscreen bubbles use fixed ones instead
+	pango_cairo_context_set_font_options (pango_layout_get_context (layout),
+					      _get_font_options (self));
 	pango_cairo_context_set_resolution  (pango_layout_get_context (layout),
-					     defaults_get_screen_dpi (d));
+					     _get_dpi (self));
 	pango_layout_context_changed (layout);
 
 	// draw text for drop-shadow and ...
@@ -1043,6 +1259,8 @@ _refresh_title (Bubble* self)
 	if (priv->tile_title)
 		tile_destroy (priv->tile_title);
 	priv->tile_title = tile_new (normal, BUBBLE_CONTENT_BLUR_RADIUS);
+	stats_add_sample (STATS_TILE_TITLE, g_get_monotonic_time () - start);
+	trace_span (TRACE_REFRESH_TITLE, priv->id, start);
 
 	// clean up
 	cairo_destroy (cr);
@@ -1063,6 +1281,7 @@ _refresh_body (Bubble* self)
 	PangoLayout*          layout         = NULL;
 	raico_blur_t*         blur           = NULL;
 	gchar*                text_font_face = NULL;
+	gint64                start          = g_get_monotonic_time ();
 
 	// create temp. scratch surface
 	normal = cairo_image_surface_create (
@@ -1113,13 +1332,11 @@ _refresh_body (Bubble* self)
 	                       priv->message_body->len);
 
 	// make sure system-wide font-options like hinting, antialiasing etc.
-	// are taken into account
-	pango_cairo_context_set_font_options (
-		pango_layout_get_context (layout),
-		gdk_screen_get_font_options (
-			gtk_widget_get_screen (priv->widget)));
+	// are taken into account, offscreen bubbles use fixed ones instead
+	pango_cairo_context_set_font_options (pango_layout_get_context (layout),
+					      _get_font_options (self));
 	pango_cairo_context_set_resolution  (pango_layout_get_context (layout),
-					     defaults_get_screen_dpi (d));
+					     _get_dpi (self));
 	pango_layout_context_changed (layout);
 
 	// draw text for drop-shadow and ...
@@ -1153,6 +1370,8 @@ _refresh_body (Bubble* self)
 	if (priv->tile_body)
 		tile_destroy (priv->tile_body);
 	priv->tile_body = tile_new (normal, BUBBLE_CONTENT_BLUR_RADIUS);
+	stats_add_sample (STATS_TILE_BODY, g_get_monotonic_time () - start);
+	trace_span (TRACE_REFRESH_BODY, priv->id, start);
 
 	// clean up
 	cairo_destroy (cr);
@@ -1169,6 +1388,7 @@ _refresh_indicator (Bubble* self)
 	Defaults*        d      = self->defaults;
 	cairo_surface_t* normal = NULL;
 	cairo_t*         cr     = NULL;
+	gint64           start  = g_get_monotonic_time ();
 
 	// create temp. scratch surface
 	normal = cairo_image_surface_create (
@@ -1211,6 +1431,9 @@ _refresh_indicator (Bubble* self)
 	if (priv->tile_indicator)
 		tile_destroy (priv->tile_indicator);
 	priv->tile_indicator = tile_new (normal, BUBBLE_CONTENT_BLUR_RADIUS/2);
+	stats_add_sample (STATS_TILE_INDICATOR,
+			  g_get_monotonic_time () - start);
+	trace_span (TRACE_REFRESH_INDICATOR, priv->id, start);
 
 	// clean up
 	cairo_destroy (cr);
@@ -1328,7 +1551,7 @@ _render_icon (Bubble*  self,
 		    alpha_normal,
 		    alpha_blur);
 
-	if (priv->alpha)
+	if (priv->animation)
 	{
 		cairo_push_group (cr);
 		tile_paint (priv->tile_icon,
@@ -1336,8 +1559,7 @@ _render_icon (Bubble*  self,
 			    x,
 			    y,
 			    0.0f,
-			    (gfloat) egg_alpha_get_alpha (priv->alpha) /
-			    (gfloat) EGG_ALPHA_MAX_ALPHA);
+			    animation_get_value (priv->animation));
 		pattern = cairo_pop_group (cr);
 		if (priv->value == -1)
 			cairo_set_source_rgba (cr, 0.0f, 0.0f, 0.0f, 1.0f);
@@ -1398,7 +1620,7 @@ _render_indicator (Bubble*  self,
 		    alpha_normal,
 		    alpha_blur);
 
-	if (priv->alpha)
+	if (priv->animation)
 	{
 		cairo_push_group (cr);
 		tile_paint (priv->tile_indicator,
@@ -1406,8 +1628,7 @@ _render_indicator (Bubble*  self,
 			    x,
 			    y,
 			    0.0f,
-			    (gfloat) egg_alpha_get_alpha (priv->alpha) /
-			    (gfloat) EGG_ALPHA_MAX_ALPHA);
+			    animation_get_value (priv->animation));
 		pattern = cairo_pop_group (cr);
 		if (priv->value == -1)
 			cairo_set_source_rgba (cr, 0.0f, 0.0f, 0.0f, 1.0f);
@@ -1526,15 +1747,19 @@ _render_layout (Bubble*  self,
 }
 
 // the behind-bubble blur only works with the enabled/working compiz-plugin blur
-// by setting the hint _COMPIZ_WM_WINDOW_BLUR on the bubble-window
-void
-_set_bg_blur (GtkWidget* window,
-	      gboolean   set_blur,
-	      gint       shadow_size)
+// by setting the hint _COMPIZ_WM_WINDOW_BLUR on the bubble-window, it only
+// depends on the allocation and shadow-size, so it's written only if one of
+// those changed (or the window got realized anew) and not on every expose
+static void
+_set_bg_blur (Bubble*  self,
+	      gboolean set_blur,
+	      gint     shadow_size)
 {
-	glong data[8];
-	GtkAllocation a;
-	GdkWindow *gdkwindow;
+	BubblePrivate* priv = GET_PRIVATE (self);
+	GtkWidget*     window = priv->widget;
+	glong          data[8];
+	GtkAllocation  a;
+	GdkWindow*     gdkwindow;
 
 	// sanity check
 	if (!window)
@@ -1556,11 +1781,16 @@ _set_bg_blur (GtkWidget* window,
 
 	if (set_blur)
 	{
+		if (priv->blur_xid == GDK_WINDOW_XID (gdkwindow) &&
+		    !memcmp (priv->blur_data, data, sizeof (data)))
+			return;
+
+		priv->blur_xid = GDK_WINDOW_XID (gdkwindow);
+		memcpy (priv->blur_data, data, sizeof (data));
+
 		XChangeProperty (GDK_WINDOW_XDISPLAY (gdkwindow),
 				 GDK_WINDOW_XID (gdkwindow),
-				 XInternAtom (GDK_WINDOW_XDISPLAY (gdkwindow),
-					      "_COMPIZ_WM_WINDOW_BLUR",
-					      FALSE),
+				 atoms_get (ATOM_COMPIZ_WM_WINDOW_BLUR),
 				 XA_INTEGER,
 				 32,
 				 PropModeReplace,
@@ -1569,11 +1799,11 @@ _set_bg_blur (GtkWidget* window,
 	}
 	else
 	{
+		priv->blur_xid = 0;
+
 		XDeleteProperty (GDK_WINDOW_XDISPLAY (gdkwindow),
 				 GDK_WINDOW_XID (gdkwindow),
-				 XInternAtom (GDK_WINDOW_XDISPLAY (gdkwindow),
-					      "_COMPIZ_WM_WINDOW_BLUR",
-					      FALSE));
+				 atoms_get (ATOM_COMPIZ_WM_WINDOW_BLUR));
 	}
 }
 
@@ -1608,10 +1838,7 @@ update_input_shape (GtkWidget* window)
 		// set an 1x1 input-region to allow click-through 
 		region = cairo_region_create_rectangle (&rect);
 		if (cairo_region_status (region) == CAIRO_STATUS_SUCCESS)
-		{
-			gtk_widget_input_shape_combine_region (window, NULL);
 			gtk_widget_input_shape_combine_region (window, region);
-		}
 		cairo_region_destroy (region);
 	}
 	else
@@ -1621,12 +1848,17 @@ update_input_shape (GtkWidget* window)
 	}
 }
 
+// the shape only depends on size, mouse-over and compositing, so the
+// shape-request is only sent to the X-server if one of those changed, it's set
+// on the widget (not its GdkWindow) so it also survives a re-realize
 static void
 update_shape (Bubble* self)
 {
-	gint           width;
-	gint           height;
-	BubblePrivate* priv;
+	gint            width      = 0;
+	gint            height     = 0;
+	gboolean        mouse_over = FALSE;
+	cairo_region_t* region     = NULL;
+	BubblePrivate*  priv;
 
 	// sanity test
 	if (!self || !IS_BUBBLE (self))
@@ -1634,40 +1866,50 @@ update_shape (Bubble* self)
 
 	priv = GET_PRIVATE (self);
 
-	// do we actually need a shape-mask at all?
-	if (priv->composited)
+	// we're not-composited, so deal with mouse-over differently, the size
+	// doesn't matter then
+	if (!priv->composited)
 	{
-		gtk_widget_shape_combine_region (priv->widget, NULL);
-		return;
+		mouse_over = bubble_is_mouse_over (self);
+		if (!mouse_over)
+			gtk_widget_get_size_request (priv->widget, &width, &height);
 	}
 
-	// we're not-composited, so deal with mouse-over differently
-	if (bubble_is_mouse_over (self))
-	{
-		cairo_region_t* region = NULL;
+	if (priv->shape_width      == width      &&
+	    priv->shape_height     == height     &&
+	    priv->shape_mouse_over == mouse_over &&
+	    priv->shape_composited == priv->composited)
+		return;
 
+	// do we actually need a shape-mask at all?
+	if (priv->composited)
+		region = NULL;
+	else if (mouse_over)
 		region = cairo_region_create ();
-		gdk_window_shape_combine_region (gtk_widget_get_window (priv->widget),
-						 region,
-						 0,
-						 0);
-		cairo_region_destroy (region);
-	}
 	else
 	{
-		gtk_widget_get_size_request (priv->widget, &width, &height);
-		const cairo_rectangle_int_t rects[]   = {{2, 0, width - 4, height},
-												 {1, 1, width - 2, height - 2},
-												 {0, 2, width, height - 4}};
-		cairo_region_t*             region = NULL;
+		const cairo_rectangle_int_t rects[] = {{2, 0, width - 4, height},
+						       {1, 1, width - 2, height - 2},
+						       {0, 2, width, height - 4}};
 
 		region = cairo_region_create_rectangles (rects, 3);
-		if (cairo_region_status (region) == CAIRO_STATUS_SUCCESS)
-		{
-			gtk_widget_shape_combine_region (priv->widget, NULL);
-			gtk_widget_shape_combine_region (priv->widget, region);
-		}
 	}
+
+	if (region && cairo_region_status (region) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_region_destroy (region);
+		return;
+	}
+
+	gtk_widget_shape_combine_region (priv->widget, region);
+
+	priv->shape_width      = width;
+	priv->shape_height     = height;
+	priv->shape_mouse_over = mouse_over;
+	priv->shape_composited = priv->composited;
+
+	if (region)
+		cairo_region_destroy (region);
 }
 
 static void
@@ -1678,29 +1920,24 @@ composited_changed_handler (GtkWidget* window,
 
 	bubble = (Bubble*) G_OBJECT (data);
 
+	// offscreen renderings always come with shadow and alpha
+	if (GET_PRIVATE (bubble)->offscreen)
+		return;
+
 	GET_PRIVATE (bubble)->composited = gdk_screen_is_composited (
 						gtk_widget_get_screen (window));
 
 	update_shape (bubble);
 }
 
-static
-gboolean
-expose_handler (GtkWidget*      window,
-		GdkEventExpose* event,
-		gpointer        data)
+// draws a complete frame of the bubble at the given mouse-over distance into
+// cr, shared by the window's draw-handler and bubble_render_to_surface()
+static void
+_render_frame (Bubble*  self,
+	       cairo_t* cr,
+	       gdouble  distance)
 {
-	Bubble*        bubble;
-	cairo_t*       cr;
-	Defaults*      d;
-	BubblePrivate* priv;
-
-	bubble = (Bubble*) G_OBJECT (data);
-
-	d    = bubble->defaults;
-	priv = GET_PRIVATE (bubble);
-
-	cr = gdk_cairo_create (gtk_widget_get_window (window));
+	BubblePrivate* priv = GET_PRIVATE (self);
 
         // clear bubble-background
 	cairo_scale (cr, 1.0f, 1.0f);
@@ -1711,29 +1948,54 @@ expose_handler (GtkWidget*      window,
 	if (BUBBLE_PREVENT_FADE || priv->prevent_fade || !priv->composited)
 	{
 	        // render drop-shadow and bubble-background
-		_render_background (bubble, cr, 1.0f, 0.0f);
+		_render_background (self, cr, 1.0f, 0.0f);
 
 		// render content of bubble depending on layout
-		_render_layout (bubble, cr, 1.0f, 0.0f);
+		_render_layout (self, cr, 1.0f, 0.0f);
 	}
 	else
 	{
 	        // render drop-shadow and bubble-background
-		_render_background (bubble,
-		                    cr,
-		                    priv->distance,
-		                    1.0f - priv->distance);
+		_render_background (self, cr, distance, 1.0f - distance);
     
 		// render content of bubble depending on layout
-		_render_layout (bubble,
-		                cr,
-		                priv->distance,
-		                1.0f - priv->distance);
+		_render_layout (self, cr, distance, 1.0f - distance);
 	}
+}
+
+static
+gboolean
+expose_handler (GtkWidget*      window,
+		GdkEventExpose* event,
+		gpointer        data)
+{
+	Bubble*        bubble;
+	cairo_t*       cr;
+	Defaults*      d;
+	BubblePrivate* priv;
+	gint64         start = g_get_monotonic_time ();
+
+	bubble = (Bubble*) G_OBJECT (data);
+
+	d    = bubble->defaults;
+	priv = GET_PRIVATE (bubble);
 
+	cr = gdk_cairo_create (gtk_widget_get_window (window));
+	_render_frame (bubble, cr, priv->distance);
 	cairo_destroy (cr);
+	priv->painted_distance = priv->distance;
+
+	stats_add_sample (STATS_FRAME_RENDER, g_get_monotonic_time () - start);
+	trace_span (TRACE_EXPOSE, priv->id, start);
 
-	_set_bg_blur (window,
+	if (priv->notify_time)
+	{
+		stats_add_sample (STATS_FIRST_FRAME,
+				  g_get_monotonic_time () - priv->notify_time);
+		priv->notify_time = 0;
+	}
+
+	_set_bg_blur (bubble,
 		      TRUE,
 		      EM2PIXELS (defaults_get_bubble_shadow_size (d), d));
 
@@ -1785,24 +2047,82 @@ redraw_handler (Bubble* bubble)
 	if (!GTK_IS_WINDOW (window))
 		return FALSE;
 
-	if (priv->alpha == NULL)
+	if (priv->animation == NULL)
 	{
 		if (priv->distance < 1.0f && !priv->prevent_fade && !BUBBLE_PREVENT_FADE)
 		{
-			gtk_window_set_opacity (window,
-			                        WINDOW_MIN_OPACITY +
-			                        priv->distance *
-			                        (WINDOW_MAX_OPACITY -
-			                         WINDOW_MIN_OPACITY));
-			bubble_refresh (bubble);
+			_set_opacity (bubble,
+				      WINDOW_MIN_OPACITY +
+				      priv->distance *
+				      (WINDOW_MAX_OPACITY - WINDOW_MIN_OPACITY));
+
+			// the content depends on the distance, but there's
+			// nothing to repaint while the pointer rests
+			if (priv->distance != priv->painted_distance)
+				bubble_refresh (bubble);
 		}
 		else
-			gtk_window_set_opacity (window, WINDOW_MAX_OPACITY);
+		{
+			_set_opacity (bubble, WINDOW_MAX_OPACITY);
+
+			// repaint once with the regular look after leaving
+			if (priv->painted_distance >= 0.0f &&
+			    priv->painted_distance < 1.0f)
+				bubble_refresh (bubble);
+		}
 	}
 
 	return TRUE;
 }
 
+static void
+_icon_decoded_cb (GObject*      source,
+		  GAsyncResult* result,
+		  gpointer      user_data)
+{
+	GTask*     task   = G_TASK (user_data);
+	GError*    error  = NULL;
+	GdkPixbuf* pixbuf = NULL;
+
+	pixbuf = gdk_pixbuf_new_from_stream_finish (result, &error);
+
+	if (pixbuf)
+		g_task_return_pointer (task, pixbuf, g_object_unref);
+	else
+		g_task_return_error (task, error);
+
+	g_object_unref (task);
+}
+
+static void
+_icon_stream_opened_cb (GObject*      source,
+			GAsyncResult* result,
+			gpointer      user_data)
+{
+	GTask*            task   = G_TASK (user_data);
+	GError*           error  = NULL;
+	GFileInputStream* stream = NULL;
+	gint              size;
+
+	stream = g_file_read_finish (G_FILE (source), result, &error);
+	if (!stream)
+	{
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+
+	size = GPOINTER_TO_INT (g_task_get_task_data (task));
+	gdk_pixbuf_new_from_stream_at_scale_async (G_INPUT_STREAM (stream),
+						   size,
+						   size,
+						   TRUE,
+						   g_task_get_cancellable (task),
+						   _icon_decoded_cb,
+						   task);
+	g_object_unref (stream);
+}
+
 static
 GdkPixbuf*
 load_icon (const gchar* filename,
@@ -1841,9 +2161,9 @@ load_icon (const gchar* filename,
 						   &error);
 		if (error)
 		{
-			g_print ("loading icon '%s' caused error: '%s'",
-				 filename,
-				 error->message);
+			g_warning ("loading icon '%s' caused error: '%s'",
+				   filename,
+				   error->message);
 			g_error_free (error);
 			error = NULL;
 			pixbuf = NULL;
@@ -1863,6 +2183,100 @@ load_icon (const gchar* filename,
 	return pixbuf;
 }
 
+// resolves filename (or fallback) to a file, the same way load_icon() does,
+// and decodes that in a worker-thread, theme-lookups are cheap and stay in
+// the main-thread
+static void
+load_icon_async (const gchar*        filename,
+		 const gchar*        fallback,
+		 gint                icon_size,
+		 GCancellable*       cancellable,
+		 GAsyncReadyCallback callback,
+		 gpointer            user_data)
+{
+	GTask*       task;
+	GtkIconInfo* info = NULL;
+	GFile*       file = NULL;
+	GtkIconLookupFlags flags = GTK_ICON_LOOKUP_FORCE_SVG |
+				   GTK_ICON_LOOKUP_GENERIC_FALLBACK |
+				   GTK_ICON_LOOKUP_FORCE_SIZE;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, GINT_TO_POINTER (icon_size), NULL);
+
+	if (!strncmp (filename, "file://", 7))
+		filename += 7;
+
+	if (filename[0] == '/')
+		file = g_file_new_for_path (filename);
+	else
+	{
+		GtkIconTheme* theme = gtk_icon_theme_get_default ();
+
+		info = gtk_icon_theme_lookup_icon (theme,
+						   filename,
+						   icon_size,
+						   flags);
+		if (!info && fallback)
+			info = gtk_icon_theme_lookup_icon (theme,
+							   fallback,
+							   icon_size,
+							   flags);
+		if (!info)
+		{
+			g_task_return_new_error (task,
+						 GTK_ICON_THEME_ERROR,
+						 GTK_ICON_THEME_NOT_FOUND,
+						 "Icon '%s' not present in theme",
+						 filename);
+			g_object_unref (task);
+			return;
+		}
+
+		if (gtk_icon_info_get_filename (info))
+			file = g_file_new_for_path (
+					gtk_icon_info_get_filename (info));
+		else
+		{
+			// built-in icon, nothing to read from disk
+			GError*    error  = NULL;
+			GdkPixbuf* buffer = gtk_icon_info_load_icon (info,
+								     &error);
+
+			if (buffer)
+			{
+				// see load_icon() for why this is copied
+				g_task_return_pointer (task,
+						       gdk_pixbuf_copy (buffer),
+						       g_object_unref);
+				g_object_unref (buffer);
+			}
+			else
+				g_task_return_error (task, error);
+
+			g_object_unref (info);
+			g_object_unref (task);
+			return;
+		}
+
+		g_object_unref (info);
+	}
+
+	g_file_read_async (file,
+			   G_PRIORITY_DEFAULT,
+			   cancellable,
+			   _icon_stream_opened_cb,
+			   task);
+	g_object_unref (file);
+}
+
+static GdkPixbuf*
+load_icon_finish (GAsyncResult* result,
+		  GError**      error)
+{
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static
 gboolean
 pointer_update (Bubble* bubble)
@@ -1961,6 +2375,23 @@ bubble_dispose (GObject* gobject)
 
 	priv = GET_PRIVATE (gobject);
 
+	// make sure a still running icon-load does not touch us anymore
+	if (priv->icon_cancellable)
+	{
+		g_cancellable_cancel (priv->icon_cancellable);
+		g_object_unref (priv->icon_cancellable);
+		priv->icon_cancellable = NULL;
+	}
+
+	if (priv->icon_wait_id)
+	{
+		g_source_remove (priv->icon_wait_id);
+		priv->icon_wait_id = 0;
+	}
+
+	g_clear_pointer (&priv->icon_deferred, g_free);
+	g_clear_pointer (&priv->icon_deferred_preferred, g_free);
+
 	if (GTK_IS_WIDGET (priv->widget))
 	{
 		gtk_widget_destroy (GTK_WIDGET (priv->widget));
@@ -1993,39 +2424,45 @@ bubble_dispose (GObject* gobject)
 		priv->sender = NULL;
 	}
 
+	if (priv->app_name)
+	{
+		g_free ((gpointer) priv->app_name);
+		priv->app_name = NULL;
+	}
+
 	if (priv->icon_pixbuf)
 	{
 		g_object_unref (priv->icon_pixbuf);
 		priv->icon_pixbuf = NULL;
 	}
 
-	if (priv->alpha)
+	if (priv->icon_surface)
 	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
+		cairo_surface_destroy (priv->icon_surface);
+		priv->icon_surface = NULL;
 	}
 
-	if (priv->timeline)
+	if (priv->animation)
 	{
-		g_object_unref (priv->timeline);
-		priv->timeline = NULL;
+		animation_stop (priv->animation);
+		priv->animation = NULL;
 	}
 
-	if (priv->pointer_update_id)
+	if (priv->hover)
 	{
-		g_source_remove (priv->pointer_update_id);
-		priv->pointer_update_id = 0;
+		animation_stop (priv->hover);
+		priv->hover = NULL;
 	}
 
-	if (priv->draw_handler_id)
+	if (priv->opacity_dirty)
 	{
-		g_source_remove (priv->draw_handler_id);
-		priv->draw_handler_id = 0;
+		g_opacity_dirty = g_slist_remove (g_opacity_dirty, gobject);
+		priv->opacity_dirty = FALSE;
 	}
 
 	if (priv->timer_id)
 	{
-		g_source_remove (priv->timer_id);
+		timer_wheel_remove (priv->timer_id);
 		priv->timer_id = 0;
 	}
 
@@ -2102,8 +2539,17 @@ bubble_init (Bubble* self)
 	priv->value                      = -2;
 	priv->synchronous                = NULL;
 	priv->sender                     = NULL;
-	priv->draw_handler_id            = 0;
-	priv->pointer_update_id          = 0;
+	priv->app_name                   = NULL;
+	priv->fade_out_time              = 300;
+	priv->backlog_depth              = 0;
+	priv->animation                  = NULL;
+	priv->hover                      = NULL;
+	priv->icon_pending               = FALSE;
+	priv->icon_cancellable           = NULL;
+	priv->icon_wait_id               = 0;
+	priv->icon_deferred              = NULL;
+	priv->icon_deferred_preferred    = NULL;
+	priv->notify_time                = 0;
 }
 
 static void
@@ -2177,6 +2623,17 @@ bubble_class_init (BubbleClass* klass)
 		G_TYPE_NONE,
 		1,
         G_TYPE_STRING);
+
+	g_bubble_signals[ICON_READY] = g_signal_new (
+		"icon-ready",
+		G_OBJECT_CLASS_TYPE (gobject_class),
+		G_SIGNAL_RUN_LAST,
+		G_STRUCT_OFFSET (BubbleClass, icon_ready),
+		NULL,
+		NULL,
+		g_cclosure_marshal_VOID__VOID,
+		G_TYPE_NONE,
+		0);
 }
 
 //-- public API ----------------------------------------------------------------
@@ -2265,15 +2722,26 @@ bubble_new (Defaults* defaults)
 	this->priv->title_needs_refresh        = FALSE;
 	this->priv->message_body_needs_refresh = FALSE;
 	this->priv->icon_pixbuf                = NULL;
+	this->priv->icon_surface               = NULL;
+	this->priv->icon_tile_size             = 0;
 	this->priv->value                      = -2;
 	this->priv->visible                    = FALSE;
 	this->priv->timeout                    = 5000;
 	this->priv->mouse_over                 = FALSE;
 	this->priv->distance                   = 1.0f;
+	this->priv->painted_distance           = -1.0f;
+	this->priv->opacity                    = 0.0f;
+	this->priv->applied_alpha              = 0;
+	this->priv->opacity_dirty              = FALSE;
+	this->priv->blur_xid                   = 0;
+	this->priv->shape_width                = -1;
+	this->priv->shape_height               = -1;
+	this->priv->shape_mouse_over           = FALSE;
+	this->priv->shape_composited           = FALSE;
 	this->priv->composited                 = gdk_screen_is_composited (
 						gtk_widget_get_screen (window));
-	this->priv->alpha                      = NULL;
-	this->priv->timeline                   = NULL;
+	this->priv->animation                  = NULL;
+	this->priv->hover                      = NULL;
 	this->priv->title_width                = 0;
 	this->priv->title_height               = 0;
 	this->priv->body_width                 = 0;
@@ -2310,6 +2778,14 @@ bubble_get_sender (Bubble* self)
 	return GET_PRIVATE (self)->sender;
 }
 
+gchar*
+bubble_get_app_name (Bubble* self)
+{
+	g_return_val_if_fail (IS_BUBBLE (self), NULL);
+
+	return GET_PRIVATE (self)->app_name;
+}
+
 void
 bubble_set_title (Bubble*      self,
 		  const gchar* title)
@@ -2397,45 +2873,276 @@ bubble_get_message_body (Bubble* self)
 	return GET_PRIVATE (self)->message_body->str;
 }
 
-void
-bubble_set_icon_from_path (Bubble*      self,
-			   const gchar* filepath)
+// the icon-cache is shared by all bubbles, on a hit the (already blurred)
+// icon-tile is simply referenced, so neither decoding nor _refresh_icon() are
+// needed for icons we have seen before
+static gboolean
+_set_icon_from_cache (Bubble*      self,
+		      const gchar* name,
+		      gint         icon_size)
 {
-	Defaults*      d;
-	BubblePrivate* priv;
+	BubblePrivate* priv = GET_PRIVATE (self);
+	GdkPixbuf*     pixbuf;
+	tile_t*        tile;
 
-	if (!self || !IS_BUBBLE (self) || !g_strcmp0 (filepath, ""))
-		return;
+	if (!icon_cache_lookup (name, icon_size, &pixbuf, &tile))
+		return FALSE;
 
-	priv = GET_PRIVATE (self);
+	if (priv->tile_icon)
+		tile_destroy (priv->tile_icon);
 
-	// check if an app tries to set the same file as icon again, this check
-	// avoids superfluous regeneration of the tile/blur-cache for the icon,
-	// thus it improves performance in update- and append-cases
-	if (!g_strcmp0 (priv->old_icon_filename->str, filepath))
-		return;
+	priv->icon_pixbuf    = pixbuf;
+	priv->tile_icon      = tile;
+	priv->icon_tile_size = icon_size;
 
-	// store the new icon-basename
-	g_string_assign (priv->old_icon_filename, filepath);
+	return TRUE;
+}
 
-	if (priv->icon_pixbuf)
+static void
+_cancel_icon_load (Bubble* self)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+
+	if (priv->icon_cancellable)
 	{
-		g_object_unref (priv->icon_pixbuf);
-		priv->icon_pixbuf = NULL;
+		g_cancellable_cancel (priv->icon_cancellable);
+		g_object_unref (priv->icon_cancellable);
+		priv->icon_cancellable = NULL;
+	}
+
+	if (priv->icon_wait_id)
+	{
+		g_source_remove (priv->icon_wait_id);
+		priv->icon_wait_id = 0;
 	}
 
-	d = self->defaults;
-	priv->icon_pixbuf = load_icon (filepath,
-				       EM2PIXELS (defaults_get_icon_size (d), d));
+	priv->icon_pending = FALSE;
 
-	_refresh_icon (self);
+	g_clear_pointer (&priv->icon_deferred, g_free);
+	g_clear_pointer (&priv->icon_deferred_preferred, g_free);
 }
 
-void
+static void
+_clear_icon (Bubble* self)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+
+	_cancel_icon_load (self);
+
+	if (priv->icon_pixbuf)
+	{
+		g_object_unref (priv->icon_pixbuf);
+		priv->icon_pixbuf = NULL;
+	}
+
+	if (priv->icon_surface)
+	{
+		cairo_surface_destroy (priv->icon_surface);
+		priv->icon_surface = NULL;
+	}
+
+	// new source, the old tile_icon must not be painted until the new one
+	// is rendered, nor after the new one failed to load
+	if (priv->tile_icon)
+	{
+		tile_destroy (priv->tile_icon);
+		priv->tile_icon = NULL;
+	}
+	priv->icon_tile_size = 0;
+}
+
+// the synchronous counterpart of load_icon_async(), done when the bubble is
+// laid out, after the D-Bus reply went out
+static void
+_load_deferred_icon (Bubble* self)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+	Defaults*      d    = self->defaults;
+	gint           icon_size;
+
+	if (!priv->icon_deferred)
+		return;
+
+	icon_size = EM2PIXELS (defaults_get_icon_size (d), d);
+
+	if (priv->icon_deferred_preferred)
+		priv->icon_pixbuf = load_icon (priv->icon_deferred_preferred,
+					       icon_size);
+	if (!priv->icon_pixbuf)
+		priv->icon_pixbuf = load_icon (priv->icon_deferred, icon_size);
+
+	_refresh_icon (self);
+	icon_cache_insert (priv->icon_deferred,
+			   icon_size,
+			   priv->icon_pixbuf,
+			   priv->tile_icon);
+
+	g_clear_pointer (&priv->icon_deferred, g_free);
+	g_clear_pointer (&priv->icon_deferred_preferred, g_free);
+}
+
+typedef struct _IconLoadData
+{
+	Bubble*       bubble;
+	GCancellable* cancellable;
+	gchar*        name;
+	gint          icon_size;
+} IconLoadData;
+
+static void
+_icon_loaded_cb (GObject*      source G_GNUC_UNUSED,
+		 GAsyncResult* result,
+		 gpointer      user_data)
+{
+	IconLoadData*  data   = (IconLoadData*) user_data;
+	GError*        error  = NULL;
+	GdkPixbuf*     pixbuf = NULL;
+	BubblePrivate* priv;
+
+	pixbuf = load_icon_finish (result, &error);
+
+	// bubble is gone or got another icon in the meantime, don't touch it
+	if (g_cancellable_is_cancelled (data->cancellable))
+	{
+		if (pixbuf)
+			g_object_unref (pixbuf);
+		if (error)
+			g_error_free (error);
+		goto out;
+	}
+
+	priv = GET_PRIVATE (data->bubble);
+
+	g_object_unref (priv->icon_cancellable);
+	priv->icon_cancellable = NULL;
+	if (priv->icon_wait_id)
+	{
+		g_source_remove (priv->icon_wait_id);
+		priv->icon_wait_id = 0;
+	}
+	priv->icon_pending = FALSE;
+
+	if (error)
+	{
+		g_warning ("loading icon '%s' caused error: '%s'",
+			   data->name,
+			   error->message);
+		g_error_free (error);
+	}
+	else
+	{
+		priv->icon_pixbuf = pixbuf;
+		_refresh_icon (data->bubble);
+		icon_cache_insert (data->name,
+				   data->icon_size,
+				   priv->icon_pixbuf,
+				   priv->tile_icon);
+	}
+
+	g_signal_emit (data->bubble, g_bubble_signals[ICON_READY], 0);
+
+out:
+	g_object_unref (data->cancellable);
+	g_free (data->name);
+	g_free (data);
+}
+
+static gboolean
+_icon_wait_expired (Bubble* self)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+
+	// give up waiting, bubble is shown without icon, should the icon still
+	// arrive later, it will trigger another "icon-ready"
+	priv->icon_wait_id = 0;
+	priv->icon_pending = FALSE;
+	g_signal_emit (self, g_bubble_signals[ICON_READY], 0);
+
+	return FALSE;
+}
+
+// name is what the application asked for and the key for the icon-cache,
+// if preferred is non-NULL it's tried first and name only as fallback
+static void
+_set_icon (Bubble*      self,
+	   const gchar* name,
+	   const gchar* preferred)
+{
+	BubblePrivate* priv = GET_PRIVATE (self);
+	Defaults*      d    = self->defaults;
+	gint           icon_size;
+	IconLoadData*  data;
+
+	_clear_icon (self);
+
+	// there's no prefixed theme-name for a file, and with one tried first
+	// the path would only end up as fallback for the theme-lookup
+	if (name[0] == '/' || !strncmp (name, "file://", 7))
+		preferred = NULL;
+
+	icon_size = EM2PIXELS (defaults_get_icon_size (d), d);
+
+	if (_set_icon_from_cache (self, name, icon_size))
+		return;
+
+	// synchronous bubbles (volume, brightness...) are updated in quick
+	// succession and have to reflect the change immediately, that's when
+	// they are laid out, see _load_deferred_icon()
+	if (priv->synchronous || BUBBLE_ICON_LOAD_TIMEOUT <= 0)
+	{
+		priv->icon_deferred           = g_strdup (name);
+		priv->icon_deferred_preferred = g_strdup (preferred);
+		return;
+	}
+
+	priv->icon_cancellable = g_cancellable_new ();
+	priv->icon_pending     = TRUE;
+
+	data              = g_new0 (IconLoadData, 1);
+	data->bubble      = self;
+	data->cancellable = g_object_ref (priv->icon_cancellable);
+	data->name        = g_strdup (name);
+	data->icon_size   = icon_size;
+
+	load_icon_async (preferred ? preferred : name,
+			 preferred ? name : NULL,
+			 icon_size,
+			 priv->icon_cancellable,
+			 _icon_loaded_cb,
+			 data);
+
+	priv->icon_wait_id = g_timeout_add (BUBBLE_ICON_LOAD_TIMEOUT,
+					    (GSourceFunc) _icon_wait_expired,
+					    self);
+}
+
+void
+bubble_set_icon_from_path (Bubble*      self,
+			   const gchar* filepath)
+{
+	BubblePrivate* priv;
+
+	if (!self || !IS_BUBBLE (self) || !g_strcmp0 (filepath, ""))
+		return;
+
+	priv = GET_PRIVATE (self);
+
+	// check if an app tries to set the same file as icon again, this check
+	// avoids superfluous regeneration of the tile/blur-cache for the icon,
+	// thus it improves performance in update- and append-cases
+	if (!g_strcmp0 (priv->old_icon_filename->str, filepath))
+		return;
+
+	// store the new icon-basename
+	g_string_assign (priv->old_icon_filename, filepath);
+
+	_set_icon (self, filepath, NULL);
+}
+
+void
 bubble_set_icon (Bubble*      self,
 		 const gchar* filename)
 {
-	Defaults*      d;
 	BubblePrivate* priv;
 #ifdef TEMPORARY_ICON_PREFIX_WORKAROUND
 	gchar*         notify_osd_iconname;
@@ -2457,127 +3164,82 @@ bubble_set_icon (Bubble*      self,
 	// store the new icon-basename
 	g_string_assign (priv->old_icon_filename, filename);
 
-	if (priv->icon_pixbuf)
-	{
-		g_object_unref (priv->icon_pixbuf);
-		priv->icon_pixbuf = NULL;
-	}
-
-	d = self->defaults;
-
 #ifdef TEMPORARY_ICON_PREFIX_WORKAROUND
 	notify_osd_iconname = g_strdup_printf (NOTIFY_OSD_ICON_PREFIX "-%s",
 					       filename);
-	priv->icon_pixbuf = load_icon (notify_osd_iconname,
-				       EM2PIXELS (defaults_get_icon_size (d),
-						  d));
+	_set_icon (self, filename, notify_osd_iconname);
 	g_free (notify_osd_iconname);
+#else
+	_set_icon (self, filename, NULL);
 #endif
-
-	// fallback to non-notify-osd name
-	if (!priv->icon_pixbuf)
-		priv->icon_pixbuf = load_icon (filename,
-					       EM2PIXELS (defaults_get_icon_size (d), d));
-
-	_refresh_icon (self);
 }
 
-static GdkPixbuf *
-scale_pixbuf (const GdkPixbuf *pixbuf, gint size)
+void
+bubble_set_icon_from_pixbuf (Bubble*    self,
+			     GdkPixbuf* pixbuf)
 {
-	GdkPixbuf *scaled_icon;
-	GdkPixbuf *new_icon;
-	gint w, h, dest_x, dest_y, new_width, new_height, max_edge;
-
-	dest_x = dest_y = 0;
-
-	w = gdk_pixbuf_get_width (pixbuf);
-	h = gdk_pixbuf_get_height (pixbuf);
-
-	max_edge = MAX (w, h);
-
-	// temporarily cast to float so we don't end up missing fractional parts
-	// from the division, especially nasty for 0.something :)
-	// e.g.: 99 / 100 = 0 but 99.0 / 100.0 = 0.99
-	new_width = size * ((gfloat) w / (gfloat) max_edge);
-	new_height =  size * ((gfloat) h / (gfloat) max_edge);
-
-	/* Scale the pixbuf down, preserving the aspect ratio */
-	scaled_icon = gdk_pixbuf_scale_simple (pixbuf,
-					       new_width,
-					       new_height,
-					       GDK_INTERP_BILINEAR);
-
-	if (w == h)
-		return scaled_icon;
+	BubblePrivate* priv;
 
-	/* Create a square pixbuf with an alpha channel */
-	new_icon = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (scaled_icon),
-				   TRUE,
-				   gdk_pixbuf_get_bits_per_sample (scaled_icon),
-				   size, size);
+ 	if (!self || !IS_BUBBLE (self) || !pixbuf)
+		return;
 
-	/* Clear the pixbuf so it is transparent */
-	gdk_pixbuf_fill (new_icon, 0x00000000);
+	priv = GET_PRIVATE (self);
 
-	/* Center the rectangular pixbuf inside the transparent square */
-	if (new_width > new_height)
-		dest_y = (new_width - new_height) / 2;
-	else
-		dest_x = (new_height - new_width) / 2;
+	// "reset" the stored the icon-filename, fixes LP: #451086
+	g_string_assign (priv->old_icon_filename, "\0");
 
-	/* Copy the rectangular pixbuf into the new pixbuf at a centered position */
-	gdk_pixbuf_copy_area (scaled_icon,
-			      0, 0,
-			      gdk_pixbuf_get_width (scaled_icon),
-			      gdk_pixbuf_get_height (scaled_icon),
-			      new_icon,
-			      dest_x, dest_y);
-	g_object_unref (scaled_icon);
+	_clear_icon (self);
 
-	return new_icon;
+	// kept at its original size, _refresh_icon() scales it as needed once
+	// the bubble is laid out
+	priv->icon_pixbuf = pixbuf;
 }
 
 void
-bubble_set_icon_from_pixbuf (Bubble*    self,
-			     GdkPixbuf* pixbuf)
+bubble_set_icon_from_image_data (Bubble*       self,
+				 gint          width,
+				 gint          height,
+				 gint          rowstride,
+				 gboolean      has_alpha,
+				 gint          bits_per_sample,
+				 gint          n_channels,
+				 const guchar* data,
+				 gsize         length)
 {
-	GdkPixbuf*     scaled;
-	gint           height;
-	gint           width;
 	Defaults*      d;
 	BubblePrivate* priv;
 
- 	if (!self || !IS_BUBBLE (self) || !pixbuf)
+	if (!self || !IS_BUBBLE (self) || !data)
 		return;
 
 	priv = GET_PRIVATE (self);
+	d    = self->defaults;
 
-	// "reset" the stored the icon-filename, fixes LP: #451086
+	// see bubble_set_icon_from_pixbuf()
 	g_string_assign (priv->old_icon_filename, "\0");
 
-	if (priv->icon_pixbuf)
-	{
-		g_object_unref (priv->icon_pixbuf);
-		priv->icon_pixbuf = NULL;
-	}
-
-	height = gdk_pixbuf_get_height (pixbuf);
-	width = gdk_pixbuf_get_width (pixbuf);
-
-	d = self->defaults;
-
-	if (width != defaults_get_icon_size (d) ||
-            height != defaults_get_icon_size (d))
+	_clear_icon (self);
+
+	// skips the intermediate pixbufs, the (multi-megabyte) avatar is only
+	// read once and written straight into the surface the icon-tile uses
+	priv->icon_surface = image_data_to_surface (
+				width,
+				height,
+				rowstride,
+				has_alpha,
+				bits_per_sample,
+				n_channels,
+				data,
+				length,
+				EM2PIXELS (defaults_get_icon_size (d), d),
+				BUBBLE_CONTENT_BLUR_RADIUS);
+	if (!priv->icon_surface)
 	{
-		scaled = scale_pixbuf (pixbuf, EM2PIXELS (defaults_get_icon_size (d), d));
-		g_object_unref (pixbuf);
-		pixbuf = scaled;
+		g_warning ("image_data hint has invalid format or size\n");
+		return;
 	}
 
-	priv->icon_pixbuf = pixbuf;
-
-	_refresh_icon (self);
+	// the icon-tile is rendered along with the layout of the bubble
 }
 
 GdkPixbuf*
@@ -2588,6 +3250,25 @@ bubble_get_icon_pixbuf (Bubble *self)
 	return GET_PRIVATE (self)->icon_pixbuf;
 }
 
+void
+bubble_set_notify_time (Bubble* self,
+			gint64  notify_time)
+{
+	if (!self || !IS_BUBBLE (self))
+		return;
+
+	GET_PRIVATE (self)->notify_time = notify_time;
+}
+
+gboolean
+bubble_is_icon_pending (Bubble* self)
+{
+	if (!self || !IS_BUBBLE (self))
+		return FALSE;
+
+	return GET_PRIVATE (self)->icon_pending;
+}
+
 void
 bubble_set_value (Bubble* self,
 		  gint    value)
@@ -2654,6 +3335,26 @@ bubble_set_timeout (Bubble* self,
 	GET_PRIVATE (self)->timeout = timeout;
 }
 
+void
+bubble_set_backlog_depth (Bubble* self,
+			  guint   depth)
+{
+	if (!self || !IS_BUBBLE (self))
+		return;
+
+	GET_PRIVATE (self)->backlog_depth = depth;
+}
+
+void
+bubble_set_fade_out_time (Bubble* self,
+			  guint   msecs)
+{
+	if (!self || !IS_BUBBLE (self))
+		return;
+
+	GET_PRIVATE (self)->fade_out_time = msecs;
+}
+
 /* a timeout of 0 doesn't make much sense now does it, thus 0 indicates an
 ** error */
 guint
@@ -2675,7 +3376,7 @@ bubble_set_timer_id (Bubble* self,
 	GET_PRIVATE(self)->timer_id = timer_id;
 }
 
-/* a valid GLib timer-id is always > 0, thus 0 indicates an error */
+/* a valid timer-wheel id is always > 0, thus 0 indicates an error */
 guint
 bubble_get_timer_id (Bubble* self)
 {
@@ -2743,75 +3444,71 @@ bubble_move (Bubble* self,
 }
 
 static void
-glow_completed_cb (EggTimeline *timeline,
-		   Bubble *bubble)
+_stop_animation (Bubble* self)
 {
-	BubblePrivate* priv;
-
-	g_return_if_fail (IS_BUBBLE (bubble));
-
-	priv = GET_PRIVATE (bubble);
-
-	/* get rid of the alpha, so that the mouse-over algorithm notices */
-	if (priv->alpha)
-	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
-	}
+	BubblePrivate* priv = GET_PRIVATE (self);
 
-	if (priv->timeline)
+	if (priv->animation)
 	{
-		g_object_unref (priv->timeline);
-		priv->timeline = NULL;
+		animation_stop (priv->animation);
+		priv->animation = NULL;
 	}
 }
 
 static void
-glow_cb (EggTimeline *timeline,
-	 gint frame_no,
-	 Bubble *bubble)
+glow_completed_cb (Animation* animation,
+		   gpointer   data)
 {
+	Bubble* bubble = (Bubble*) data;
+
 	g_return_if_fail (IS_BUBBLE (bubble));
 
-	bubble_refresh (bubble);
+	/* get rid of the animation, so that the mouse-over algorithm notices */
+	GET_PRIVATE (bubble)->animation = NULL;
+}
+
+static void
+glow_cb (Animation* animation,
+	 gdouble    value,
+	 gpointer   data)
+{
+	g_return_if_fail (IS_BUBBLE (data));
+
+	bubble_refresh (BUBBLE (data));
 }
 
 static void
 bubble_start_glow_effect (Bubble *self,
 			  guint   msecs)
 {
-	EggTimeline*   timeline;
 	BubblePrivate* priv;
 
 	g_return_if_fail (IS_BUBBLE (self));
 
 	priv = GET_PRIVATE (self);
 
-	timeline = egg_timeline_new_for_duration (msecs);
-	egg_timeline_set_speed (timeline, FPS);
-	priv->timeline = timeline;
-
-	if (priv->alpha != NULL)
-	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
-	}
+	_stop_animation (self);
+	priv->animation = animation_start (msecs,
+					   EGG_ALPHA_RAMP_DEC,
+					   glow_cb,
+					   glow_completed_cb,
+					   self);
+}
 
-	priv->alpha = egg_alpha_new_full (timeline,
-					  EGG_ALPHA_RAMP_DEC,
-					  NULL,
-					  NULL);
+// pointer-proximity and the mouse-over fading are polled once per frame for
+// as long as the bubble is shown
+static void
+hover_cb (Animation* animation,
+	  gdouble    value,
+	  gpointer   data)
+{
+	Bubble* bubble = (Bubble*) data;
 
-	g_signal_connect (G_OBJECT (timeline),
-			  "completed",
-			  G_CALLBACK (glow_completed_cb),
-			  self);
-	g_signal_connect (G_OBJECT (timeline),
-			  "new-frame",
-			  G_CALLBACK (glow_cb),
-			  self);
+	if (pointer_update (bubble) && redraw_handler (bubble))
+		return;
 
-	egg_timeline_start (timeline);
+	animation_stop (animation);
+	GET_PRIVATE (bubble)->hover = NULL;
 }
 
 void
@@ -2834,15 +3531,10 @@ bubble_show (Bubble* self)
 	else
 		priv->prevent_fade = FALSE;
 
-	// FIXME: do nasty busy-polling rendering in the drawing-area
-	priv->draw_handler_id = g_timeout_add (1000/FPS,
-					       (GSourceFunc) redraw_handler,
-					       self);
-
-	// FIXME: read out current mouse-pointer position every 1/25 second
-        priv->pointer_update_id = g_timeout_add (1000/FPS,
-						 (GSourceFunc) pointer_update,
-						 self);
+	// FIXME: do nasty busy-polling of the mouse-pointer position and
+	// rendering in the drawing-area, at least it's on the shared frame-clock
+	if (!priv->hover)
+		priv->hover = animation_start (0, NULL, hover_cb, NULL, self);
 }
 
 /* mostly called when we change the content of the bubble
@@ -2873,31 +3565,34 @@ bubble_get_window (Bubble *bubble)
 }
 
 static void
-fade_cb (EggTimeline *timeline,
-	 gint frame_no,
-	 Bubble *bubble)
+fade_cb (Animation* animation,
+	 gdouble    value,
+	 gpointer   data)
 {
-	float opacity;
+	Bubble* bubble = (Bubble*) data;
+	float   opacity;
 
 	g_return_if_fail (IS_BUBBLE (bubble));
 
-	opacity = (float)egg_alpha_get_alpha (GET_PRIVATE (bubble)->alpha)
-		/ (float)EGG_ALPHA_MAX_ALPHA
-		* WINDOW_MAX_OPACITY;
+	opacity = value * WINDOW_MAX_OPACITY;
 
 	if (bubble_is_mouse_over (bubble))
-		gtk_window_set_opacity (bubble_get_window (bubble),
-		                        WINDOW_MIN_OPACITY);
+		_set_opacity (bubble, WINDOW_MIN_OPACITY);
 	else
-		gtk_window_set_opacity (bubble_get_window (bubble), opacity);
+		_set_opacity (bubble, opacity);
 }
 
 static void
-fade_out_completed_cb (EggTimeline *timeline,
-		       Bubble *bubble)
+fade_out_completed_cb (Animation* animation,
+		       gpointer   data)
 {
+	Bubble* bubble = (Bubble*) data;
+
 	g_return_if_fail (IS_BUBBLE (bubble));
 
+	GET_PRIVATE (bubble)->animation = NULL;
+	trace_mark (TRACE_FADE_OUT_STOP, bubble_get_id (bubble));
+
 	bubble_hide (bubble);
 
 	dbus_send_close_signal (bubble_get_sender (bubble),
@@ -2908,34 +3603,25 @@ fade_out_completed_cb (EggTimeline *timeline,
 
 
 static void
-fade_in_completed_cb (EggTimeline* timeline,
-		      Bubble*      bubble)
+fade_in_completed_cb (Animation* animation,
+		      gpointer   data)
 {
+	Bubble*        bubble = (Bubble*) data;
 	BubblePrivate* priv;
 
 	g_return_if_fail (IS_BUBBLE (bubble));
 
 	priv = GET_PRIVATE (bubble);
 
-	/* get rid of the alpha, so that the mouse-over algorithm notices */
-	if (priv->alpha)
-	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
-	}
+	trace_mark (TRACE_FADE_IN_STOP, priv->id);
 
-	if (priv->timeline)
-	{
-		g_object_unref (priv->timeline);
-		priv->timeline = NULL;
-	}
+	/* get rid of the animation, so that the mouse-over algorithm notices */
+	priv->animation = NULL;
 
 	if (bubble_is_mouse_over (bubble))
-		gtk_window_set_opacity (bubble_get_window (bubble),
-		                        WINDOW_MIN_OPACITY);
+		_set_opacity (bubble, WINDOW_MIN_OPACITY);
 	else
-		gtk_window_set_opacity (bubble_get_window (bubble),
-		                        WINDOW_MAX_OPACITY);
+		_set_opacity (bubble, WINDOW_MAX_OPACITY);
 
 	bubble_start_timer (bubble, TRUE);
 }
@@ -2944,7 +3630,6 @@ void
 bubble_fade_in (Bubble* self,
 		guint   msecs)
 {
-	EggTimeline*   timeline;
 	BubblePrivate* priv;
 
 	g_return_if_fail (IS_BUBBLE (self));
@@ -2954,38 +3639,23 @@ bubble_fade_in (Bubble* self,
 	if (!bubble_is_composited (self)
 	    || msecs == 0)
 	{
+		// the window was created (or left by a fade-out) at opacity 0
+		_set_opacity_now (self, WINDOW_MAX_OPACITY);
+
 		bubble_show (self);
 		bubble_start_timer (self, TRUE);
 		return;
 	}
 
-	timeline = egg_timeline_new_for_duration (msecs);
-	egg_timeline_set_speed (timeline, FPS);
-
-	if (priv->alpha != NULL)
-	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
-	}
-
-	priv->alpha = egg_alpha_new_full (timeline,
-					  EGG_ALPHA_RAMP_INC,
-					  NULL,
-					  NULL);
-
-	g_signal_connect (G_OBJECT (timeline),
-			  "completed",
-			  G_CALLBACK (fade_in_completed_cb),
-			  self);
-
-	g_signal_connect (G_OBJECT (timeline),
-			  "new-frame",
-			  G_CALLBACK (fade_cb),
-			  self);
-
-	egg_timeline_start (timeline);
+	_stop_animation (self);
+	trace_mark (TRACE_FADE_IN_START, priv->id);
+	priv->animation = animation_start (msecs,
+					   EGG_ALPHA_RAMP_INC,
+					   fade_cb,
+					   fade_in_completed_cb,
+					   self);
 
-	gtk_window_set_opacity (bubble_get_window (self), 0.0f);
+	_set_opacity_now (self, 0.0f);
 
 	bubble_show (self);
 }
@@ -2994,38 +3664,19 @@ void
 bubble_fade_out (Bubble* self,
 		 guint   msecs)
 {
-	EggTimeline*   timeline;
 	BubblePrivate* priv;
 
 	g_return_if_fail (IS_BUBBLE (self));
 
 	priv = GET_PRIVATE (self);
 
-	timeline = egg_timeline_new_for_duration (msecs);
-	egg_timeline_set_speed (timeline, FPS);
-	priv->timeline = timeline;
-
-	if (priv->alpha != NULL)
-	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
-	}
-
-	priv->alpha = egg_alpha_new_full (timeline,
-					  EGG_ALPHA_RAMP_DEC,
-					  NULL,
-					  NULL);
-
-	g_signal_connect (G_OBJECT (timeline),
-			  "completed",
-			  G_CALLBACK (fade_out_completed_cb),
-			  self);
-	g_signal_connect (G_OBJECT (timeline),
-			  "new-frame",
-			  G_CALLBACK (fade_cb),
-			  self);
-
-	egg_timeline_start (timeline);
+	_stop_animation (self);
+	trace_mark (TRACE_FADE_OUT_START, priv->id);
+	priv->animation = animation_start (msecs,
+					   EGG_ALPHA_RAMP_DEC,
+					   fade_cb,
+					   fade_out_completed_cb,
+					   self);
 }
 
 gboolean
@@ -3033,9 +3684,10 @@ bubble_timed_out (Bubble* self)
 {
 	g_return_val_if_fail (IS_BUBBLE (self), FALSE);
 
-	if (GET_PRIVATE (self)->composited)
+	if (GET_PRIVATE (self)->composited &&
+	    GET_PRIVATE (self)->fade_out_time > 0)
 	{
-		bubble_fade_out (self, 300);
+		bubble_fade_out (self, GET_PRIVATE (self)->fade_out_time);
 		return FALSE;
 	}
 
@@ -3065,17 +3717,12 @@ bubble_hide (Bubble* self)
 
 	priv->timeout = 0;
 
-	if (priv->timeline)
-	{
-		egg_timeline_stop (priv->timeline);
-		g_object_unref (priv->timeline);
-		priv->timeline = NULL;
-	}
+	_stop_animation (self);
 
-	if (priv->alpha)
+	if (priv->hover)
 	{
-		g_object_unref (priv->alpha);
-		priv->alpha = NULL;
+		animation_stop (priv->hover);
+		priv->hover = NULL;
 	}
 }
 
@@ -3107,11 +3754,23 @@ bubble_is_visible (Bubble* self)
 	return GET_PRIVATE (self)->visible;
 }
 
+static gboolean
+_timer_expired_cb (gpointer data)
+{
+	Bubble* self = (Bubble*) data;
+
+	/* the timer-wheel drops the timer once this returns */
+	GET_PRIVATE (self)->timer_id = 0;
+
+	return bubble_timed_out (self);
+}
+
 void
 bubble_start_timer (Bubble*  self,
 		    gboolean trigger)
 {
 	guint          timer_id;
+	guint          timeout;
 	BubblePrivate* priv;
 
 	if (!self || !IS_BUBBLE (self))
@@ -3119,19 +3778,20 @@ bubble_start_timer (Bubble*  self,
 
 	priv = GET_PRIVATE (self);
 
+	/* scale a copy, priv->timeout stays what the client asked for so a
+	** replace or append doesn't shorten an already shortened timeout */
+	timeout = backlog_scale_timeout (priv->timeout, priv->backlog_depth);
+
+	/* and now let the timer tick... all bubbles share one timer-wheel, so
+	** (re)starting a timer, e.g. when syncing bubbles, just moves it to
+	** another slot instead of creating and destroying GSources */
 	timer_id = bubble_get_timer_id (self);
-	if (timer_id > 0)
-		g_source_remove (timer_id);
-
-	/* and now let the timer tick... we use g_timeout_add_seconds() here
-	** because for the bubble timeouts microsecond-precise resolution is not
-	** needed, furthermore this also allows glib more room for optimizations
-	** and improve system-power-usage to be more efficient */
-	bubble_set_timer_id (
-		self,
-		g_timeout_add_seconds (bubble_get_timeout (self) / 1000,
-				       (GSourceFunc) bubble_timed_out,
-				       self));
+	if (!timer_wheel_reschedule (timer_id, timeout))
+		bubble_set_timer_id (
+			self,
+			timer_wheel_add (timeout,
+					 _timer_expired_cb,
+					 self));
 
 	/* if the bubble is displaying a value that is out of bounds
 	   trigger a dim/glow animation */
@@ -3151,7 +3811,7 @@ bubble_clear_timer (Bubble* self)
 	timer_id = GET_PRIVATE(self)->timer_id;
 
 	if (timer_id > 0) {
-		g_source_remove (timer_id);
+		timer_wheel_remove (timer_id);
 		bubble_set_timer_id(self, 0);
 	}
 }
@@ -3234,13 +3894,11 @@ _calc_title_height (Bubble* self,
 	g_free ((gpointer) text_font_face);
 
 	// make sure system-wide font-options like hinting, antialiasing etc.
-	// are taken into account
-	pango_cairo_context_set_font_options (
-		pango_layout_get_context (layout),
-		gdk_screen_get_font_options (
-			gtk_widget_get_screen (priv->widget)));
+	// are taken into account, offscreen bubbles use fixed ones instead
+	pango_cairo_context_set_font_options (pango_layout_get_context (layout),
+					      _get_font_options (self));
 	pango_cairo_context_set_resolution  (pango_layout_get_context (layout),
-					     defaults_get_screen_dpi (d));
+					     _get_dpi (self));
 	pango_layout_context_changed (layout);
 
 	pango_font_description_set_size (desc,
@@ -3275,6 +3933,7 @@ _calc_body_height (Bubble* self,
 		   gint    body_width /* requested text-width in pixels */)
 {
 	Defaults*             d;
+	cairo_surface_t*      surface;
 	cairo_t*              cr;
 	PangoFontDescription* desc    = NULL;
 	PangoLayout*          layout  = NULL;
@@ -3289,7 +3948,17 @@ _calc_body_height (Bubble* self,
 	d    = self->defaults;
 	priv = GET_PRIVATE (self);
 
-	cr = gdk_cairo_create (gtk_widget_get_window (priv->widget));
+	// only measuring here, so a scratch-surface will do and there's no need
+	// for the window to be realized
+	surface = cairo_image_surface_create (CAIRO_FORMAT_A1, 1, 1);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+		if (surface)
+			cairo_surface_destroy (surface);
+		return 0;
+	}
+
+	cr = cairo_create (surface);
+	cairo_surface_destroy (surface);
 	if (cairo_status (cr) != CAIRO_STATUS_SUCCESS) {
 		if (cr)
 			cairo_destroy (cr);
@@ -3302,13 +3971,11 @@ _calc_body_height (Bubble* self,
 	g_free ((gpointer) text_font_face);
 
 	// make sure system-wide font-options like hinting, antialiasing etc.
-	// are taken into account
-	pango_cairo_context_set_font_options (
-		pango_layout_get_context (layout),
-		gdk_screen_get_font_options (
-			gtk_widget_get_screen (priv->widget)));
+	// are taken into account, offscreen bubbles use fixed ones instead
+	pango_cairo_context_set_font_options (pango_layout_get_context (layout),
+					      _get_font_options (self));
 	pango_cairo_context_set_resolution  (pango_layout_get_context (layout),
-					     defaults_get_screen_dpi (d));
+					     _get_dpi (self));
 	pango_layout_context_changed (layout);
 
 	pango_font_description_set_size (desc,
@@ -3391,6 +4058,7 @@ bubble_recalc_size (Bubble *self)
  	gint		   y;
 	Defaults*      d;
 	BubblePrivate* priv;
+	gint64         start = g_get_monotonic_time ();
 
 	if (!self || !IS_BUBBLE (self))
 		return;
@@ -3398,20 +4066,11 @@ bubble_recalc_size (Bubble *self)
 	d    = self->defaults;
 	priv = GET_PRIVATE (self);
 
-	/* FIXME: a quick fix to rescale an icon (e.g. user changed font-size or
-	** DPI while a bubble is displayed, thus bubble is re-rendered and the
-	** icon needs to adapt to the new size) */
-	if (priv->icon_pixbuf)
-	{
-		GdkPixbuf *pixbuf;
-		pixbuf = gdk_pixbuf_scale_simple (
-					priv->icon_pixbuf,
-        	                        EM2PIXELS (defaults_get_icon_size (d), d),
-        	                        EM2PIXELS (defaults_get_icon_size (d), d),
-					GDK_INTERP_BILINEAR);
-		g_object_unref (priv->icon_pixbuf);
-		priv->icon_pixbuf = pixbuf;
-	}
+	/* renders the icon-tile for a new icon, or re-renders it from its source
+	** only if its pixel-size changed (e.g. user changed font-size or DPI
+	** while a bubble is displayed) */
+	_load_deferred_icon (self);
+	_refresh_icon (self);
 
 	bubble_determine_layout (self);
 
@@ -3589,7 +4248,75 @@ bubble_recalc_size (Bubble *self)
  		bubble_get_position(self, &x, &y);
  		bubble_move(self, x, y - (new_bubble_height - old_bubble_height));
  	}
- 	
+
+	trace_span (TRACE_RECALC_SIZE, priv->id, start);
+}
+
+void
+bubble_set_offscreen (Bubble*  self,
+		      gboolean offscreen)
+{
+	BubblePrivate* priv;
+
+	if (!self || !IS_BUBBLE (self))
+		return;
+
+	priv = GET_PRIVATE (self);
+
+	if (priv->offscreen == offscreen)
+		return;
+
+	priv->offscreen  = offscreen;
+	priv->composited = offscreen ||
+			   gdk_screen_is_composited (
+				gtk_widget_get_screen (priv->widget));
+
+	// text-tiles were rendered with other font-options and resolution
+	priv->title_needs_refresh        = TRUE;
+	priv->message_body_needs_refresh = TRUE;
+}
+
+gboolean
+bubble_is_offscreen (Bubble* self)
+{
+	if (!self || !IS_BUBBLE (self))
+		return FALSE;
+
+	return GET_PRIVATE (self)->offscreen;
+}
+
+cairo_surface_t*
+bubble_render_to_surface (Bubble* self,
+			  gdouble distance)
+{
+	cairo_surface_t* surface;
+	cairo_t*         cr;
+	gint             width;
+	gint             height;
+
+	if (!self || !IS_BUBBLE (self))
+		return NULL;
+
+	bubble_get_size (self, &width, &height);
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+					      width,
+					      height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_surface_destroy (surface);
+		return NULL;
+	}
+
+	cr = cairo_create (surface);
+	_render_frame (self, cr, CLAMP (distance, 0.0f, 1.0f));
+	cairo_destroy (cr);
+
+	cairo_surface_flush (surface);
+
+	return surface;
 }
 
 void
@@ -3624,6 +4351,20 @@ bubble_set_sender (Bubble *self,
 	priv->sender = g_strdup (sender);
 }
 
+void
+bubble_set_app_name (Bubble*      self,
+		     const gchar* app_name)
+{
+	BubblePrivate* priv;
+
+	g_return_if_fail (IS_BUBBLE (self));
+
+	priv = GET_PRIVATE (self);
+
+	g_free (priv->app_name);
+	priv->app_name = g_strdup (app_name);
+}
+
 gboolean
 bubble_is_synchronous (Bubble *self)
 {
@@ -3662,6 +4403,7 @@ void
 bubble_determine_layout (Bubble* self)
 {
 	BubblePrivate* priv;
+	gboolean       has_icon;
 
 	/* sanity test */
 	if (!self || !IS_BUBBLE (self))
@@ -3669,18 +4411,24 @@ bubble_determine_layout (Bubble* self)
 
 	priv = GET_PRIVATE (self);
 
+	/* a pending icon takes up the same space as a loaded one */
+	has_icon = priv->icon_pixbuf   != NULL ||
+		   priv->icon_surface  != NULL ||
+		   priv->icon_deferred != NULL ||
+		   priv->icon_pending;
+
 	/* set a sane default */
 	priv->layout = LAYOUT_NONE;
 
 	/* icon-only layout-case, e.g. eject */
-	if (priv->icon_only && priv->icon_pixbuf != NULL)
+	if (priv->icon_only && has_icon)
 	{
 		priv->layout = LAYOUT_ICON_ONLY;
 		return;
 	}
 
 	/* icon + indicator layout-case, e.g. volume */
-	if ((priv->icon_pixbuf       != NULL) &&
+	if ((has_icon) &&
 	    (priv->title->len        != 0) &&
 	    (priv->message_body->len == 0) &&
 	    (priv->value             >= -1))
@@ -3690,7 +4438,7 @@ bubble_determine_layout (Bubble* self)
 	}
 
 	/* icon + title layout-case, e.g. "Wifi signal lost" */
-	if ((priv->icon_pixbuf       != NULL) &&
+	if ((has_icon) &&
 	    (priv->title->len        != 0) &&
 	    (priv->message_body->len == 0) &&
 	    (priv->value             == -2))
@@ -3700,7 +4448,7 @@ bubble_determine_layout (Bubble* self)
 	}
 
 	/* icon/avatar + title + body/message layout-case, e.g. IM-message */
-	if ((priv->icon_pixbuf       != NULL) &&
+	if ((has_icon) &&
 	    (priv->title->len        != 0) &&
 	    (priv->message_body->len != 0) &&
 	    (priv->value             == -2))
@@ -3710,7 +4458,7 @@ bubble_determine_layout (Bubble* self)
 	}
 
 	/* title + body/message layout-case, e.g. IM-message without avatar */
-	if ((priv->icon_pixbuf       == NULL) &&
+	if ((!has_icon) &&
 	    (priv->title->len        != 0) &&
 	    (priv->message_body->len != 0) &&
 	    (priv->value             == -2))
@@ -3720,7 +4468,7 @@ bubble_determine_layout (Bubble* self)
 	}
 
 	/* title-only layout-case, use discouraged but needs to be supported */
-	if ((priv->icon_pixbuf       == NULL) &&
+	if ((!has_icon) &&
 	    (priv->title->len        != 0) &&
 	    (priv->message_body->len == 0) &&
 	    (priv->value             == -2))
@@ -3832,6 +4580,7 @@ bubble_sync_with (Bubble *self,
 
 	bubble_set_timeout (self,
 			    bubble_get_timeout (other));
+	bubble_set_backlog_depth (self, GET_PRIVATE (other)->backlog_depth);
 	bubble_start_timer (self, FALSE);
 	bubble_start_timer (other, FALSE);
 }
@@ -34,6 +34,7 @@
 
 #include <glib-object.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo.h>
 
 #include "defaults.h"
 
@@ -81,6 +82,7 @@ struct _BubbleClass
 	void (*value_changed) (Bubble* bubble);
 	void (*message_body_deleted) (Bubble* bubble);
 	void (*message_body_inserted) (Bubble* bubble);
+	void (*icon_ready) (Bubble* bubble);
 };
 
 GType bubble_get_type (void);
@@ -94,6 +96,9 @@ bubble_get_synchronous (Bubble *self);
 gchar*
 bubble_get_sender (Bubble *self);
 
+gchar*
+bubble_get_app_name (Bubble *self);
+
 void
 bubble_set_title (Bubble*      self,
 		  const gchar* title);
@@ -120,9 +125,31 @@ void
 bubble_set_icon_from_pixbuf (Bubble*      self,
 			     GdkPixbuf*   pixbuf);
 
+// raw pixels of the image_data hint, converted without intermediate pixbufs
+void
+bubble_set_icon_from_image_data (Bubble*       self,
+				 gint          width,
+				 gint          height,
+				 gint          rowstride,
+				 gboolean      has_alpha,
+				 gint          bits_per_sample,
+				 gint          n_channels,
+				 const guchar* data,
+				 gsize         length);
+
+// NULL for icons set via bubble_set_icon_from_image_data()
 GdkPixbuf*
 bubble_get_icon_pixbuf (Bubble *self);
 
+gboolean
+bubble_is_icon_pending (Bubble* self);
+
+// time (g_get_monotonic_time()) the Notify for this bubble was received, used
+// to account the latency until its first frame is drawn
+void
+bubble_set_notify_time (Bubble* self,
+			gint64  notify_time);
+
 void
 bubble_set_value (Bubble* self,
 		  gint    value);
@@ -147,6 +174,17 @@ bubble_set_timeout (Bubble* self,
 guint
 bubble_get_timeout (Bubble* self);
 
+// number of bubbles queued ahead when it was shown, bubble_start_timer()
+// shortens the timeout by it, bubble_get_timeout() still returns the original
+void
+bubble_set_backlog_depth (Bubble* self,
+			  guint   depth);
+
+// duration of the fade once the bubble timed out, 0 hides it right away
+void
+bubble_set_fade_out_time (Bubble* self,
+			  guint   msecs);
+
 void
 bubble_set_timer_id (Bubble* self,
 		     guint   timer_id);
@@ -209,6 +247,23 @@ bubble_get_future_height (Bubble *self);
 void
 bubble_recalc_size (Bubble *self);
 
+// an offscreen bubble lays out its text with fixed font-options and DPI
+// instead of those of the screen, always renders as if composited and is
+// meant to be drawn with bubble_render_to_surface() instead of being shown
+void
+bubble_set_offscreen (Bubble*  self,
+		      gboolean offscreen);
+
+gboolean
+bubble_is_offscreen (Bubble* self);
+
+// returns a new ARGB32 image-surface of the bubble's current size holding a
+// full frame at the given mouse-over distance (0.0: pointer on top of it,
+// 1.0: far away), NULL if the bubble has not been sized yet
+cairo_surface_t*
+bubble_render_to_surface (Bubble* self,
+			  gdouble distance);
+
 gboolean
 bubble_is_synchronous (Bubble *self);
 
@@ -220,6 +275,10 @@ void
 bubble_set_sender (Bubble *self,
 		   const gchar *sender);
 
+void
+bubble_set_app_name (Bubble *self,
+		     const gchar *app_name);
+
 gboolean
 bubble_is_urgent (Bubble *self);
 
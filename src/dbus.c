@@ -28,16 +28,16 @@
 
 #include <string.h>
 #include <stdlib.h>
-#include <dbus/dbus.h>
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-bindings.h>
-#include <dbus/dbus-glib-lowlevel.h>
+#include <gio/gio.h>
 
 #include "dbus.h"
 
-static DBusGConnection* connection = NULL;
+// see the D-Bus specification for RequestName
+#define DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER 1
 
-DBusGConnection*
+static GDBusConnection* connection = NULL;
+
+GDBusConnection*
 dbus_get_connection (void)
 {
 	/* usefull mostly for unit tests */
@@ -47,51 +47,82 @@ dbus_get_connection (void)
 	return connection;
 }
 
-DBusGConnection*
-dbus_create_service_instance (const char *service_name)
+GDBusConnection*
+dbus_connect (void)
 {
-	DBusGProxy*      proxy      = NULL;
-	guint            request_name_result;
-	GError*          error      = NULL;
+	GError* error = NULL;
+
+	if (connection)
+		return connection;
 
-	error = NULL;
-	connection = dbus_g_bus_get (DBUS_BUS_SESSION, &error);
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
 	if (error)
 	{
-		g_warning ("dbus_create_service_instance(): "
+		g_warning ("dbus_connect(): "
 		           "Got error \"%s\"\n",
 		           error->message);
 		g_error_free (error);
 		return NULL;
 	}
 
-	proxy = dbus_g_proxy_new_for_name (connection,
-					   "org.freedesktop.DBus",
-					   "/org/freedesktop/Dbus",
-					   "org.freedesktop.DBus");
-	error = NULL;
-	if (!dbus_g_proxy_call (proxy,
-				"RequestName",
-				&error,
-				G_TYPE_STRING, service_name,
-				G_TYPE_UINT, 0,
-				G_TYPE_INVALID,
-				G_TYPE_UINT, &request_name_result,
-				G_TYPE_INVALID))
+	return connection;
+}
+
+gboolean
+dbus_request_name (const char *service_name)
+{
+	GVariant* result = NULL;
+	GError*   error  = NULL;
+	guint     request_name_result;
+
+	if (!connection)
+		return FALSE;
+
+	// done synchronously on purpose, there's no point in starting up, if
+	// another instance already owns the name
+	result = g_dbus_connection_call_sync (connection,
+					      "org.freedesktop.DBus",
+					      "/org/freedesktop/DBus",
+					      "org.freedesktop.DBus",
+					      "RequestName",
+					      g_variant_new ("(su)",
+							     service_name,
+							     0),
+					      G_VARIANT_TYPE ("(u)"),
+					      G_DBUS_CALL_FLAGS_NONE,
+					      -1,
+					      NULL,
+					      &error);
+	if (!result)
 	{
-		g_warning ("dbus_create_service_instance(): "
+		g_warning ("dbus_request_name(): "
 		           "Got error \"%s\"\n",
 		           error->message);
 		g_error_free (error);
-		return NULL;
+		return FALSE;
 	}
 
+	g_variant_get (result, "(u)", &request_name_result);
+	g_variant_unref (result);
+
 	if (request_name_result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER)
 	{
 		g_warning ("Another instance has already registered %s", service_name);
-		return NULL;
+		return FALSE;
 	}
 
+	return TRUE;
+}
+
+GDBusConnection*
+dbus_create_service_instance (const char *service_name)
+{
+	if (!dbus_connect ())
+		return NULL;
+
+	if (!dbus_request_name (service_name))
+		return NULL;
+
 	return connection;
 }
 
@@ -101,22 +132,16 @@ dbus_send_close_signal (gchar *dest,
 			guint id, 
 			guint reason)
 {
-	DBusMessage *msg;
-
-	msg = dbus_message_new_signal ("/org/freedesktop/Notifications",
-				       "org.freedesktop.Notifications",
-				       "NotificationClosed");
-	dbus_message_set_destination (msg, dest);
-	dbus_message_append_args (msg, DBUS_TYPE_UINT32, &id,
-				  DBUS_TYPE_INVALID);
-	dbus_message_append_args (msg, DBUS_TYPE_UINT32, &reason,
-				  DBUS_TYPE_INVALID);
-
-	dbus_connection_send (dbus_g_connection_get_connection (connection),
-			      msg,
-			      NULL);
-
-	dbus_message_unref (msg);
+	if (!connection)
+		return;
+
+	g_dbus_connection_emit_signal (connection,
+				       dest,
+				       DBUS_PATH,
+				       DBUS_NAME,
+				       "NotificationClosed",
+				       g_variant_new ("(uu)", id, reason),
+				       NULL);
 }
 
 void
@@ -124,20 +149,14 @@ dbus_send_action_signal (gchar *dest,
 			 guint id, 
 			 const char *action_key)
 {
-	DBusMessage *msg;
-
-	msg = dbus_message_new_signal ("/org/freedesktop/Notifications",
-				       "org.freedesktop.Notifications",
-				       "ActionInvoked");
-	dbus_message_set_destination (msg, dest);
-	dbus_message_append_args (msg, DBUS_TYPE_UINT32, &id,
-				  DBUS_TYPE_INVALID);
-	dbus_message_append_args (msg, DBUS_TYPE_STRING, &action_key,
-				  DBUS_TYPE_INVALID);
-
-	dbus_connection_send (dbus_g_connection_get_connection (connection),
-			      msg,
-			      NULL);
-
-	dbus_message_unref (msg);
+	if (!connection)
+		return;
+
+	g_dbus_connection_emit_signal (connection,
+				       dest,
+				       DBUS_PATH,
+				       DBUS_NAME,
+				       "ActionInvoked",
+				       g_variant_new ("(us)", id, action_key),
+				       NULL);
 }
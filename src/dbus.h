@@ -29,9 +29,9 @@
 #ifndef __NOTIFY_OSD_DBUS_H
 #define __NOTIFY_OSD_DBUS_H
 
-#include <dbus/dbus.h>
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-bindings.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
 
 #ifndef DBUS_PATH
 #define DBUS_PATH "/org/freedesktop/Notifications"
@@ -40,10 +40,19 @@
 #define DBUS_NAME "org.freedesktop.Notifications"
 #endif
 
-DBusGConnection*
+// connection to the session-bus, shared by everything in notify-osd
+GDBusConnection*
+dbus_connect (void);
+
+// only request the name once all objects are exported, so no call from a
+// client started along with us (activation) can get lost
+gboolean
+dbus_request_name (const char *service_name);
+
+GDBusConnection*
 dbus_create_service_instance (const char *service_name);
 
-DBusGConnection*
+GDBusConnection*
 dbus_get_connection (void);
 
 void
@@ -38,6 +38,7 @@
 
 #include "defaults.h"
 #include "util.h"
+#include "atoms.h"
 
 G_DEFINE_TYPE (Defaults, defaults, G_TYPE_OBJECT);
 
@@ -301,7 +302,7 @@ defaults_refresh_screen_dimension_properties (Defaults *self)
 	g_return_if_fail ((self != NULL) && IS_DEFAULTS (self));
 
 	/* get real desktop-area without the panels */
-	workarea_atom = gdk_x11_get_xatom_by_name ("_NET_WORKAREA");
+	workarea_atom = atoms_get (ATOM_NET_WORKAREA);
 	display = gdk_x11_display_get_xdisplay (gdk_display_get_default ());
   
 	gdk_error_trap_push ();
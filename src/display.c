@@ -77,6 +77,7 @@ stack_display_position_sync_bubble (Stack *self, Bubble *bubble)
 	Defaults* d = self->defaults;
 	gint      y = 0;
 	gint      x = 0;
+	Slot      slot;
 
 	defaults_get_top_corner (d, &x, &y);
 
@@ -86,107 +87,49 @@ stack_display_position_sync_bubble (Stack *self, Bubble *bubble)
 	switch (defaults_get_slot_allocation (d))
 	{
 		case SLOT_ALLOCATION_FIXED:
-			if (stack_is_slot_vacant (self, SLOT_TOP))
-			{
-				stack_get_slot_position (self,
-							 SLOT_TOP,
-							 bubble_get_height (bubble),
-							 &x,
-							 &y);
-				if (x == -1 || y == -1)
-					g_warning ("%s(): No slot-coords!\n",
-						   G_STRFUNC);
-				else
-					stack_allocate_slot (self,
-							     bubble,
-							     SLOT_TOP);
-			}
-			else
-			{
+			slot = stack_is_slot_vacant (self, SLOT_TOP) ?
+			       SLOT_TOP : SLOT_NONE;
+			if (slot == SLOT_NONE)
 				g_warning ("%s(): Top slot taken!\n",
 				           G_STRFUNC);
-			}
 		break;
 
 		case SLOT_ALLOCATION_DYNAMIC:
-			// see if we're call at the wrong moment, when both
-			// slots are occupied by bubbles
-			if (!stack_is_slot_vacant (self, SLOT_TOP) &&
-			    !stack_is_slot_vacant (self, SLOT_BOTTOM))
-			{
-				g_warning ("%s(): Both slots taken!\n",
+			// the first vacant slot, right below the bubbles
+			// already on display, this avoids the "gap" between
+			// them and the panel
+			slot = stack_find_vacant_slot (self, TRUE);
+			if (slot == SLOT_NONE)
+				g_warning ("%s(): All slots taken!\n",
 					   G_STRFUNC);
-			}
-			else
-			{
-				// first check if we can place the sync. bubble
-				// in the top slot and the bottom slot is still
-				// vacant, this is to avoid the "gap" between
-				// bottom slot and panel
-				if (stack_is_slot_vacant (self, SLOT_TOP) &&
-				    stack_is_slot_vacant (self, SLOT_BOTTOM))
-				{
-					stack_get_slot_position (self,
-								 SLOT_TOP,
-								 bubble_get_height (bubble),
-								 &x,
-								 &y);
-					if (x == -1 || y == -1)
-						g_warning ("%s(): No coords!\n",
-							   G_STRFUNC);
-					else
-						stack_allocate_slot (self,
-								     bubble,
-								     SLOT_TOP);
-				}
-				// next check if top is occupied and bottom is
-				// still vacant, then place sync. bubble in
-				// bottom slot
-				else if (!stack_is_slot_vacant (self,
-								SLOT_TOP) &&
-					 stack_is_slot_vacant (self,
-							       SLOT_BOTTOM))
-				{
-					stack_get_slot_position (self,
-								 SLOT_BOTTOM,
-								 bubble_get_height (bubble),
-								 &x,
-								 &y);
-					if (x == -1 || y == -1)
-						g_warning ("%s(): No coords!\n",
-							   G_STRFUNC);
-					else
-					{
-						stack_allocate_slot (
-							self,
-							bubble,
-							SLOT_BOTTOM);
-
-						bubble_sync_with (
-							bubble,
-							self->slots[SLOT_TOP]);
-					}
-				}
-				// this case, top vacant, bottom occupied,
-				// should never happen for the old placement,
-				// we want to avoid the "gap" between the bottom
-				// bubble and the panel
-				else if (stack_is_slot_vacant (self,
-							       SLOT_TOP) &&
-					 !stack_is_slot_vacant (self,
-								SLOT_BOTTOM))
-				{
-					g_warning ("%s(): Gap, gap, gap!!!\n",
-						   G_STRFUNC);
-				}
-			}
 		break;
 
 		default :
+			slot = SLOT_NONE;
 			g_warning ("Unhandled slot-allocation!\n");
 		break;
 	}
 
+	if (slot != SLOT_NONE)
+	{
+		stack_get_slot_position (self,
+					 slot,
+					 bubble_get_height (bubble),
+					 &x,
+					 &y);
+		if (x == -1 || y == -1)
+			g_warning ("%s(): No slot-coords!\n",
+				   G_STRFUNC);
+		else
+		{
+			stack_allocate_slot (self, bubble, slot);
+
+			if (slot > SLOT_TOP && self->slots[slot - 1])
+				bubble_sync_with (bubble,
+						  self->slots[slot - 1]);
+		}
+	}
+
 	bubble_move (bubble, x, y);
 }
 
@@ -222,6 +165,7 @@ stack_display_sync_bubble (Stack *self, Bubble *bubble)
 
 	stack_display_position_sync_bubble (self, bubble);
 
+	stats_count (STATS_DISPLAYED);
 	bubble_fade_in (bubble, 100);
 
 	sync_bubble = bubble;
@@ -232,14 +176,19 @@ stack_display_sync_bubble (Stack *self, Bubble *bubble)
 			  self);
 }
 
+/* the bubble to be displayed next, once there's room for it, no_room is set
+   if all the slots for async. bubbles are taken right now */
 static Bubble*
-stack_select_next_to_display (Stack *self)
+stack_select_candidate (Stack    *self,
+			gboolean *no_room)
 {
-	Bubble*   next_to_display = NULL;
+	Bubble*   first  = NULL;
+	Bubble*   urgent = NULL;
 	GList*    list   = NULL;
 	Bubble*   bubble = NULL;
 
-	/* pickup the next bubble to display */
+	*no_room = stack_find_vacant_slot (self, FALSE) == SLOT_NONE;
+
 	for (list = g_list_first (self->list);
 	     list != NULL;
 	     list = g_list_next (list))
@@ -253,62 +202,126 @@ stack_select_next_to_display (Stack *self)
 			continue;
 		}
 
-		/* if there is already one bubble on display
-		   we don't have room for another one */
 		if (bubble_is_visible (bubble))
-			return NULL;
-
-		if (bubble_is_urgent (bubble))
-		{
-			/* pick-up the /first/ urgent bubble
-			   in the queue (FIFO) */
-			return bubble;
+			continue;
 
-		}
+		/* held back until the user may be disturbed again */
+		if (self->dnd_release_id && !bubble_is_urgent (bubble))
+			continue;
 
-		if (next_to_display == NULL)
-			next_to_display = bubble;
+		/* pick-up the /first/ urgent bubble in the queue (FIFO), in
+		   case there are urgent bubbles waiting higher up in the
+		   stack */
+		if (urgent == NULL && bubble_is_urgent (bubble))
+			urgent = bubble;
 
-		/* loop, in case there are urgent bubbles waiting higher up
-		   in the stack */
+		if (first == NULL)
+			first = bubble;
 	}
 
+	return urgent ? urgent : first;
+}
+
+static Bubble*
+stack_select_next_to_display (Stack *self)
+{
+	Bubble*   next_to_display = NULL;
+	gboolean  no_room;
+
+	/* pickup the next bubble to display */
+	next_to_display = stack_select_candidate (self, &no_room);
+
+	/* if all slots are taken by bubbles on display
+	   we don't have room for another one */
+	if (no_room)
+		return NULL;
+
+	/* keep the order, wait for the icon instead of skipping ahead, the
+	   "icon-ready" signal will get us here again */
+	if (next_to_display != NULL && bubble_is_icon_pending (next_to_display))
+		return NULL;
+
+	/* same for a bubble that has not been measured yet, _stage_handler()
+	   calls us again once it has */
+	if (next_to_display != NULL && g_list_find (self->staged, next_to_display))
+		return NULL;
+
 	return next_to_display;
 }
 
-static void
-stack_layout (Stack* self)
+static void stack_layout (Stack* self);
+
+/* polls for the end of do-not-disturb, the bubbles held back until then are
+   shown as slots become vacant, just like any other burst */
+static gboolean
+_dnd_release_handler (gpointer data)
 {
-	Bubble*   bubble = NULL;
-	Defaults* d;
-	gint      y      = 0;
-	gint      x      = 0;
+	Stack* self = STACK (data);
 
-	g_return_if_fail (self != NULL);
+	if (dnd_dont_disturb_user ())
+		return TRUE;
 
-	bubble = stack_select_next_to_display (self);
-	if (bubble == NULL)
-		/* this actually happens when we're called for a synchronous
-		   bubble or after a bubble timed out, but there where no other
-		   notifications waiting in the queue */
+	self->dnd_release_id = 0;
+	stack_layout (self);
+
+	return FALSE;
+}
+
+/* one pass over the queue while the user must not be disturbed, all
+   non-urgent bubbles waiting for their turn are dropped at once, or held back
+   with dnd-hold set */
+static void
+stack_purge_dnd (Stack *self)
+{
+	GList*  list;
+	GList*  next;
+	Bubble* bubble;
+
+	if (DND_HOLD)
+	{
+		if (!self->dnd_release_id)
+			self->dnd_release_id =
+				g_timeout_add_seconds (DND_RELEASE_INTERVAL,
+						       _dnd_release_handler,
+						       self);
 		return;
+	}
 
-	if (dnd_dont_disturb_user ()
-	    && (! bubble_is_urgent (bubble)))
+	for (list = self->list; list != NULL; list = next)
 	{
-		guint id = bubble_get_id (bubble);
+		next   = g_list_next (list);
+		bubble = (Bubble*) list->data;
 
-		/* find entry in list corresponding to id and remove it */
-		self->list =
-			g_list_delete_link (self->list,
-					    find_entry_by_id (self, id));
-		g_object_unref (bubble);
+		/* the ones not ready yet go once they are, like before */
+		if (bubble_is_visible (bubble) ||
+		    bubble_is_urgent (bubble) ||
+		    bubble_is_synchronous (bubble) ||
+		    bubble_is_icon_pending (bubble) ||
+		    g_list_find (self->staged, bubble))
+			continue;
 
-		/* loop, in case there are other bubbles to discard */
-		stack_layout (self);
+		stats_count (STATS_DROPPED_DND);
 
-		return;
+		rate_limit_forget (self->rate_limit,
+				   bubble_get_sender (bubble),
+				   bubble_get_id (bubble));
+		self->list = g_list_delete_link (self->list, list);
+		backlog_note_drained (self->backlog, g_get_monotonic_time ());
+		g_object_unref (bubble);
 	}
+}
+
+static void
+stack_display_bubble (Stack*  self,
+		      Bubble* bubble)
+{
+	Slot  slot;
+	gint  y = 0;
+	gint  x = 0;
+	guint backlog;
+
+	/* only if there was no time to do that in advance */
+	_prerender_bubble (self, bubble);
 
     /*
 	bubble_set_timeout (bubble,
@@ -317,114 +330,86 @@ stack_layout (Stack* self)
 
 	defaults_get_top_corner (self->defaults, &x, &y);
 
-	d = self->defaults;
-
-	switch (defaults_get_slot_allocation (d))
+	/* fixed allocation keeps the top slot for the sync. bubble */
+	slot = stack_find_vacant_slot (self, FALSE);
+	if (slot == SLOT_NONE)
+		g_warning ("%s(): No vacant slot!\n", G_STRFUNC);
+	else
 	{
-		case SLOT_ALLOCATION_FIXED:
-			if (stack_is_slot_vacant (self, SLOT_TOP) &&
-			    bubble_is_synchronous (bubble))
-			{
-				stack_get_slot_position (self,
-						         SLOT_TOP,
-					                 bubble_get_height (bubble),
-						         &x,
-						         &y);
-				if (x == -1 || y == -1)
-					g_warning ("%s(): No coords!\n",
-						   G_STRFUNC);
-				else
-					stack_allocate_slot (self,
-							     bubble,
-							     SLOT_TOP);
-			}
-			else if (stack_is_slot_vacant (self, SLOT_BOTTOM) &&
-				 !bubble_is_synchronous (bubble))
-			{
-				stack_get_slot_position (self,
-						         SLOT_BOTTOM,
-					                 bubble_get_height (bubble),
-						         &x,
-						         &y);
-				if (x == -1 || y == -1)
-					g_warning ("%s(): No coords!\n",
-						   G_STRFUNC);
-				else
-					stack_allocate_slot (self,
-							     bubble,
-							     SLOT_BOTTOM);
-			}
-			else
-			{
-				g_warning ("%s(): Error while handling fixed "
-				           "slot-allocation!\n",
-				           G_STRFUNC);
-			}
-		break;
+		stack_get_slot_position (self,
+					 slot,
+					 bubble_get_height (bubble),
+					 &x,
+					 &y);
+		if (x == -1 || y == -1)
+			g_warning ("%s(): No coords!\n", G_STRFUNC);
+		else
+		{
+			stack_allocate_slot (self, bubble, slot);
 
-		case SLOT_ALLOCATION_DYNAMIC:
-			if (stack_is_slot_vacant (self, SLOT_TOP) &&
-			    stack_is_slot_vacant (self, SLOT_BOTTOM))
+			if (sync_bubble != NULL &&
+			    bubble_is_visible (sync_bubble))
 			{
-				stack_get_slot_position (self,
-						         SLOT_TOP,
-					                 bubble_get_height (bubble),
-						         &x,
-						         &y);
-				if (x == -1 || y == -1)
-					g_warning ("%s(): No coords!\n",
-						   G_STRFUNC);
-				else
-					stack_allocate_slot (self,
-							     bubble,
-							     SLOT_TOP);
+				// synchronize the sync bubble with the
+				// timeout of the latest async. bubble
+				bubble_sync_with (sync_bubble, bubble);
 			}
-			else if (!stack_is_slot_vacant (self, SLOT_TOP) &&
-				 stack_is_slot_vacant (self, SLOT_BOTTOM))
-			{
-				stack_get_slot_position (self,
-						         SLOT_BOTTOM,
-					                 bubble_get_height (bubble),
-						         &x,
-						         &y);
-				if (x == -1 || y == -1)
-					g_warning ("%s(): No coords!\n",
-						   G_STRFUNC);
-				else
-				{
-					stack_allocate_slot (self,
-							     bubble,
-							     SLOT_BOTTOM);
-
-					if (sync_bubble != NULL &&
-					    bubble_is_visible (sync_bubble))
-					{
-						// synchronize the sync bubble with the timeout
-						// of the bubble at the bottom
-						bubble_sync_with (self->slots[SLOT_TOP],
-						                  self->slots[SLOT_BOTTOM]);
-					}
-				}
-			}
-			else
-			{
-				g_warning ("%s(): Error while handling dynamic "
-				           "slot-allocation!\n",
-				           G_STRFUNC);
-			}
-		break;
-
-		default :
-			g_warning ("%s(): Unhandled slot-allocation scheme!\n",
-			           G_STRFUNC);
-		break;
+		}
 	}
 
 	bubble_move (bubble, x, y);
 
-	/* TODO: adjust timings for bubbles that appear in a serie of bubbles */
+	stats_count (STATS_DISPLAYED);
+
+	/* the deeper the queue behind it, the shorter a bubble stays */
 	if (bubble_is_urgent (bubble))
 		bubble_fade_in (bubble, 100);
-	else 
-		bubble_fade_in (bubble, 200);
+	else
+	{
+		/* not counting the bubble itself */
+		backlog = _stack_get_backlog (self);
+		if (backlog > 0)
+			backlog--;
+
+		bubble_set_backlog_depth (bubble, backlog);
+		bubble_set_fade_out_time (bubble,
+					  backlog_scale_fade (300, backlog));
+		bubble_fade_in (bubble, backlog_scale_fade (200, backlog));
+	}
+}
+
+static void
+stack_layout (Stack* self)
+{
+	Bubble*   bubble = NULL;
+	gint      dnd    = -1; /* not asked yet */
+
+	g_return_if_fail (self != NULL);
+
+	_collapse_backlog (self);
+
+	/* whatever is up next now gets rendered while waiting for its turn */
+	_schedule_prerender (self);
+
+	/* with more than two slots, several bubbles of a burst can be shown
+	   at once, this actually finds none when we're called for a
+	   synchronous bubble or after a bubble timed out, but there where no
+	   other notifications waiting in the queue */
+	while ((bubble = stack_select_next_to_display (self)) != NULL)
+	{
+		if (!bubble_is_urgent (bubble))
+		{
+			/* X- and D-Bus round-trips, only ask once */
+			if (dnd == -1)
+				dnd = dnd_dont_disturb_user ();
+
+			if (dnd)
+			{
+				stack_purge_dnd (self);
+				continue;
+			}
+		}
+
+		stack_display_bubble (self, bubble);
+	}
 }
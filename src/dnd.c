@@ -32,7 +32,7 @@
 #include <glib.h>
 #include <glib-object.h>
 
-#include <dbus/dbus-glib.h>
+#include <gio/gio.h>
 
 #include <X11/Xproto.h>
 #include <X11/Xlib.h>
@@ -44,7 +44,7 @@
 
 #include "dbus.h"
 
-static DBusGProxy *gsmgr = NULL;
+static GDBusProxy *gsmgr = NULL;
 
 gboolean
 dnd_is_xscreensaver_active ()
@@ -97,16 +97,26 @@ dnd_is_xscreensaver_active ()
 	return active;
 }
 
-static DBusGProxy*
+static GDBusProxy*
 get_screensaver_proxy (void)
 {
 	if (gsmgr == NULL)
 	{
-		DBusGConnection *connection = dbus_get_connection ();
-		gsmgr = dbus_g_proxy_new_for_name (connection,
-						   "org.gnome.ScreenSaver",
-						   "/org/gnome/ScreenSaver",
-						   "org.gnome.ScreenSaver");
+		GDBusConnection *connection = dbus_get_connection ();
+
+		if (connection == NULL)
+			return NULL;
+
+		gsmgr = g_dbus_proxy_new_sync (connection,
+					       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+					       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS |
+					       G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+					       NULL,
+					       "org.gnome.ScreenSaver",
+					       "/org/gnome/ScreenSaver",
+					       "org.gnome.ScreenSaver",
+					       NULL,
+					       NULL);
 	}
 
 	return gsmgr;
@@ -115,27 +125,29 @@ get_screensaver_proxy (void)
 gboolean
 dnd_is_screensaver_inhibited ()
 {
-	GError  *error = NULL;
-	gboolean inhibited = FALSE;
-	char **list;
+	GError   *error = NULL;
+	gboolean  inhibited = FALSE;
+	GVariant *result;
+	char    **list;
 
 	if (! get_screensaver_proxy ())
 		return FALSE;
 
-	if (dbus_g_proxy_call_with_timeout (
-		    gsmgr, "GetInhibitors", 2000, &error,
-		    G_TYPE_INVALID,
-		    G_TYPE_STRV, &list,
-		    G_TYPE_INVALID))
+	result = g_dbus_proxy_call_sync (gsmgr, "GetInhibitors", NULL,
+					 G_DBUS_CALL_FLAGS_NONE, 2000,
+					 NULL, &error);
+	if (error)
 	{
-		if (error)
-		{
-			g_warning ("dnd_is_screensaver_inhibited(): "
-			           "got error \"%s\"\n",
-			           error->message);
-			g_error_free (error);
-			error = NULL;
-		}
+		g_warning ("dnd_is_screensaver_inhibited(): "
+		           "got error \"%s\"\n",
+		           error->message);
+		g_error_free (error);
+		error = NULL;
+	}
+
+	if (result && g_variant_is_of_type (result, G_VARIANT_TYPE ("(as)")))
+	{
+		g_variant_get (result, "(^as)", &list);
 
 		/* if the list is not empty, the screensaver is inhibited */
 		if (*list)
@@ -146,23 +158,31 @@ dnd_is_screensaver_inhibited ()
 		g_strfreev (list);
 	}
 
+	if (result)
+		g_variant_unref (result);
+
 	return inhibited;
 }
 
 gboolean
 dnd_is_screensaver_active ()
 {
-	GError  *error = NULL;
-	gboolean active = FALSE;;
+	GError   *error = NULL;
+	gboolean  active = FALSE;
+	GVariant *result;
 
 	if (! get_screensaver_proxy ())
 		return FALSE;
 
-	dbus_g_proxy_call_with_timeout (
-		gsmgr, "GetActive", 2000, &error,
-		G_TYPE_INVALID,
-		G_TYPE_BOOLEAN, &active,
-		G_TYPE_INVALID);
+	result = g_dbus_proxy_call_sync (gsmgr, "GetActive", NULL,
+					 G_DBUS_CALL_FLAGS_NONE, 2000,
+					 NULL, &error);
+
+	if (result && g_variant_is_of_type (result, G_VARIANT_TYPE ("(b)")))
+		g_variant_get (result, "(b)", &active);
+
+	if (result)
+		g_variant_unref (result);
 
 	if (error)
 	{
@@ -0,0 +1,262 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** icon-cache.c - LRU of decoded icons and their tiles, shared by all bubbles
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "icon-cache.h"
+
+// max. number of icons kept around, 0 disables the cache
+gint ICON_CACHE_SIZE = 32;
+
+typedef struct _IconCacheEntry
+{
+	gchar*     key;
+	gchar*     path;  // only set for absolute filenames, for the mtime-check
+	time_t     mtime;
+	GdkPixbuf* pixbuf;
+	tile_t*    tile;
+} IconCacheEntry;
+
+static GHashTable*    g_entries    = NULL; // key -> GList-link into g_lru
+static GQueue         g_lru        = G_QUEUE_INIT; // most recent use first
+static gchar*         g_theme_name = NULL;
+static IconCacheStats g_stats      = { 0 };
+
+//-- private functions ---------------------------------------------------------
+
+static void
+_entry_free (IconCacheEntry* entry)
+{
+	g_free (entry->key);
+	g_free (entry->path);
+	g_object_unref (entry->pixbuf);
+	tile_destroy (entry->tile);
+	g_free (entry);
+}
+
+static void
+_entry_remove (GList* link)
+{
+	IconCacheEntry* entry = link->data;
+
+	g_hash_table_remove (g_entries, entry->key);
+	g_queue_delete_link (&g_lru, link);
+	_entry_free (entry);
+}
+
+static void
+_update_theme_name (void)
+{
+	GtkSettings* settings = gtk_settings_get_default ();
+
+	g_free (g_theme_name);
+	g_theme_name = NULL;
+
+	if (settings)
+		g_object_get (settings, "gtk-icon-theme-name", &g_theme_name, NULL);
+}
+
+static void
+_theme_changed_handler (GtkIconTheme* theme G_GNUC_UNUSED,
+			gpointer      data G_GNUC_UNUSED)
+{
+	g_stats.invalidations += g_queue_get_length (&g_lru);
+	icon_cache_clear ();
+	_update_theme_name ();
+}
+
+static void
+_ensure_cache (void)
+{
+	if (g_entries)
+		return;
+
+	g_entries = g_hash_table_new (g_str_hash, g_str_equal);
+
+	g_signal_connect (gtk_icon_theme_get_default (),
+			  "changed",
+			  G_CALLBACK (_theme_changed_handler),
+			  NULL);
+	_update_theme_name ();
+}
+
+// images referenced must always be local files, see load_icon()
+static const gchar*
+_absolute_path (const gchar* name)
+{
+	if (!strncmp (name, "file://", 7))
+		name += 7;
+
+	return name[0] == '/' ? name : NULL;
+}
+
+static gboolean
+_get_mtime (const gchar* path,
+	    time_t*      mtime)
+{
+	struct stat buf;
+
+	if (g_stat (path, &buf) != 0)
+		return FALSE;
+
+	*mtime = buf.st_mtime;
+
+	return TRUE;
+}
+
+static gchar*
+_make_key (const gchar* name,
+	   gint         pixel_size)
+{
+	return g_strdup_printf ("%s|%d|%s",
+				g_theme_name ? g_theme_name : "",
+				pixel_size,
+				name);
+}
+
+//-- public functions ----------------------------------------------------------
+
+gboolean
+icon_cache_lookup (const gchar* name,
+		   gint         pixel_size,
+		   GdkPixbuf**  pixbuf,
+		   tile_t**     tile)
+{
+	IconCacheEntry* entry;
+	GList*          link;
+	gchar*          key;
+	time_t          mtime;
+
+	if (!name || !pixbuf || !tile || ICON_CACHE_SIZE <= 0)
+		return FALSE;
+
+	_ensure_cache ();
+
+	key  = _make_key (name, pixel_size);
+	link = g_hash_table_lookup (g_entries, key);
+	g_free (key);
+
+	if (!link)
+	{
+		g_stats.misses++;
+		return FALSE;
+	}
+
+	entry = link->data;
+
+	// file was replaced on disk since we decoded it
+	if (entry->path &&
+	    (!_get_mtime (entry->path, &mtime) || mtime != entry->mtime))
+	{
+		_entry_remove (link);
+		g_stats.invalidations++;
+		g_stats.misses++;
+		return FALSE;
+	}
+
+	g_queue_unlink (&g_lru, link);
+	g_queue_push_head_link (&g_lru, link);
+
+	*pixbuf = g_object_ref (entry->pixbuf);
+	*tile   = tile_ref (entry->tile);
+	g_stats.hits++;
+
+	return TRUE;
+}
+
+void
+icon_cache_insert (const gchar* name,
+		   gint         pixel_size,
+		   GdkPixbuf*   pixbuf,
+		   tile_t*      tile)
+{
+	IconCacheEntry* entry;
+	GList*          link;
+	const gchar*    path;
+
+	if (!name || !pixbuf || !tile || ICON_CACHE_SIZE <= 0)
+		return;
+
+	_ensure_cache ();
+
+	entry      = g_new0 (IconCacheEntry, 1);
+	entry->key = _make_key (name, pixel_size);
+
+	path = _absolute_path (name);
+	if (path)
+	{
+		if (!_get_mtime (path, &entry->mtime))
+		{
+			g_free (entry->key);
+			g_free (entry);
+			return;
+		}
+		entry->path = g_strdup (path);
+	}
+
+	entry->pixbuf = g_object_ref (pixbuf);
+	entry->tile   = tile_ref (tile);
+
+	link = g_hash_table_lookup (g_entries, entry->key);
+	if (link)
+		_entry_remove (link);
+
+	while (g_queue_get_length (&g_lru) >= (guint) ICON_CACHE_SIZE)
+	{
+		_entry_remove (g_queue_peek_tail_link (&g_lru));
+		g_stats.evictions++;
+	}
+
+	g_queue_push_head (&g_lru, entry);
+	g_hash_table_insert (g_entries, entry->key, g_queue_peek_head_link (&g_lru));
+}
+
+void
+icon_cache_clear (void)
+{
+	while (!g_queue_is_empty (&g_lru))
+		_entry_remove (g_queue_peek_head_link (&g_lru));
+}
+
+void
+icon_cache_get_stats (IconCacheStats* stats)
+{
+	if (!stats)
+		return;
+
+	*stats      = g_stats;
+	stats->size = g_queue_get_length (&g_lru);
+}
+
+void
+icon_cache_reset_stats (void)
+{
+	memset (&g_stats, 0, sizeof (IconCacheStats));
+}
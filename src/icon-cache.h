@@ -0,0 +1,69 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** icon-cache.h - LRU of decoded icons and their tiles, shared by all bubbles
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __ICON_CACHE_H
+#define __ICON_CACHE_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "tile.h"
+
+G_BEGIN_DECLS
+
+typedef struct _IconCacheStats
+{
+	guint hits;
+	guint misses;
+	guint evictions;     // dropped because the cache was full
+	guint invalidations; // dropped due to theme-change or modified file
+	guint size;          // entries currently held
+} IconCacheStats;
+
+// on a hit *pixbuf and *tile receive new references the caller owns
+gboolean
+icon_cache_lookup (const gchar* name,
+		   gint         pixel_size,
+		   GdkPixbuf**  pixbuf,
+		   tile_t**     tile);
+
+// the cache takes its own references to pixbuf and tile
+void
+icon_cache_insert (const gchar* name,
+		   gint         pixel_size,
+		   GdkPixbuf*   pixbuf,
+		   tile_t*      tile);
+
+void
+icon_cache_clear (void);
+
+void
+icon_cache_get_stats (IconCacheStats* stats);
+
+void
+icon_cache_reset_stats (void);
+
+G_END_DECLS
+
+#endif /* __ICON_CACHE_H */
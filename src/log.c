@@ -34,10 +34,39 @@
 #include <time.h>
 #include <stdio.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include "bubble.h"
+#include "log.h"
 
-static FILE *logfile = NULL;
+// records waiting for the writer-thread, any more are dropped
+#define LOG_QUEUE_SIZE 256
+
+// the log is rotated once it would grow beyond this many bytes, 0 disables
+// rotation
+gint LOG_MAX_SIZE = 1024 * 1024;
+
+// number of rotated logs kept around (notify-osd.log.1, .2, ...)
+gint LOG_MAX_FILES = 2;
+
+typedef struct _LogRecord
+{
+	gint64 time; // usec since the epoch
+	gchar* app_name;
+	gchar* option;
+	gchar* title;
+	gchar* body;
+} LogRecord;
+
+static FILE*        logfile     = NULL;
+static gchar*       logname     = NULL;
+static glong        logsize     = 0;
+static GAsyncQueue* log_queue   = NULL;
+static GThread*     log_thread  = NULL;
+static gint         log_dropped = 0;
+
+// pushed by log_close() to make the writer-thread finish
+static LogRecord    log_quit;
 
 static void
 log_logger_null(const char     *domain,
@@ -48,6 +77,166 @@ log_logger_null(const char     *domain,
 	return;
 }
 
+static void
+log_record_free (LogRecord* record)
+{
+	g_free (record->app_name);
+	g_free (record->option);
+	g_free (record->title);
+	g_free (record->body);
+	g_free (record);
+}
+
+// notify-osd.log -> notify-osd.log.1 -> ... -> notify-osd.log.LOG_MAX_FILES
+static void
+log_rotate (void)
+{
+	gchar* from;
+	gchar* to;
+	gint   i;
+
+	fclose (logfile);
+
+	for (i = LOG_MAX_FILES; i > 0; i--)
+	{
+		from = i > 1 ? g_strdup_printf ("%s.%d", logname, i - 1) :
+			       g_strdup (logname);
+		to   = g_strdup_printf ("%s.%d", logname, i);
+		g_rename (from, to);
+		g_free (from);
+		g_free (to);
+	}
+
+	logfile = fopen (logname, LOG_MAX_FILES > 0 ? "a" : "w");
+	logsize = 0;
+}
+
+static void
+log_format_record (GString*   buffer,
+		   LogRecord* record)
+{
+	time_t    secs = record->time / G_USEC_PER_SEC;
+	struct tm tm;
+
+	/* FIXME: deal with tz offsets */
+	localtime_r (&secs, &tm);
+
+	g_string_append_printf (buffer,
+				"[%.4d-%.2d-%.2dT%.2d:%.2d:%.2d%.1s%.2d:%.2d, %s%s%s] %s\n"
+				"%s\n\n",
+				tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+				tm.tm_hour, tm.tm_min, tm.tm_sec,
+				"-", 0, 0,
+				record->app_name,
+				record->option ? " " : "",
+				record->option ? record->option : "",
+				record->title,
+				record->body);
+}
+
+// blocks until there is something to write, then takes everything queued up
+// to that point and hands it to the file in one go
+static gpointer
+log_writer (gpointer data)
+{
+	GString*   buffer = g_string_sized_new (4096);
+	LogRecord* record;
+	gint       records;
+	gboolean   quit   = FALSE;
+
+	while (!quit)
+	{
+		record  = g_async_queue_pop (log_queue);
+		records = 0;
+
+		do
+		{
+			if (record == &log_quit)
+				quit = TRUE;
+			else
+			{
+				log_format_record (buffer, record);
+				log_record_free (record);
+				records++;
+			}
+		}
+		while ((record = g_async_queue_try_pop (log_queue)));
+
+		if (!buffer->len)
+			continue;
+
+		if (logfile && LOG_MAX_SIZE > 0 && logsize > 0 &&
+		    logsize + (glong) buffer->len > LOG_MAX_SIZE)
+			log_rotate ();
+
+		// the file could not be reopened after rotating, there's no
+		// point in holding on to what can't be written anymore
+		if (logfile)
+		{
+			fwrite (buffer->str, 1, buffer->len, logfile);
+			fflush (logfile);
+			logsize += buffer->len;
+		}
+		else
+			g_atomic_int_add (&log_dropped, records);
+
+		g_string_truncate (buffer, 0);
+	}
+
+	g_string_free (buffer, TRUE);
+
+	return NULL;
+}
+
+gboolean
+log_open (const gchar* filename)
+{
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (log_thread)
+		log_close ();
+
+	logfile = fopen (filename, "a");
+	if (logfile == NULL)
+		return FALSE;
+
+	fseek (logfile, 0, SEEK_END);
+	logsize = ftell (logfile);
+	logname = g_strdup (filename);
+
+	log_queue  = g_async_queue_new ();
+	log_thread = g_thread_new ("notify-osd-log", log_writer, NULL);
+
+	return TRUE;
+}
+
+void
+log_close (void)
+{
+	if (!log_thread)
+		return;
+
+	g_async_queue_push (log_queue, &log_quit);
+	g_thread_join (log_thread);
+	log_thread = NULL;
+
+	g_async_queue_unref (log_queue);
+	log_queue = NULL;
+
+	if (logfile)
+		fclose (logfile);
+	logfile = NULL;
+
+	g_free (logname);
+	logname = NULL;
+}
+
+guint
+log_get_dropped (void)
+{
+	return (guint) g_atomic_int_get (&log_dropped);
+}
+
 void
 log_init (void)
 {
@@ -62,8 +251,7 @@ log_init (void)
 
 	char *filename = g_build_filename (dirname, "notify-osd.log", NULL);
 
-	logfile = fopen (filename, "w");
-	if (logfile == NULL)
+	if (!log_open (filename))
 		g_warning ("could not open/append to %s; logging disabled",
 			   filename);
 
@@ -97,31 +285,31 @@ log_create_timestamp (void)
 				"-", 0, 0);
 }
 
+// only copies the strings, formatting and writing happen on the writer-thread
 void
 log_bubble (Bubble *bubble, const char *app_name, const char *option)
 {
+	LogRecord* record;
+
 	g_return_if_fail (IS_BUBBLE (bubble));
 
-	if (logfile == NULL)
+	if (log_queue == NULL)
 		return;
 
-	char *ts = log_create_timestamp ();
-
-	if (option)
-		fprintf (logfile, "[%s, %s %s] %s\n",
-			 ts, app_name, option,
-			 bubble_get_title (bubble));
-	else
-		fprintf (logfile, "[%s, %s] %s\n",
-			 ts, app_name,
-			 bubble_get_title (bubble));
-
-	fprintf (logfile, "%s\n\n",
-		 bubble_get_message_body (bubble));
+	if (g_async_queue_length (log_queue) >= LOG_QUEUE_SIZE)
+	{
+		g_atomic_int_inc (&log_dropped);
+		return;
+	}
 
-	fflush (logfile);
+	record           = g_new0 (LogRecord, 1);
+	record->time     = g_get_real_time ();
+	record->app_name = g_strdup (app_name);
+	record->option   = option && *option ? g_strdup (option) : NULL;
+	record->title    = g_strdup (bubble_get_title (bubble));
+	record->body     = g_strdup (bubble_get_message_body (bubble));
 
-	g_free (ts);
+	g_async_queue_push (log_queue, record);
 }
 
 void
@@ -34,6 +34,18 @@ G_BEGIN_DECLS
 void
 log_init (void);
 
+// appends to filename, records are written by a background-thread
+gboolean
+log_open (const gchar* filename);
+
+// writes out all pending records and closes the log
+void
+log_close (void);
+
+// records dropped because the writer-thread could not keep up
+guint
+log_get_dropped (void);
+
 void
 log_bubble (Bubble *bubble, const char *app_name, const char *option);
 
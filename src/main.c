@@ -32,14 +32,19 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <signal.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <gtk/gtk.h>
+#include <gdk/gdkx.h>
 
 #include "defaults.h"
 #include "stack.h"
 #include "observer.h"
 #include "dbus.h"
 #include "log.h"
+#include "trace.h"
+#include "atoms.h"
 
 #define ICONS_DIR  (DATADIR G_DIR_SEPARATOR_S "notify-osd" G_DIR_SEPARATOR_S "icons")
 
@@ -80,6 +85,26 @@ extern float DEFAULT_GAUGE_SIZE;
 extern gboolean BUBBLE_PREVENT_FADE;
 extern gboolean BUBBLE_CLOSE_ON_CLICK;
 
+extern gint ICON_CACHE_SIZE;
+extern gint BUBBLE_ICON_LOAD_TIMEOUT;
+
+extern gint RATE_LIMIT_BURST;
+extern gint RATE_LIMIT_RATE;
+extern gint RATE_LIMIT_COALESCE_WINDOW;
+
+extern gint TRACE_ENABLED;
+
+extern gint LOG_MAX_SIZE;
+extern gint LOG_MAX_FILES;
+
+extern gint FORCED_SHUTDOWN_THRESHOLD;
+extern gint STACK_SLOTS;
+extern gint DND_HOLD;
+
+extern gint BACKLOG_THRESHOLD;
+extern gint BACKLOG_MIN_TIMEOUT;
+extern gint BACKLOG_COLLAPSE;
+
 void parse_color(unsigned int c, float* r, float* g, float* b) 
 {
     *b = (float)(c & 0xFF) / (float)(0xFF);
@@ -95,16 +120,21 @@ void load_settings(void)
     char file[PATH_MAX];
     uid_t uid = getuid();
     const char* settings_file_name = ".notify-osd";
+    const char* override = g_getenv("NOTIFY_OSD_SETTINGS");
     
     struct passwd* pw = getpwuid(uid);
-    if (!pw) {
+    if (override) {
+        /* e.g. the benchmarks in tests/ use their own settings */
+        snprintf(file, sizeof(file), "%s", override);
+    } else if (!pw) {
         fprintf(stderr,
                 "failed to retrieve home directory. using default settings.\n");
         return;
+    } else {
+        /* $HOME/.notify-osd */
+        snprintf(file, sizeof(file), "%s%s%s", pw->pw_dir,
+                 G_DIR_SEPARATOR_S, settings_file_name);
     }
-    /* $HOME/.notify-osd */
-    snprintf(file, sizeof(file), "%s%s%s", pw->pw_dir,
-             G_DIR_SEPARATOR_S, settings_file_name);
 
     FILE* fp = fopen(file, "r");
 
@@ -233,6 +263,62 @@ void load_settings(void)
                    sscanf(value, "%d", &ivalue) ) {
             BUBBLE_CLOSE_ON_CLICK = ivalue;
 
+        } else if (!strcmp(key, "icon-cache-size") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            ICON_CACHE_SIZE = ivalue;
+
+        } else if (!strcmp(key, "icon-load-timeout") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            BUBBLE_ICON_LOAD_TIMEOUT = ivalue;
+
+        } else if (!strcmp(key, "sender-rate-burst") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            RATE_LIMIT_BURST = ivalue;
+
+        } else if (!strcmp(key, "sender-rate-limit") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            RATE_LIMIT_RATE = ivalue;
+
+        } else if (!strcmp(key, "coalesce-window") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            RATE_LIMIT_COALESCE_WINDOW = ivalue;
+
+        } else if (!strcmp(key, "trace") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            TRACE_ENABLED = ivalue;
+
+        } else if (!strcmp(key, "log-max-size") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            LOG_MAX_SIZE = ivalue;
+
+        } else if (!strcmp(key, "log-max-files") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            LOG_MAX_FILES = ivalue;
+
+        } else if (!strcmp(key, "forced-shutdown-threshold") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            FORCED_SHUTDOWN_THRESHOLD = ivalue;
+
+        } else if (!strcmp(key, "stack-slots") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            STACK_SLOTS = ivalue;
+
+        } else if (!strcmp(key, "dnd-hold") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            DND_HOLD = ivalue;
+
+        } else if (!strcmp(key, "backlog-threshold") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            BACKLOG_THRESHOLD = ivalue;
+
+        } else if (!strcmp(key, "backlog-min-timeout") &&
+                   sscanf(value, "%f", &fvalue) ) {
+            BACKLOG_MIN_TIMEOUT = fvalue*1000;
+
+        } else if (!strcmp(key, "backlog-collapse") &&
+                   sscanf(value, "%d", &ivalue) ) {
+            BACKLOG_COLLAPSE = ivalue;
+
         }
         
     }
@@ -245,6 +331,28 @@ void load_settings(void)
 }
 /* end hack */
 
+/* dumps the trace-ring, to look at a slow burst after the fact */
+static gboolean
+dump_trace_handler (gpointer data)
+{
+	gchar*  filename;
+	GError* error = NULL;
+
+	filename = g_build_filename (g_get_user_cache_dir (),
+				     "notify-osd-trace.json",
+				     NULL);
+
+	if (!trace_dump (filename, &error))
+	{
+		g_warning ("Could not write %s: %s", filename, error->message);
+		g_error_free (error);
+	}
+
+	g_free (filename);
+
+	return TRUE;
+}
+
 int
 main (int    argc,
       char** argv)
@@ -252,13 +360,14 @@ main (int    argc,
 	Defaults*        defaults   = NULL;
 	Stack*           stack      = NULL;
 	Observer*        observer   = NULL;
-	DBusGConnection* connection = NULL;
+	GDBusConnection* connection = NULL;
+	GError*          error      = NULL;
 
 	g_thread_init (NULL);
-	dbus_g_thread_init ();
 	log_init ();
 
 	gtk_init (&argc, &argv);
+	atoms_init (gdk_x11_display_get_xdisplay (gdk_display_get_default ()));
 
 	/* Init some theme/icon stuff */
 	gtk_icon_theme_append_search_path(gtk_icon_theme_get_default(),
@@ -270,21 +379,35 @@ main (int    argc,
 	observer = observer_new ();
 	stack = stack_new (defaults, observer);
 
-	connection = dbus_create_service_instance (DBUS_NAME);
+	connection = dbus_connect ();
 	if (connection == NULL)
+	{
+		g_warning ("Could not connect to the session-bus");
+		stack_del (stack);
+		return 0;
+	}
+
+	if (!stack_export (stack, connection, DBUS_PATH, &error))
+	{
+		g_warning ("Could not export %s: %s", DBUS_PATH, error->message);
+		g_error_free (error);
+		stack_del (stack);
+		return 0;
+	}
+
+	if (!dbus_request_name (DBUS_NAME))
 	{
 		g_warning ("Could not register instance");
 		stack_del (stack);
 		return 0;
 	}
 
-	dbus_g_connection_register_g_object (connection,
-					     DBUS_PATH,
-					     G_OBJECT (stack));
+	g_unix_signal_add (SIGUSR2, dump_trace_handler, NULL);
 
 	gtk_main ();
 
 	stack_del (stack);
+	log_close ();
 
 	return 0;
 }
@@ -29,6 +29,7 @@
 #include "exponential-blur.h"
 #include "stack-blur.h"
 #include "gaussian-blur.h"
+#include "trace.h"
 
 struct _raico_blur_private_t
 {
@@ -112,6 +113,7 @@ raico_blur_apply (raico_blur_t*    blur,
 		  cairo_surface_t* surface)
 {
 	cairo_format_t format;
+	gint64         start;
 
 	// sanity checks
 	if (!blur)
@@ -151,6 +153,8 @@ raico_blur_apply (raico_blur_t*    blur,
 	if (blur->priv->radius == 0)
 		return;
 
+	start = g_get_monotonic_time ();
+
 	// now do the real work
 	switch (blur->priv->quality)
 	{
@@ -167,6 +171,8 @@ raico_blur_apply (raico_blur_t*    blur,
 			surface_gaussian_blur (surface, blur->priv->radius);
 		break;
 	}
+
+	trace_span (TRACE_BLUR, 0, start);
 }
 
 void
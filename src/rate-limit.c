@@ -0,0 +1,347 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** rate-limit.c - per-sender token-bucket and coalescing of repeated bubbles
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "rate-limit.h"
+
+// max. number of new bubbles a sender can post in a burst, 0 disables the
+// token-bucket
+gint RATE_LIMIT_BURST = 0;
+
+// new bubbles per second a sender gets back for its bucket
+gint RATE_LIMIT_RATE = 0;
+
+// identical notifications of a sender within this many ms end up in the
+// same bubble, 0 disables coalescing
+gint RATE_LIMIT_COALESCE_WINDOW = 0;
+
+// idle senders are forgotten after this many usec, along with their stats,
+// unique bus-names are not reused, so they'd pile up otherwise
+#define SENDER_EXPIRY (10 * 60 * G_USEC_PER_SEC)
+
+typedef struct _RecentNotification
+{
+	guint  id;
+	guint  repeat;
+	gint64 time;
+} RecentNotification;
+
+typedef struct _SenderState
+{
+	gdouble     tokens;
+	gint64      last_refill;
+	gint64      last_seen;
+	guint       dropped;
+	guint       coalesced;
+	GHashTable* recent; // "summary\nbody" -> RecentNotification
+} SenderState;
+
+struct _RateLimit
+{
+	GHashTable* senders; // unique bus-name -> SenderState
+	gint64      last_expiry;
+};
+
+//-- private functions ---------------------------------------------------------
+
+static void
+_sender_free (SenderState* state)
+{
+	g_hash_table_destroy (state->recent);
+	g_free (state);
+}
+
+static void
+_expire_senders (RateLimit* self,
+		 gint64     now)
+{
+	GHashTableIter iter;
+	SenderState*   state;
+
+	if (now - self->last_expiry < SENDER_EXPIRY)
+		return;
+
+	self->last_expiry = now;
+
+	g_hash_table_iter_init (&iter, self->senders);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &state))
+		if (now - state->last_seen > SENDER_EXPIRY)
+			g_hash_table_iter_remove (&iter);
+}
+
+static SenderState*
+_get_sender (RateLimit*   self,
+	     const gchar* sender,
+	     gint64       now)
+{
+	SenderState* state;
+
+	_expire_senders (self, now);
+
+	if (!sender)
+		sender = "";
+
+	state = g_hash_table_lookup (self->senders, sender);
+	if (!state)
+	{
+		state              = g_new0 (SenderState, 1);
+		state->tokens      = RATE_LIMIT_BURST;
+		state->last_refill = now;
+		state->recent      = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    g_free,
+							    g_free);
+		g_hash_table_insert (self->senders, g_strdup (sender), state);
+	}
+
+	state->last_seen = now;
+
+	return state;
+}
+
+static gchar*
+_make_key (const gchar* summary,
+	   const gchar* body)
+{
+	return g_strconcat (summary ? summary : "", "\n", body ? body : "", NULL);
+}
+
+static void
+_expire_recent (SenderState* state,
+		gint64       now)
+{
+	GHashTableIter      iter;
+	RecentNotification* recent;
+	gint64              window;
+
+	window = (gint64) RATE_LIMIT_COALESCE_WINDOW * 1000;
+
+	g_hash_table_iter_init (&iter, state->recent);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &recent))
+		if (now - recent->time >= window)
+			g_hash_table_iter_remove (&iter);
+}
+
+//-- public functions ----------------------------------------------------------
+
+RateLimit*
+rate_limit_new (void)
+{
+	RateLimit* self = g_new0 (RateLimit, 1);
+
+	self->senders = g_hash_table_new_full (g_str_hash,
+					       g_str_equal,
+					       g_free,
+					       (GDestroyNotify) _sender_free);
+
+	return self;
+}
+
+void
+rate_limit_free (RateLimit* self)
+{
+	if (!self)
+		return;
+
+	g_hash_table_destroy (self->senders);
+	g_free (self);
+}
+
+gboolean
+rate_limit_take_token (RateLimit*   self,
+		       const gchar* sender,
+		       gint64       now)
+{
+	SenderState* state;
+
+	if (!self || RATE_LIMIT_BURST <= 0)
+		return TRUE;
+
+	state = _get_sender (self, sender, now);
+
+	state->tokens += (gdouble) (now - state->last_refill) *
+			 RATE_LIMIT_RATE / G_USEC_PER_SEC;
+	state->tokens = MIN (state->tokens, RATE_LIMIT_BURST);
+	state->last_refill = now;
+
+	if (state->tokens < 1.0)
+	{
+		state->dropped++;
+		return FALSE;
+	}
+
+	state->tokens -= 1.0;
+
+	return TRUE;
+}
+
+static RecentNotification*
+_find_recent (RateLimit*    self,
+	      const gchar*  sender,
+	      const gchar*  summary,
+	      const gchar*  body,
+	      gint64        now,
+	      SenderState** state)
+{
+	RecentNotification* recent;
+	gchar*              key;
+
+	*state = _get_sender (self, sender, now);
+	_expire_recent (*state, now);
+
+	key    = _make_key (summary, body);
+	recent = g_hash_table_lookup ((*state)->recent, key);
+	g_free (key);
+
+	return recent;
+}
+
+guint
+rate_limit_find_recent (RateLimit*   self,
+			const gchar* sender,
+			const gchar* summary,
+			const gchar* body,
+			gint64       now)
+{
+	SenderState*        state;
+	RecentNotification* recent;
+
+	if (!self || RATE_LIMIT_COALESCE_WINDOW <= 0)
+		return 0;
+
+	recent = _find_recent (self, sender, summary, body, now, &state);
+
+	return recent ? recent->id : 0;
+}
+
+guint
+rate_limit_coalesce (RateLimit*   self,
+		     const gchar* sender,
+		     const gchar* summary,
+		     const gchar* body,
+		     gint64       now)
+{
+	SenderState*        state;
+	RecentNotification* recent;
+
+	if (!self || RATE_LIMIT_COALESCE_WINDOW <= 0)
+		return 0;
+
+	recent = _find_recent (self, sender, summary, body, now, &state);
+	if (!recent)
+		return 0;
+
+	// the window restarts with every repetition
+	recent->repeat++;
+	recent->time = now;
+	state->coalesced++;
+
+	return recent->repeat;
+}
+
+void
+rate_limit_remember (RateLimit*   self,
+		     const gchar* sender,
+		     const gchar* summary,
+		     const gchar* body,
+		     guint        id,
+		     gint64       now)
+{
+	SenderState*        state;
+	RecentNotification* recent;
+
+	if (!self || RATE_LIMIT_COALESCE_WINDOW <= 0 || id == 0)
+		return;
+
+	state = _get_sender (self, sender, now);
+	_expire_recent (state, now);
+
+	recent         = g_new0 (RecentNotification, 1);
+	recent->id     = id;
+	recent->repeat = 1;
+	recent->time   = now;
+
+	g_hash_table_replace (state->recent, _make_key (summary, body), recent);
+}
+
+void
+rate_limit_forget (RateLimit*   self,
+		   const gchar* sender,
+		   guint        id)
+{
+	SenderState*        state;
+	RecentNotification* recent;
+	GHashTableIter      iter;
+
+	if (!self)
+		return;
+
+	state = g_hash_table_lookup (self->senders, sender ? sender : "");
+	if (!state)
+		return;
+
+	g_hash_table_iter_init (&iter, state->recent);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &recent))
+		if (recent->id == id)
+			g_hash_table_iter_remove (&iter);
+}
+
+void
+rate_limit_get_sender_stats (RateLimit*   self,
+			     const gchar* sender,
+			     guint*       dropped,
+			     guint*       coalesced)
+{
+	SenderState* state = NULL;
+
+	if (self)
+		state = g_hash_table_lookup (self->senders,
+					     sender ? sender : "");
+
+	if (dropped)
+		*dropped = state ? state->dropped : 0;
+
+	if (coalesced)
+		*coalesced = state ? state->coalesced : 0;
+}
+
+void
+rate_limit_foreach (RateLimit*    self,
+		    RateLimitFunc func,
+		    gpointer      user_data)
+{
+	GHashTableIter iter;
+	const gchar*   sender;
+	SenderState*   state;
+
+	if (!self || !func)
+		return;
+
+	g_hash_table_iter_init (&iter, self->senders);
+	while (g_hash_table_iter_next (&iter,
+				       (gpointer*) &sender,
+				       (gpointer*) &state))
+		func (sender, state->dropped, state->coalesced, user_data);
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** rate-limit.h - per-sender token-bucket and coalescing of repeated bubbles
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __RATE_LIMIT_H
+#define __RATE_LIMIT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RateLimit RateLimit;
+
+typedef void (*RateLimitFunc) (const gchar* sender,
+			       guint        dropped,
+			       guint        coalesced,
+			       gpointer     user_data);
+
+RateLimit*
+rate_limit_new (void);
+
+void
+rate_limit_free (RateLimit* self);
+
+// takes a token from the bucket of sender, FALSE (and counted as dropped) if
+// the sender ran out of them, now is g_get_monotonic_time()
+gboolean
+rate_limit_take_token (RateLimit*   self,
+		       const gchar* sender,
+		       gint64       now);
+
+// id of the notification an identical one (same sender, summary and body)
+// was shown with less than the coalescing-window ago, 0 if there's none
+guint
+rate_limit_find_recent (RateLimit*   self,
+			const gchar* sender,
+			const gchar* summary,
+			const gchar* body,
+			gint64       now);
+
+// counts a notification as coalesced into the one rate_limit_find_recent()
+// found, once the caller made sure it's still around, returns the new
+// repeat-count, 0 if there's nothing to coalesce with
+guint
+rate_limit_coalesce (RateLimit*   self,
+		     const gchar* sender,
+		     const gchar* summary,
+		     const gchar* body,
+		     gint64       now);
+
+// notes that id shows summary/body of sender, as of now
+void
+rate_limit_remember (RateLimit*   self,
+		     const gchar* sender,
+		     const gchar* summary,
+		     const gchar* body,
+		     guint        id,
+		     gint64       now);
+
+// id does not show what was remembered for it anymore (replaced, appended to)
+void
+rate_limit_forget (RateLimit*   self,
+		   const gchar* sender,
+		   guint        id);
+
+void
+rate_limit_get_sender_stats (RateLimit*   self,
+			     const gchar* sender,
+			     guint*       dropped,
+			     guint*       coalesced);
+
+void
+rate_limit_foreach (RateLimit*    self,
+		    RateLimitFunc func,
+		    gpointer      user_data);
+
+G_END_DECLS
+
+#endif /* __RATE_LIMIT_H */
@@ -68,10 +68,10 @@ surface_stack_blur (cairo_surface_t* surface,
 	if (radius < 1)
 		break;
 
-	gint* r = (gint*) g_malloc0 (wh);
-	gint* g = (gint*) g_malloc0 (wh);
-	gint* b = (gint*) g_malloc0 (wh);
-	gint* a = (gint*) g_malloc0 (wh);
+	gint* r = (gint*) g_malloc0 (wh * sizeof (gint));
+	gint* g = (gint*) g_malloc0 (wh * sizeof (gint));
+	gint* b = (gint*) g_malloc0 (wh * sizeof (gint));
+	gint* a = (gint*) g_malloc0 (wh * sizeof (gint));
 
 	gint rsum;
 	gint gsum;
@@ -85,11 +85,11 @@ surface_stack_blur (cairo_surface_t* surface,
 	gint yw;
 	gint* dv = NULL;
 
-	gint* vmin = (gint*) g_malloc0 (MAX (w, h));
+	gint* vmin = (gint*) g_malloc0 (MAX (w, h) * sizeof (gint));
 
 	gint divsum = (div + 1) >> 1;
 	divsum *= divsum;
-	dv = (gint*) g_malloc0 (256 * divsum);
+	dv = (gint*) g_malloc0 (256 * divsum * sizeof (gint));
 	g_assert (dv != NULL);
 
 	for (i = 0; i < 256 * divsum; ++i)
@@ -97,10 +97,10 @@ surface_stack_blur (cairo_surface_t* surface,
 
 	yw = yi = 0;
 
-	gint** stack =  (gint**) g_malloc0 (div);
+	gint** stack =  (gint**) g_malloc0 (div * sizeof (gint*));
 
 	for (i = 0; i < div; ++i)
-		stack[i] = (gint*) g_malloc0 (4);
+		stack[i] = (gint*) g_malloc0 (4 * sizeof (gint));
 
 	gint  stackpointer;
 	gint  stackstart;
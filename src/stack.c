@@ -31,19 +31,46 @@
 *******************************************************************************/
 
 #include <assert.h>
+#include <string.h>
 #include "dbus.h"
-#include <dbus/dbus-glib-lowlevel.h>
 #include <glib-object.h>
 #include "stack.h"
+#include "stack-glue.h"
+#include "stats.h"
+#include "trace.h"
 #include "bubble.h"
 #include "apport.h"
 #include "dialog.h"
 #include "dnd.h"
 #include "log.h"
+#include "animation.h"
+#include "timer-wheel.h"
 
 G_DEFINE_TYPE (Stack, stack, G_TYPE_OBJECT);
 
-#define FORCED_SHUTDOWN_THRESHOLD 500
+// number of notifications after which notify-osd restarts itself, 0 never
+gint FORCED_SHUTDOWN_THRESHOLD = 500;
+
+// number of bubbles on screen at the same time, one of them being the sync.
+// bubble, 2..STACK_MAX_SLOTS
+gint STACK_SLOTS = 2;
+
+// non-urgent bubbles arriving while the user must not be disturbed are held
+// back and shown once that's over, instead of being dropped
+gint DND_HOLD = 0;
+
+// seconds between checks whether bubbles held back can be shown again
+#define DND_RELEASE_INTERVAL 2
+
+extern gint BACKLOG_COLLAPSE;
+
+// the queued bubble a sender's collapsed ones are counted in
+typedef struct _Summary
+{
+	Bubble* bubble;
+	guint   count;
+} Summary;
+
 #define NOTIFY_EXPIRES_DEFAULT -1
 
 /* fwd declaration */
@@ -54,6 +81,58 @@ void close_handler (GObject* n, Stack*  stack);
 static void
 stack_dispose (GObject* gobject)
 {
+	Stack* self = STACK (gobject);
+
+	if (self->stage_id)
+	{
+		g_source_remove (self->stage_id);
+		self->stage_id = 0;
+	}
+
+	g_list_free_full (self->staged, g_object_unref);
+	self->staged = NULL;
+
+	if (self->prerender_id)
+	{
+		g_source_remove (self->prerender_id);
+		self->prerender_id = 0;
+	}
+
+	g_list_free (self->unrendered);
+	self->unrendered = NULL;
+
+	if (self->skeleton)
+	{
+		g_dbus_interface_skeleton_unexport (self->skeleton);
+		g_object_unref (self->skeleton);
+		self->skeleton = NULL;
+	}
+
+	if (self->stats_skeleton)
+	{
+		g_dbus_interface_skeleton_unexport (self->stats_skeleton);
+		g_object_unref (self->stats_skeleton);
+		self->stats_skeleton = NULL;
+	}
+
+	rate_limit_free (self->rate_limit);
+	self->rate_limit = NULL;
+
+	backlog_free (self->backlog);
+	self->backlog = NULL;
+
+	if (self->summaries)
+	{
+		g_hash_table_destroy (self->summaries);
+		self->summaries = NULL;
+	}
+
+	if (self->dnd_release_id)
+	{
+		g_source_remove (self->dnd_release_id);
+		self->dnd_release_id = 0;
+	}
+
 	/* chain up to the parent class */
 	G_OBJECT_CLASS (stack_parent_class)->dispose (gobject);
 }
@@ -90,7 +169,17 @@ stack_init (Stack* self)
 	** initialization, delay initialization completion until the
 	** property is set. */
 
-	self->list = NULL;
+	self->list     = NULL;
+	self->staged   = NULL;
+	self->stage_id = 0;
+	self->unrendered   = NULL;
+	self->prerender_id = 0;
+	self->skeleton = NULL;
+	self->stats_skeleton = NULL;
+	self->rate_limit = NULL;
+	self->backlog = NULL;
+	self->summaries = NULL;
+	self->dnd_release_id = 0;
 }
 
 static void
@@ -107,8 +196,6 @@ stack_get_property (GObject*    gobject,
 	}
 }
 
-#include "stack-glue.h"
-
 static void
 stack_class_init (StackClass* klass)
 {
@@ -117,9 +204,6 @@ stack_class_init (StackClass* klass)
 	gobject_class->dispose      = stack_dispose;
 	gobject_class->finalize     = stack_finalize;
 	gobject_class->get_property = stack_get_property;
-
-	dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (klass),
-					 &dbus_glib_stack_object_info);
 }
 
 gint
@@ -244,6 +328,37 @@ find_bubble_for_append(Stack* self,
 	return (Bubble*) entry->data;
 }
 
+// whether a notification of sender with this summary ends up appended to a
+// bubble already in the stack, see compare_append()
+static gboolean
+_will_append (Stack*       self,
+	      const gchar* sender,
+	      const gchar* summary)
+{
+	GList*  list;
+	Bubble* bubble;
+
+	for (list = self->list; list != NULL; list = g_list_next (list))
+	{
+		bubble = (Bubble*) list->data;
+
+		if (bubble_is_append_allowed (bubble) &&
+		    !g_strcmp0 (bubble_get_title (bubble), summary) &&
+		    !g_strcmp0 (bubble_get_sender (bubble), sender))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+_is_summary_of (gpointer key,
+		gpointer value,
+		gpointer data)
+{
+	return ((Summary*) value)->bubble == data;
+}
+
 static void
 _weak_notify_cb (gpointer data,
 		 GObject* former_object)
@@ -251,6 +366,12 @@ _weak_notify_cb (gpointer data,
 	Stack* stack = STACK (data);
 
 	stack->list = g_list_remove (stack->list, former_object);
+	stack->unrendered = g_list_remove (stack->unrendered, former_object);
+
+	if (stack->summaries)
+		g_hash_table_foreach_remove (stack->summaries,
+					     _is_summary_of,
+					     former_object);
 }
 
 static void
@@ -276,12 +397,373 @@ value_changed_handler (Defaults* defaults,
 {
 	if (stack->list != NULL)
 		g_list_foreach (stack->list, _trigger_bubble_redraw, NULL);
+
+	stack_reflow_slots (stack);
 }
 
 static Bubble *sync_bubble = NULL;
 
+/* fwd declarations */
+static void _prerender_bubble (Stack* self, Bubble* bubble);
+static void _schedule_prerender (Stack* self);
+static void _collapse_backlog (Stack* self);
+static void _stack_reflow (Stack* self, guint from);
+
+// number of bubbles waiting for their turn
+static guint
+_stack_get_backlog (Stack* self)
+{
+	GList* list;
+	guint  backlog = 0;
+
+	for (list = self->list; list != NULL; list = g_list_next (list))
+		if (!bubble_is_visible (BUBBLE (list->data)) &&
+		    !bubble_is_synchronous (BUBBLE (list->data)))
+			backlog++;
+
+	return backlog;
+}
+
+// number of bubbles held back until the user may be disturbed again
+static guint
+_stack_get_dnd_held (Stack* self)
+{
+	GList*  list;
+	Bubble* bubble;
+	guint   held = 0;
+
+	if (!self->dnd_release_id)
+		return 0;
+
+	for (list = self->list; list != NULL; list = g_list_next (list))
+	{
+		bubble = BUBBLE (list->data);
+		if (!bubble_is_visible (bubble) &&
+		    !bubble_is_synchronous (bubble) &&
+		    !bubble_is_urgent (bubble))
+			held++;
+	}
+
+	return held;
+}
+
 #include "display.c"
 
+// the icon of a bubble finished loading in the background (or we gave up
+// waiting for it), so the bubble can finally be laid out for real and shown
+static void
+icon_ready_handler (Bubble* bubble,
+		    Stack*  stack)
+{
+	// still waiting for _stage_handler(), which takes care of it anyway
+	if (g_list_find (stack->staged, bubble))
+		return;
+
+	// not laid out at all yet, that happens once it's up next
+	if (g_list_find (stack->unrendered, bubble))
+	{
+		stack_layout (stack);
+		return;
+	}
+
+	bubble_determine_layout (bubble);
+	bubble_recalc_size (bubble);
+	bubble_refresh (bubble);
+	stack_resize_slot (stack, bubble);
+
+	stack_layout (stack);
+}
+
+// measures text and renders the tiles of a bubble, formerly done right in
+// stack_notify_handler() before replying to the client
+static void
+_stage_bubble_layout (Stack*  self,
+		      Bubble* bubble)
+{
+	bubble_determine_layout (bubble);
+	bubble_recalc_size (bubble);
+
+	// the bubbles after it make room for it, if it's on screen
+	stack_resize_slot (self, bubble);
+}
+
+// runs once per burst of Notify-calls, right before GTK+ redraws
+static gboolean
+_stage_handler (gpointer data)
+{
+	Stack*   self         = STACK (data);
+	GList*   staged       = self->staged;
+	GList*   list         = NULL;
+	gboolean needs_layout = FALSE;
+
+	self->staged   = NULL;
+	self->stage_id = 0;
+
+	for (list = staged; list != NULL; list = g_list_next (list))
+	{
+		Bubble* bubble = BUBBLE (list->data);
+
+		if (bubble_is_synchronous (bubble))
+		{
+			_stage_bubble_layout (self, bubble);
+			stack_display_sync_bubble (self, bubble);
+		}
+		else if (bubble_is_visible (bubble))
+		{
+			_stage_bubble_layout (self, bubble);
+			bubble_refresh (bubble);
+			needs_layout = TRUE;
+		}
+		else if (g_list_find (self->list, bubble))
+		{
+			// closed in the meantime otherwise, queued ones are
+			// only laid out once they're up next, anything done
+			// for them so far is stale now
+			if (!g_list_find (self->unrendered, bubble))
+				self->unrendered = g_list_append (self->unrendered,
+								  bubble);
+			needs_layout = TRUE;
+		}
+	}
+
+	g_list_free_full (staged, g_object_unref);
+
+	/* update the layout of the stack;
+	 * this will also open the new bubble */
+	if (needs_layout)
+		stack_layout (self);
+
+	return FALSE;
+}
+
+// lays out the bubble to be displayed next, unless that already happened
+static void
+_prerender_bubble (Stack*  self,
+		   Bubble* bubble)
+{
+	GList* link = g_list_find (self->unrendered, bubble);
+
+	if (!link)
+		return;
+
+	self->unrendered = g_list_delete_link (self->unrendered, link);
+	_stage_bubble_layout (self, bubble);
+}
+
+// measures and renders the next bubble while the current one is still on
+// display, so only moving and fading it in is left once it's its turn
+static gboolean
+_prerender_handler (gpointer data)
+{
+	Stack*   self = STACK (data);
+	Bubble*  bubble;
+	gboolean no_room;
+
+	self->prerender_id = 0;
+
+	bubble = stack_select_candidate (self, &no_room);
+	if (!bubble ||
+	    bubble_is_icon_pending (bubble) ||
+	    g_list_find (self->staged, bubble) ||
+	    !g_list_find (self->unrendered, bubble))
+		return FALSE;
+
+	_prerender_bubble (self, bubble);
+	stats_count (STATS_PRERENDERED);
+
+	// there was a vacant slot after all
+	if (!no_room)
+		stack_layout (self);
+
+	return FALSE;
+}
+
+// after anything that might change which bubble is up next
+static void
+_schedule_prerender (Stack* self)
+{
+	if (!self->unrendered || self->prerender_id)
+		return;
+
+	self->prerender_id = g_idle_add_full (G_PRIORITY_LOW,
+					      _prerender_handler,
+					      self,
+					      NULL);
+}
+
+static void
+_stage_bubble (Stack*  self,
+	       Bubble* bubble)
+{
+	if (!bubble || g_list_find (self->staged, bubble))
+		return;
+
+	self->staged = g_list_append (self->staged, g_object_ref (bubble));
+
+	// ahead of GDK_PRIORITY_REDRAW, so nothing is drawn with a stale size
+	if (!self->stage_id)
+		self->stage_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+						  _stage_handler,
+						  self,
+						  NULL);
+}
+
+// the queued "N more from X"-bubble of the sender, a summary already on
+// display doesn't count anymore
+static Summary*
+_get_summary (Stack*       self,
+	      const gchar* sender)
+{
+	Summary* summary;
+
+	summary = g_hash_table_lookup (self->summaries, sender ? sender : "");
+	if (summary && bubble_is_visible (summary->bubble))
+	{
+		g_hash_table_remove (self->summaries, sender ? sender : "");
+		summary = NULL;
+	}
+
+	return summary;
+}
+
+// urgent bubbles always get shown on their own
+static gboolean
+_is_collapsible (Stack*  self,
+		 Bubble* bubble)
+{
+	Summary* summary;
+
+	if (bubble_is_visible (bubble) ||
+	    bubble_is_synchronous (bubble) ||
+	    bubble_is_urgent (bubble))
+		return FALSE;
+
+	summary = g_hash_table_lookup (self->summaries,
+				       bubble_get_sender (bubble) ?
+				       bubble_get_sender (bubble) : "");
+
+	return !summary || summary->bubble != bubble;
+}
+
+// closes a queued bubble and counts it in the summary of its sender instead
+static void
+_collapse_bubble (Stack*  self,
+		  GList*  link)
+{
+	Bubble*      bubble   = BUBBLE (link->data);
+	const gchar* sender   = bubble_get_sender (bubble);
+	const gchar* app_name = bubble_get_app_name (bubble);
+	Summary*     summary;
+	gchar*       title;
+
+	summary = _get_summary (self, sender);
+	if (!summary)
+	{
+		summary = g_new0 (Summary, 1);
+		summary->bubble = bubble_new (self->defaults);
+		g_object_weak_ref (G_OBJECT (summary->bubble),
+				   _weak_notify_cb,
+				   (gpointer) self);
+		bubble_set_sender (summary->bubble, sender);
+		bubble_set_app_name (summary->bubble, app_name);
+		bubble_set_timeout (summary->bubble,
+				    defaults_get_on_screen_timeout (self->defaults));
+		stack_push_bubble (self, summary->bubble);
+		g_hash_table_insert (self->summaries,
+				     g_strdup (sender ? sender : ""),
+				     summary);
+	}
+
+	// the newest collapsed bubble makes it into the body
+	summary->count++;
+	title = g_strdup_printf ("%u more from %s",
+				 summary->count,
+				 app_name && *app_name ? app_name :
+				 (sender ? sender : "unknown"));
+	bubble_set_title (summary->bubble, title);
+	bubble_set_message_body (summary->bubble, bubble_get_title (bubble));
+	g_free (title);
+	_stage_bubble (self, summary->bubble);
+
+	dbus_send_close_signal (bubble_get_sender (bubble),
+				bubble_get_id (bubble),
+				1);
+	rate_limit_forget (self->rate_limit, sender, bubble_get_id (bubble));
+	self->list = g_list_delete_link (self->list, link);
+	backlog_note_drained (self->backlog, g_get_monotonic_time ());
+	stats_count (STATS_COLLAPSED);
+	g_object_unref (bubble);
+}
+
+// folds the tail of a sender's queued bubbles into a single "N more from
+// X"-bubble, once more than BACKLOG_COLLAPSE of them are waiting
+static void
+_collapse_backlog (Stack* self)
+{
+	GHashTable* queued; // sender -> number of its collapsible bubbles
+	GHashTable* kept;   // sender -> number of them left alone so far
+	GList*      list;
+	GList*      next;
+	guint       keep;
+
+	if (BACKLOG_COLLAPSE <= 0)
+		return;
+
+	// the summary takes the last place
+	keep = BACKLOG_COLLAPSE - 1;
+
+	// collapsed bubbles take their sender-string with them
+	queued = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	kept   = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (list = self->list; list != NULL; list = g_list_next (list))
+	{
+		Bubble*      bubble = BUBBLE (list->data);
+		const gchar* sender = bubble_get_sender (bubble);
+
+		if (!_is_collapsible (self, bubble))
+			continue;
+
+		sender = sender ? sender : "";
+		g_hash_table_insert (queued,
+				     g_strdup (sender),
+				     GUINT_TO_POINTER (GPOINTER_TO_UINT (
+					g_hash_table_lookup (queued, sender)) + 1));
+	}
+
+	for (list = self->list; list != NULL; list = next)
+	{
+		Bubble*      bubble = BUBBLE (list->data);
+		const gchar* sender = bubble_get_sender (bubble);
+		guint        n;
+
+		next = g_list_next (list);
+
+		if (!_is_collapsible (self, bubble))
+			continue;
+
+		sender = sender ? sender : "";
+		if (!_get_summary (self, sender) &&
+		    GPOINTER_TO_UINT (g_hash_table_lookup (queued, sender)) <=
+		    (guint) BACKLOG_COLLAPSE)
+			continue;
+
+		n = GPOINTER_TO_UINT (g_hash_table_lookup (kept, sender));
+		if (n < keep)
+		{
+			g_hash_table_insert (kept,
+					     g_strdup (sender),
+					     GUINT_TO_POINTER (n + 1));
+			continue;
+		}
+
+		_collapse_bubble (self, list);
+	}
+
+	g_hash_table_destroy (kept);
+	g_hash_table_destroy (queued);
+}
+
 /*-- public API --------------------------------------------------------------*/
 
 Stack*
@@ -301,8 +783,26 @@ stack_new (Defaults* defaults,
 	this->observer           = observer;
 	this->list               = NULL;
 	this->next_id            = 1;
-	this->slots[SLOT_TOP]    = NULL;
-	this->slots[SLOT_BOTTOM] = NULL;
+	this->n_slots            = CLAMP (STACK_SLOTS, 2, STACK_MAX_SLOTS);
+	memset (this->slots, 0, sizeof (this->slots));
+	memset (this->slot_heights, 0, sizeof (this->slot_heights));
+	memset (this->slot_offsets, 0, sizeof (this->slot_offsets));
+	this->staged             = NULL;
+	this->stage_id           = 0;
+	this->unrendered         = NULL;
+	this->prerender_id       = 0;
+	this->skeleton           = NULL;
+	this->stats_skeleton     = NULL;
+	this->rate_limit         = rate_limit_new ();
+	this->backlog            = backlog_new ();
+	this->summaries          = g_hash_table_new_full (g_str_hash,
+							  g_str_equal,
+							  g_free,
+							  g_free);
+	this->dnd_release_id     = 0;
+
+	// no bubbles yet, but the offsets of the slots are needed right away
+	_stack_reflow (this, this->n_slots);
 
 	/* hook up handler to act on changes of defaults/settings */
 	g_signal_connect (G_OBJECT (defaults),
@@ -435,63 +935,235 @@ stack_pop_bubble_by_id (Stack* self,
 	/* close/hide/fade-out bubble */
 	bubble_hide (bubble);
 
+	/* nothing left to coalesce with */
+	rate_limit_forget (self->rate_limit, bubble_get_sender (bubble), id);
+
 	/* find entry in list corresponding to id and remove it */
 	self->list = g_list_delete_link (self->list,
 					 find_entry_by_id (self, id));
+	backlog_note_drained (self->backlog, g_get_monotonic_time ());
 	g_object_unref (bubble);
 
 	/* immediately refresh the layout of the stack */
 	stack_layout (self);
 }
 
-static GdkPixbuf*
-process_dbus_icon_data (GValue *data)
-{
-	GType dbus_icon_t;
-	GArray *pixels;
-	int width, height, rowstride, bits_per_sample, n_channels, size;
-	gboolean has_alpha;
-	guchar *copy;
-	GdkPixbuf *pixbuf = NULL;
-
-	g_return_val_if_fail (data != NULL, NULL);
-
-	dbus_icon_t = dbus_g_type_get_struct ("GValueArray",
-					      G_TYPE_INT,
-					      G_TYPE_INT,
-					      G_TYPE_INT,
-					      G_TYPE_BOOLEAN,
-					      G_TYPE_INT,
-					      G_TYPE_INT,
-					      dbus_g_type_get_collection ("GArray",
-									  G_TYPE_UCHAR),
-					      G_TYPE_INVALID);
-	
-	if (G_VALUE_HOLDS (data, dbus_icon_t))
+static void
+process_dbus_icon_data (Bubble*   bubble,
+			GVariant* data)
+{
+	GVariant*     pixels;
+	const guchar* bytes;
+	gsize         length;
+	gint          width, height, rowstride, bits_per_sample, n_channels;
+	gboolean      has_alpha;
+
+	g_return_if_fail (data != NULL);
+
+	if (!g_variant_is_of_type (data, G_VARIANT_TYPE ("(iiibiiay)")))
 	{
-		dbus_g_type_struct_get (data,
-					0, &width,
-					1, &height,
-					2, &rowstride,
-					3, &has_alpha,
-					4, &bits_per_sample,
-					5, &n_channels,
-					6, &pixels,
-					G_MAXUINT);
-
-		size = (height - 1) * rowstride + width *
-			((n_channels * bits_per_sample + 7) / 8);
-		copy = (guchar *) g_memdup (pixels->data, size);
-		pixbuf = gdk_pixbuf_new_from_data(copy, GDK_COLORSPACE_RGB,
-						  has_alpha,
-						  bits_per_sample,
-						  width, height,
-						  rowstride,
-						  (GdkPixbufDestroyNotify)g_free,
-						  NULL);
+		g_warning ("image_data hint has wrong type '%s'\n",
+			   g_variant_get_type_string (data));
+		return;
+	}
+
+	g_variant_get (data,
+		       "(iiibii@ay)",
+		       &width,
+		       &height,
+		       &rowstride,
+		       &has_alpha,
+		       &bits_per_sample,
+		       &n_channels,
+		       &pixels);
+
+	// points right into the message-buffer, nothing is copied
+	bytes = g_variant_get_fixed_array (pixels, &length, sizeof (guchar));
+
+	bubble_set_icon_from_image_data (bubble,
+					 width,
+					 height,
+					 rowstride,
+					 has_alpha,
+					 bits_per_sample,
+					 n_channels,
+					 bytes,
+					 length);
+
+	g_variant_unref (pixels);
+}
+
+// the hints notify-osd knows about, strings point into the a{sv} passed to
+// Notify, so they are only valid during stack_notify_handler(), the GVariants
+// are owned, see clear_hints()
+typedef struct _NotifyHints
+{
+	gboolean     append;
+	gboolean     icon_only;
+	const gchar* synchronous;        // x-canonical-private-synchronous
+	const gchar* synchronous_compat; // synchronous
+	gboolean     has_value;
+	gint         value;
+	gboolean     has_urgency;
+	guchar       urgency;
+	GVariant*    image_data;
+	GVariant*    image_path;
+	GVariant*    icon_data;
+} NotifyHints;
+
+typedef enum
+{
+	HINT_APPEND = 0,
+	HINT_APPEND_COMPAT,
+	HINT_SYNCHRONOUS,
+	HINT_SYNCHRONOUS_COMPAT,
+	HINT_VALUE,
+	HINT_URGENCY,
+	HINT_ICON_ONLY,
+	HINT_ICON_ONLY_COMPAT,
+	HINT_IMAGE_DATA,
+	HINT_IMAGE_PATH,
+	HINT_ICON_DATA,
+	HINT_LAST
+} HintKey;
+
+static const gchar* hint_names[HINT_LAST] = {
+	"x-canonical-append",
+	"append",
+	"x-canonical-private-synchronous",
+	"synchronous",
+	"value",
+	"urgency",
+	"x-canonical-private-icon-only",
+	"icon-only",
+	"image_data",
+	"image_path",
+	"icon_data"
+};
+
+static GQuark hint_quarks[HINT_LAST] = { 0 };
+
+static HintKey
+hint_key_from_string (const gchar* key)
+{
+	GQuark quark;
+	gint   i;
+
+	if (G_UNLIKELY (!hint_quarks[0]))
+		for (i = 0; i < HINT_LAST; i++)
+			hint_quarks[i] = g_quark_from_static_string (hint_names[i]);
+
+	// keys never seen before can't be any of ours, no need to intern them
+	quark = g_quark_try_string (key);
+	if (!quark)
+		return HINT_LAST;
+
+	for (i = 0; i < HINT_LAST; i++)
+		if (hint_quarks[i] == quark)
+			return (HintKey) i;
+
+	return HINT_LAST;
+}
+
+// one pass over the hints, instead of one lookup per hint we care about
+static void
+decode_hints (GVariant*    hints,
+	      NotifyHints* out)
+{
+	GVariantIter iter;
+	const gchar* key;
+	GVariant*    value;
+
+	memset (out, 0, sizeof (NotifyHints));
+
+	if (!hints || !g_variant_is_of_type (hints, G_VARIANT_TYPE_VARDICT))
+		return;
+
+	g_variant_iter_init (&iter, hints);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value))
+	{
+		gboolean is_string = g_variant_is_of_type (value,
+							   G_VARIANT_TYPE_STRING);
+
+		switch (hint_key_from_string (key))
+		{
+			case HINT_APPEND:
+			case HINT_APPEND_COMPAT:
+				if (is_string)
+					out->append = TRUE;
+			break;
+
+			case HINT_SYNCHRONOUS:
+				if (is_string)
+					out->synchronous = g_variant_get_string (value, NULL);
+			break;
+
+			case HINT_SYNCHRONOUS_COMPAT:
+				if (is_string)
+					out->synchronous_compat = g_variant_get_string (value, NULL);
+			break;
+
+			case HINT_VALUE:
+				if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32))
+				{
+					out->has_value = TRUE;
+					out->value     = g_variant_get_int32 (value);
+				}
+			break;
+
+			case HINT_URGENCY:
+				/* Note: urgency was defined as an enum: LOW, NORMAL, CRITICAL
+				   So, 2 means CRITICAL
+				*/
+				if (g_variant_is_of_type (value, G_VARIANT_TYPE_BYTE))
+				{
+					out->has_urgency = TRUE;
+					out->urgency     = g_variant_get_byte (value);
+				}
+			break;
+
+			case HINT_ICON_ONLY:
+			case HINT_ICON_ONLY_COMPAT:
+				if (is_string)
+					out->icon_only = TRUE;
+			break;
+
+			case HINT_IMAGE_DATA:
+				if (!out->image_data)
+					out->image_data = g_variant_ref (value);
+			break;
+
+			case HINT_IMAGE_PATH:
+				if (!out->image_path)
+					out->image_path = g_variant_ref (value);
+			break;
+
+			case HINT_ICON_DATA:
+				if (!out->icon_data)
+					out->icon_data = g_variant_ref (value);
+			break;
+
+			default:
+			break;
+		}
+
+		g_variant_unref (value);
 	}
+}
+
+static void
+clear_hints (NotifyHints* hints)
+{
+	if (hints->image_data)
+		g_variant_unref (hints->image_data);
+
+	if (hints->image_path)
+		g_variant_unref (hints->image_path);
 
-	return pixbuf;
+	if (hints->icon_data)
+		g_variant_unref (hints->icon_data);
+
+	memset (hints, 0, sizeof (NotifyHints));
 }
 
 // control if there are non-default actions requested with this notification
@@ -557,43 +1229,39 @@ _arm_forced_quit (gpointer data)
 	return TRUE;
 }
 
-gboolean
-stack_notify_handler (Stack*                 self,
-		      const gchar*           app_name,
-		      guint                  id,
-		      const gchar*           icon,
-		      const gchar*           summary,
-		      const gchar*           body,
-		      gchar**                actions,
-		      GHashTable*            hints,
-		      gint                   timeout,
-		      DBusGMethodInvocation* context)
-{
-	Bubble*    bubble     = NULL;
-	Bubble*    app_bubble = NULL;
-	Bubble*	   bottom_bubble = NULL;
- 	gint	   x, y, temp_x, temp_y;
-	GValue*    data       = NULL;
-	GValue*    compat     = NULL;
-	GdkPixbuf* pixbuf     = NULL;
-	gboolean   new_bubble = FALSE;
-	gboolean   turn_into_dialog;
-
-	// check max. allowed limit queue-size
-	if (g_list_length (self->list) > MAX_STACK_SIZE)
-	{
-		GError* error = NULL;
+static gboolean
+_stack_is_full (Stack* self)
+{
+	return g_list_length (self->list) > MAX_STACK_SIZE;
+}
 
-		error = g_error_new (g_quark_from_string ("notify-osd"),
-		                     1,
-		                     "Reached stack-limit of %d",
-		                     MAX_STACK_SIZE);
-		dbus_g_method_return_error (context, error);
-		g_error_free (error);
-		error = NULL;
+// everything a single Notify does, apart from checking the stack-limit and
+// replying, returns the id of the notification, the bubble is measured and
+// rendered later on by _stage_handler(), returns 0 and sets error if the
+// sender exceeded its rate-limit
+static guint
+_notify (Stack*       self,
+	 const gchar* sender,
+	 const gchar* app_name,
+	 guint        id,
+	 const gchar* icon,
+	 const gchar* summary,
+	 const gchar* body,
+	 gchar**      actions,
+	 GVariant*    hints,
+	 gint         timeout,
+	 gint64       received,
+	 GError**     error)
+{
+	Bubble*     bubble     = NULL;
+	Bubble*     app_bubble = NULL;
+	NotifyHints h;
+	gboolean    new_bubble = FALSE;
+	gboolean    turn_into_dialog;
+	guint       coalesced_id;
+	guint       repeat     = 0;
 
-		return TRUE;
-	}
+	stats_count (STATS_RECEIVED);
 
 	// see if pathological actions or timeouts are used by an app issuing a
 	// notification
@@ -601,8 +1269,6 @@ stack_notify_handler (Stack*                 self,
 	if (turn_into_dialog)
 	{
 		// TODO: apport_report (app_name, summary, actions, timeout);
-		gchar* sender = dbus_g_method_get_sender (context);
-
 		fallback_dialog_show (self->defaults,
 				      sender,
 				      app_name,
@@ -610,40 +1276,93 @@ stack_notify_handler (Stack*                 self,
 				      summary,
 				      body,
 				      actions);
-		g_free (sender);
-		dbus_g_method_return (context, id);
 
-		return TRUE;
+		return id;
 	}
 
-        // check if a bubble exists with same id
+	decode_hints (hints, &h);
+
+	// only new, regular bubbles count against the rate-limit of a sender,
+	// a repetition of one still on screen just bumps its repeat-count,
+	// updates and lines appended to an existing bubble are exempt
+	if (!find_bubble_by_id (self, id) &&
+	    !h.synchronous &&
+	    !h.synchronous_compat &&
+	    !(h.append && _will_append (self, sender, summary)))
+	{
+		coalesced_id = rate_limit_find_recent (self->rate_limit,
+						       sender,
+						       summary,
+						       body,
+						       received);
+		bubble = find_bubble_by_id (self, coalesced_id);
+		if (!bubble && coalesced_id)
+			rate_limit_forget (self->rate_limit,
+					   sender,
+					   coalesced_id);
+		if (bubble)
+		{
+			gchar* title;
+
+			repeat = rate_limit_coalesce (self->rate_limit,
+						      sender,
+						      summary,
+						      body,
+						      received);
+			title = g_strdup_printf ("%s (\xc3\x97%u)",
+						 summary ? summary : "",
+						 repeat);
+			bubble_set_title (bubble, title);
+			g_free (title);
+
+			clear_hints (&h);
+			bubble_set_notify_time (bubble, received);
+			stack_push_bubble (self, bubble);
+			log_bubble (bubble, app_name, "coalesced");
+			stats_count (STATS_COALESCED);
+			_stage_bubble (self, bubble);
+
+			return coalesced_id;
+		}
+
+		if (!rate_limit_take_token (self->rate_limit,
+					    sender,
+					    received))
+		{
+			clear_hints (&h);
+			stats_count (STATS_REJECTED);
+			g_set_error (error,
+				     g_quark_from_string ("notify-osd"),
+				     2,
+				     "Rate-limit of %s exceeded",
+				     sender ? sender : "sender");
+
+			return 0;
+		}
+	}
+
+        // check if a bubble exists with same id
 	bubble = find_bubble_by_id (self, id);
 	if (bubble == NULL)
 	{
-		gchar *sender;
 		new_bubble = TRUE;
 		bubble = bubble_new (self->defaults);
 		g_object_weak_ref (G_OBJECT (bubble),
 				   _weak_notify_cb,
 				   (gpointer) self);
 		
-		sender = dbus_g_method_get_sender (context);
 		bubble_set_sender (bubble, sender);
-		g_free (sender);
-	}
+		bubble_set_app_name (bubble, app_name);
 
-	if (new_bubble && hints)
-	{
-		data   = (GValue*) g_hash_table_lookup (hints, "x-canonical-append");
-		compat = (GValue*) g_hash_table_lookup (hints, "append");
-
-		if ((data && G_VALUE_HOLDS_STRING (data)) ||
-		    (compat && G_VALUE_HOLDS_STRING (compat)))
-			bubble_set_append (bubble, TRUE);
-		else
-			bubble_set_append (bubble, FALSE);
+		g_signal_connect (G_OBJECT (bubble),
+				  "icon-ready",
+				  G_CALLBACK (icon_ready_handler),
+				  self);
 	}
 
+	if (new_bubble)
+		bubble_set_append (bubble, h.append);
+
 	if (summary)
 		bubble_set_title (bubble, summary);
 	if (body)
@@ -672,114 +1391,67 @@ stack_notify_handler (Stack*                 self,
 		}
 	}
 
-	if (hints)
+	if (h.synchronous || h.synchronous_compat)
 	{
-		data   = (GValue*) g_hash_table_lookup (hints, "x-canonical-private-synchronous");
-		compat = (GValue*) g_hash_table_lookup (hints, "synchronous");
-		if ((data && G_VALUE_HOLDS_STRING (data)) || (compat && G_VALUE_HOLDS_STRING (compat)))
+		if (sync_bubble != NULL
+		    && IS_BUBBLE (sync_bubble))
 		{
-			if (sync_bubble != NULL
-			    && IS_BUBBLE (sync_bubble))
-			{
-				g_object_unref (bubble);
-				bubble = sync_bubble;
-			}
+			g_object_unref (bubble);
+			bubble = sync_bubble;
+		}
 
-			if (data && G_VALUE_HOLDS_STRING (data))
-				bubble_set_synchronous (bubble, g_value_get_string (data));
+		if (h.synchronous)
+			bubble_set_synchronous (bubble, h.synchronous);
 
-			if (compat && G_VALUE_HOLDS_STRING (compat))
-				bubble_set_synchronous (bubble, g_value_get_string (compat));
-		}
+		if (h.synchronous_compat)
+			bubble_set_synchronous (bubble, h.synchronous_compat);
 	}
 
-	if (hints)
-	{
-		data = (GValue*) g_hash_table_lookup (hints, "value");
-		if (data && G_VALUE_HOLDS_INT (data))
-			bubble_set_value (bubble, g_value_get_int (data));
-	}
+	if (h.has_value)
+		bubble_set_value (bubble, h.value);
+
+	if (h.has_urgency)
+		bubble_set_urgency (bubble, h.urgency);
+
+	bubble_set_icon_only (bubble, h.icon_only);
 
-	if (hints)
+	if (h.image_data)
 	{
-		data = (GValue*) g_hash_table_lookup (hints, "urgency");
-		if (data && G_VALUE_HOLDS_UCHAR (data))
-			bubble_set_urgency (bubble,
-					   g_value_get_uchar (data));
-		/* Note: urgency was defined as an enum: LOW, NORMAL, CRITICAL
-		   So, 2 means CRITICAL
-		*/
+		g_debug("Using image_data hint\n");
+		process_dbus_icon_data (bubble, h.image_data);
 	}
-
-	if (hints)
+	else if (h.image_path)
 	{
-		data   = (GValue*) g_hash_table_lookup (hints, "x-canonical-private-icon-only");
-		compat = (GValue*) g_hash_table_lookup (hints, "icon-only");
-		if ((data && G_VALUE_HOLDS_STRING (data)) || (compat && G_VALUE_HOLDS_STRING (compat)))
-			bubble_set_icon_only (bubble, TRUE);
+		g_debug("Using image_path hint\n");
+		if (g_variant_is_of_type (h.image_path, G_VARIANT_TYPE_STRING))
+			bubble_set_icon_from_path (bubble,
+						   g_variant_get_string (h.image_path,
+									 NULL));
 		else
-			bubble_set_icon_only (bubble, FALSE);
+			g_warning ("image_path hint is not a string\n");
 	}
-
-	if (hints)
+	else if (icon && *icon != '\0')
 	{
-		if ((data = (GValue*) g_hash_table_lookup (hints, "image_data")))
-		{
-			g_debug("Using image_data hint\n");
-			pixbuf = process_dbus_icon_data (data);
-			bubble_set_icon_from_pixbuf (bubble, pixbuf);
-		}
-		else if ((data = (GValue*) g_hash_table_lookup (hints, "image_path")))
-		{
-			g_debug("Using image_path hint\n");
-			if ((data && G_VALUE_HOLDS_STRING (data)))
-				bubble_set_icon_from_path (bubble, g_value_get_string(data));
-			else
-				g_warning ("image_path hint is not a string\n");
-		}
-		else if (icon && *icon != '\0')
-		{
-			g_debug("Using icon parameter\n");
-			bubble_set_icon (bubble, icon);
-		}
-		else if ((data = (GValue*) g_hash_table_lookup (hints, "icon_data")))
-		{
-			g_debug("Using deprecated icon_data hint\n");
-			pixbuf = process_dbus_icon_data (data);
-			bubble_set_icon_from_pixbuf (bubble, pixbuf);
-		}
+		g_debug("Using icon parameter\n");
+		bubble_set_icon (bubble, icon);
+	}
+	else if (h.icon_data)
+	{
+		g_debug("Using deprecated icon_data hint\n");
+		process_dbus_icon_data (bubble, h.icon_data);
 	}
 
 	log_bubble_debug (bubble, app_name,
-			  (*icon == '\0' && data != NULL) ?
+			  (*icon == '\0' &&
+			   (h.image_data || h.image_path || h.icon_data)) ?
 			  "..." : icon);
 
-	bubble_determine_layout (bubble);
-	
-	if (defaults_get_gravity (self->defaults) == GRAVITY_SOUTH_EAST)
- 		bubble_get_position(bubble, &temp_x, &temp_y); 
+	clear_hints (&h);
 
-	bubble_recalc_size (bubble);
-	
-	if (defaults_get_gravity (self->defaults) == GRAVITY_SOUTH_EAST)
- 	{
- 		bubble_get_position(bubble, &x, &y);
- 		y = y - temp_y;
- 
- 		if (self->slots[SLOT_TOP] == bubble)
- 		{
- 			
- 			bottom_bubble = self->slots[SLOT_BOTTOM];
- 			bubble_get_position(bottom_bubble, &temp_x, &temp_y);
- 			bubble_move(bottom_bubble, temp_x, temp_y + y);
- 		}
- 	}
- 
-
-	if (bubble_is_synchronous (bubble))
+	bubble_set_notify_time (bubble, received);
+
+	if (!bubble_is_synchronous (bubble))
 	{
-		stack_display_sync_bubble (self, bubble);
-	} else {
 		stack_push_bubble (self, bubble);
 
 		if (! new_bubble && bubble_is_append_allowed (bubble))
@@ -789,21 +1461,27 @@ stack_notify_handler (Stack*                 self,
 		else
 			log_bubble (bubble, app_name, "");
 
-		/* make sure the sync. bubble is positioned correctly
-		   even for the append case
-		*/
-		// no longer needed since we have the two-slots mechanism now
-		//if (sync_bubble != NULL
-		//    && bubble_is_visible (sync_bubble))
-		//	stack_display_position_sync_bubble (self, sync_bubble);
-
-		/* update the layout of the stack;
-		 * this will also open the new bubble */
-		stack_layout (self);
+		if (app_bubble)
+			stats_count (STATS_APPENDED);
+		else if (! new_bubble)
+			stats_count (STATS_REPLACED);
+
+		// replaced or appended-to bubbles no longer show what they
+		// were remembered for
+		if (new_bubble && !app_bubble)
+			rate_limit_remember (self->rate_limit,
+					     sender,
+					     summary,
+					     body,
+					     bubble_get_id (bubble),
+					     received);
+		else
+			rate_limit_forget (self->rate_limit,
+					   sender,
+					   bubble_get_id (bubble));
 	}
 
-	if (bubble)
-		dbus_g_method_return (context, bubble_get_id (bubble));
+	_stage_bubble (self, bubble);
 
 	// FIXME: this is a temporary work-around, I do not like at all, until
 	// the heavy memory leakage of notify-osd is fully fixed...
@@ -812,14 +1490,164 @@ stack_notify_handler (Stack*                 self,
 	// to be displayed), in order to get the leaked memory freed again, any
 	// new notifications, coming in after the shutdown, will instruct the
 	// session to restart notify-osd
-	if (bubble_get_id (bubble) == FORCED_SHUTDOWN_THRESHOLD)
-		g_timeout_add (defaults_get_on_screen_timeout (self->defaults),
-			       _arm_forced_quit,
-			       (gpointer) self);
+	if (FORCED_SHUTDOWN_THRESHOLD > 0 &&
+	    bubble_get_id (bubble) == (guint) FORCED_SHUTDOWN_THRESHOLD)
+		timer_wheel_add (defaults_get_on_screen_timeout (self->defaults),
+				 _arm_forced_quit,
+				 (gpointer) self);
+
+	return bubble_get_id (bubble);
+}
+
+gboolean
+stack_notify_handler (Stack*                 self,
+		      const gchar*           app_name,
+		      guint                  id,
+		      const gchar*           icon,
+		      const gchar*           summary,
+		      const gchar*           body,
+		      gchar**                actions,
+		      GVariant*              hints,
+		      gint                   timeout,
+		      GDBusMethodInvocation* context)
+{
+	gint64  received = g_get_monotonic_time ();
+	GError* error    = NULL;
+
+	// check max. allowed limit queue-size
+	if (_stack_is_full (self))
+	{
+		stats_count (STATS_RECEIVED);
+		stats_count (STATS_REJECTED);
+		g_dbus_method_invocation_return_error (
+			context,
+			g_quark_from_string ("notify-osd"),
+			1,
+			"Reached stack-limit of %d",
+			MAX_STACK_SIZE);
+
+		return TRUE;
+	}
+
+	id = _notify (self,
+		      g_dbus_method_invocation_get_sender (context),
+		      app_name,
+		      id,
+		      icon,
+		      summary,
+		      body,
+		      actions,
+		      hints,
+		      timeout,
+		      received,
+		      &error);
+
+	if (error)
+	{
+		g_dbus_method_invocation_take_error (context, error);
+		return TRUE;
+	}
+
+	// the id is all the client waits for, the reply goes out before any
+	// text is measured or tiles are rendered, see _stage_handler()
+	g_dbus_method_invocation_return_value (context,
+					       g_variant_new ("(u)", id));
+
+	stats_add_sample (STATS_REPLY_LATENCY,
+			  g_get_monotonic_time () - received);
+	trace_span (TRACE_NOTIFY, id, received);
 
 	return TRUE;
 }
 
+gboolean
+stack_notify_batch_handler (Stack*                 self,
+			    GVariant*              notifications,
+			    GDBusMethodInvocation* context)
+{
+	GVariantIter    iter;
+	GVariantBuilder ids;
+	const gchar*    sender;
+	const gchar*    app_name;
+	const gchar*    icon;
+	const gchar*    summary;
+	const gchar*    body;
+	const gchar**   actions;
+	GVariant*       hints;
+	guint           id;
+	gint            timeout;
+	gint64          received = g_get_monotonic_time ();
+	GError*         error    = NULL;
+
+	sender = g_dbus_method_invocation_get_sender (context);
+	g_variant_builder_init (&ids, G_VARIANT_TYPE ("au"));
+
+	// every entry is handled exactly like a Notify of its own, all of them
+	// end up in the same _stage_handler() run, thus one layout-pass only
+	g_variant_iter_init (&iter, notifications);
+	while (g_variant_iter_next (&iter,
+				    "(&su&s&s&s^a&s@a{sv}i)",
+				    &app_name,
+				    &id,
+				    &icon,
+				    &summary,
+				    &body,
+				    &actions,
+				    &hints,
+				    &timeout))
+	{
+		// the stack- and rate-limit refuse single entries, 0 is never a
+		// valid id
+		if (_stack_is_full (self))
+		{
+			stats_count (STATS_RECEIVED);
+			stats_count (STATS_REJECTED);
+			id = 0;
+		}
+		else
+			id = _notify (self,
+				      sender,
+				      app_name,
+				      id,
+				      icon,
+				      summary,
+				      body,
+				      (gchar**) actions,
+				      hints,
+				      timeout,
+				      received,
+				      &error);
+
+		g_clear_error (&error);
+
+		g_variant_builder_add (&ids, "u", id);
+
+		g_free (actions);
+		g_variant_unref (hints);
+	}
+
+	g_dbus_method_invocation_return_value (context,
+					       g_variant_new ("(au)", &ids));
+
+	stats_add_sample (STATS_REPLY_LATENCY,
+			  g_get_monotonic_time () - received);
+	trace_span (TRACE_NOTIFY_BATCH, 0, received);
+
+	return TRUE;
+}
+
+void
+stack_get_sender_stats (Stack*       self,
+			const gchar* sender,
+			guint*       dropped,
+			guint*       coalesced)
+{
+	rate_limit_get_sender_stats (self ? self->rate_limit : NULL,
+				     sender,
+				     dropped,
+				     coalesced);
+}
+
 gboolean
 stack_close_notification_handler (Stack*   self,
 				  guint    id,
@@ -854,7 +1682,7 @@ gboolean
 stack_get_capabilities (Stack*   self,
 			gchar*** out_caps)
 {
-	*out_caps = g_malloc0 (13 * sizeof(char *));
+	*out_caps = g_malloc0 (14 * sizeof(char *));
 
 	(*out_caps)[0]  = g_strdup ("body");
 	(*out_caps)[1]  = g_strdup ("body-markup");
@@ -873,7 +1701,10 @@ stack_get_capabilities (Stack*   self,
 	(*out_caps)[10] = g_strdup ("private-icon-only");
 	(*out_caps)[11] = g_strdup ("truncation");
 
-	(*out_caps)[12] = NULL;
+	/* vendor-extension, NotifyBatch() for high-rate producers */
+	(*out_caps)[12] = g_strdup ("x-canonical-notify-batch");
+
+	(*out_caps)[13] = NULL;
 
 	return TRUE;
 }
@@ -893,6 +1724,425 @@ stack_get_server_information (Stack*  self,
 	return TRUE;
 }
 
+// glue between the generated org.freedesktop.Notifications skeleton and the
+// handlers above
+
+static gboolean
+_handle_notify (OsdNotifications*      object,
+		GDBusMethodInvocation* invocation,
+		const gchar*           app_name,
+		guint                  id,
+		const gchar*           icon,
+		const gchar*           summary,
+		const gchar*           body,
+		const gchar* const*    actions,
+		GVariant*              hints,
+		gint                   timeout,
+		gpointer               user_data)
+{
+	return stack_notify_handler (STACK (user_data),
+				     app_name,
+				     id,
+				     icon,
+				     summary,
+				     body,
+				     (gchar**) actions,
+				     hints,
+				     timeout,
+				     invocation);
+}
+
+static gboolean
+_handle_notify_batch (OsdNotifications*      object,
+		      GDBusMethodInvocation* invocation,
+		      GVariant*              notifications,
+		      gpointer               user_data)
+{
+	return stack_notify_batch_handler (STACK (user_data),
+					   notifications,
+					   invocation);
+}
+
+static gboolean
+_handle_close_notification (OsdNotifications*      object,
+			    GDBusMethodInvocation* invocation,
+			    guint                  id,
+			    gpointer               user_data)
+{
+	GError* error = NULL;
+
+	if (stack_close_notification_handler (STACK (user_data), id, &error))
+		osd_notifications_complete_close_notification (object,
+							       invocation);
+	else
+		g_dbus_method_invocation_take_error (invocation, error);
+
+	return TRUE;
+}
+
+static gboolean
+_handle_get_capabilities (OsdNotifications*      object,
+			  GDBusMethodInvocation* invocation,
+			  gpointer               user_data)
+{
+	gchar** caps = NULL;
+
+	stack_get_capabilities (STACK (user_data), &caps);
+	osd_notifications_complete_get_capabilities (object,
+						     invocation,
+						     (const gchar* const*) caps);
+	g_strfreev (caps);
+
+	return TRUE;
+}
+
+static gboolean
+_handle_get_server_information (OsdNotifications*      object,
+				GDBusMethodInvocation* invocation,
+				gpointer               user_data)
+{
+	gchar* name     = NULL;
+	gchar* vendor   = NULL;
+	gchar* version  = NULL;
+	gchar* spec_ver = NULL;
+
+	stack_get_server_information (STACK (user_data),
+				      &name,
+				      &vendor,
+				      &version,
+				      &spec_ver);
+	osd_notifications_complete_get_server_information (object,
+							   invocation,
+							   name,
+							   vendor,
+							   version,
+							   spec_ver);
+	g_free (name);
+	g_free (vendor);
+	g_free (version);
+	g_free (spec_ver);
+
+	return TRUE;
+}
+
+// glue for org.freedesktop.Notifications.Stats
+
+static gboolean
+_handle_get_counters (OsdNotificationsStats* object,
+		      GDBusMethodInvocation* invocation,
+		      gpointer               user_data)
+{
+	GVariantBuilder counters;
+	StatsEvent      event;
+	AnimationStats  animation_stats;
+
+	g_variant_builder_init (&counters, G_VARIANT_TYPE ("a{su}"));
+
+	for (event = 0; event < STATS_EVENT_LAST; event++)
+		g_variant_builder_add (&counters,
+				       "{su}",
+				       stats_get_event_name (event),
+				       stats_get_count (event));
+
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "queue-depth",
+			       g_list_length (STACK (user_data)->list));
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "backlog",
+			       _stack_get_backlog (STACK (user_data)));
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "drain-rate",
+			       backlog_get_drain_rate (STACK (user_data)->backlog,
+						       g_get_monotonic_time ()));
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "dnd-held",
+			       _stack_get_dnd_held (STACK (user_data)));
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "log-dropped",
+			       log_get_dropped ());
+	animation_get_stats (&animation_stats);
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "animation-frames",
+			       animation_stats.frames);
+	g_variant_builder_add (&counters,
+			       "{su}",
+			       "animation-dropped-frames",
+			       animation_stats.dropped);
+
+	osd_notifications_stats_complete_get_counters (
+		object,
+		invocation,
+		g_variant_builder_end (&counters));
+
+	return TRUE;
+}
+
+static void
+_add_sender_counters (const gchar* sender,
+		      guint        dropped,
+		      guint        coalesced,
+		      gpointer     user_data)
+{
+	g_variant_builder_add ((GVariantBuilder*) user_data,
+			       "(suu)",
+			       sender,
+			       dropped,
+			       coalesced);
+}
+
+static gboolean
+_handle_get_sender_counters (OsdNotificationsStats* object,
+			     GDBusMethodInvocation* invocation,
+			     gpointer               user_data)
+{
+	GVariantBuilder senders;
+
+	g_variant_builder_init (&senders, G_VARIANT_TYPE ("a(suu)"));
+	rate_limit_foreach (STACK (user_data)->rate_limit,
+			    _add_sender_counters,
+			    &senders);
+
+	osd_notifications_stats_complete_get_sender_counters (
+		object,
+		invocation,
+		g_variant_builder_end (&senders));
+
+	return TRUE;
+}
+
+static gboolean
+_handle_get_histograms (OsdNotificationsStats* object,
+			GDBusMethodInvocation* invocation,
+			gpointer               user_data)
+{
+	GVariantBuilder histograms;
+	GVariantBuilder buckets;
+	StatsSample     sample;
+	StatsCounter    counter;
+	guint           i;
+
+	g_variant_builder_init (&histograms,
+				G_VARIANT_TYPE ("a{s(uxxa(xu))}"));
+
+	for (counter = 0; counter < STATS_LAST; counter++)
+	{
+		stats_get (counter, &sample);
+
+		// only the non-empty buckets, most of them are
+		g_variant_builder_init (&buckets, G_VARIANT_TYPE ("a(xu)"));
+		for (i = 0; i < STATS_N_BUCKETS; i++)
+			if (sample.buckets[i])
+				g_variant_builder_add (&buckets,
+						       "(xu)",
+						       stats_get_bucket_start (i),
+						       sample.buckets[i]);
+
+		g_variant_builder_add (&histograms,
+				       "{s(uxxa(xu))}",
+				       stats_get_name (counter),
+				       sample.count,
+				       sample.total,
+				       sample.max,
+				       &buckets);
+	}
+
+	osd_notifications_stats_complete_get_histograms (
+		object,
+		invocation,
+		g_variant_builder_end (&histograms));
+
+	return TRUE;
+}
+
+static gboolean
+_handle_get_trace (OsdNotificationsStats* object,
+		   GDBusMethodInvocation* invocation,
+		   gpointer               user_data)
+{
+	gchar* json = trace_to_json ();
+
+	osd_notifications_stats_complete_get_trace (object, invocation, json);
+	g_free (json);
+
+	return TRUE;
+}
+
+static gboolean
+_handle_reset_histograms (OsdNotificationsStats* object,
+			  GDBusMethodInvocation* invocation,
+			  gpointer               user_data)
+{
+	stats_reset ();
+	osd_notifications_stats_complete_reset_histograms (object, invocation);
+
+	return TRUE;
+}
+
+gboolean
+stack_export (Stack*           self,
+	      GDBusConnection* connection,
+	      const gchar*     object_path,
+	      GError**         error)
+{
+	OsdNotifications*      skeleton;
+	OsdNotificationsStats* stats_skeleton;
+
+	if (!self || !IS_STACK (self) || !connection)
+		return FALSE;
+
+	skeleton = osd_notifications_skeleton_new ();
+
+	g_signal_connect (skeleton,
+			  "handle-notify",
+			  G_CALLBACK (_handle_notify),
+			  self);
+	g_signal_connect (skeleton,
+			  "handle-notify-batch",
+			  G_CALLBACK (_handle_notify_batch),
+			  self);
+	g_signal_connect (skeleton,
+			  "handle-close-notification",
+			  G_CALLBACK (_handle_close_notification),
+			  self);
+	g_signal_connect (skeleton,
+			  "handle-get-capabilities",
+			  G_CALLBACK (_handle_get_capabilities),
+			  self);
+	g_signal_connect (skeleton,
+			  "handle-get-server-information",
+			  G_CALLBACK (_handle_get_server_information),
+			  self);
+
+	if (!g_dbus_interface_skeleton_export (
+			G_DBUS_INTERFACE_SKELETON (skeleton),
+			connection,
+			object_path,
+			error))
+	{
+		g_object_unref (skeleton);
+		return FALSE;
+	}
+
+	self->skeleton = G_DBUS_INTERFACE_SKELETON (skeleton);
+
+	stats_skeleton = osd_notifications_stats_skeleton_new ();
+
+	g_signal_connect (stats_skeleton,
+			  "handle-get-counters",
+			  G_CALLBACK (_handle_get_counters),
+			  self);
+	g_signal_connect (stats_skeleton,
+			  "handle-get-sender-counters",
+			  G_CALLBACK (_handle_get_sender_counters),
+			  self);
+	g_signal_connect (stats_skeleton,
+			  "handle-get-histograms",
+			  G_CALLBACK (_handle_get_histograms),
+			  self);
+	g_signal_connect (stats_skeleton,
+			  "handle-get-trace",
+			  G_CALLBACK (_handle_get_trace),
+			  self);
+	g_signal_connect (stats_skeleton,
+			  "handle-reset-histograms",
+			  G_CALLBACK (_handle_reset_histograms),
+			  self);
+
+	if (!g_dbus_interface_skeleton_export (
+			G_DBUS_INTERFACE_SKELETON (stats_skeleton),
+			connection,
+			object_path,
+			error))
+	{
+		g_object_unref (stats_skeleton);
+		return FALSE;
+	}
+
+	self->stats_skeleton = G_DBUS_INTERFACE_SKELETON (stats_skeleton);
+
+	return TRUE;
+}
+
+// the first slot not meant for a sync. bubble, with fixed allocation the top
+// slot is kept for those
+static guint
+_first_async_slot (Stack* self)
+{
+	return defaults_get_slot_allocation (self->defaults) ==
+	       SLOT_ALLOCATION_FIXED ? SLOT_BOTTOM : SLOT_TOP;
+}
+
+// vertical space the bubble in slot takes up for the slots after it, the top
+// slot is special with fixed allocation and for the east/west gravities, it
+// doesn't depend on the bubble in it then
+static gint
+_get_slot_step (Stack* self,
+		guint  slot)
+{
+	Defaults* d = self->defaults;
+
+	if (slot == SLOT_TOP)
+	{
+		switch (defaults_get_gravity (d))
+		{
+			case GRAVITY_EAST:
+			case GRAVITY_WEST:
+				// sits above the center, the others below it
+				return 0;
+
+			default:
+				if (defaults_get_slot_allocation (d) ==
+				    SLOT_ALLOCATION_FIXED)
+					return EM2PIXELS (defaults_get_icon_size (d), d) +
+					       2 * EM2PIXELS (defaults_get_margin_size (d), d) +
+					       EM2PIXELS (defaults_get_bubble_vert_gap (d), d) + 2;
+			break;
+		}
+	}
+
+	if (!self->slots[slot])
+		return 0;
+
+	return self->slot_heights[slot] +
+	       EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
+	       2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
+}
+
+// updates the cached offsets of all slots, that's just a few additions, and
+// moves the bubbles from slot from on to their new position, the ones above
+// stay untouched
+static void
+_stack_reflow (Stack* self,
+	       guint  from)
+{
+	guint slot;
+	gint  x;
+	gint  y;
+
+	self->slot_offsets[0] = 0;
+	for (slot = 0; slot < self->n_slots; slot++)
+	{
+		self->slot_offsets[slot + 1] = self->slot_offsets[slot] +
+					       _get_slot_step (self, slot);
+
+		if (slot < from || !self->slots[slot])
+			continue;
+
+		stack_get_slot_position (self,
+					 slot,
+					 self->slot_heights[slot],
+					 &x,
+					 &y);
+		bubble_move (self->slots[slot], x, y);
+	}
+}
+
 gboolean
 stack_is_slot_vacant (Stack* self,
                       Slot   slot)
@@ -901,12 +2151,49 @@ stack_is_slot_vacant (Stack* self,
 	if (!self || !IS_STACK (self))
 		return FALSE;
 
-	if (slot != SLOT_TOP && slot != SLOT_BOTTOM)
+	if (slot < SLOT_TOP || (guint) slot >= self->n_slots)
 		return FALSE;
 
 	return self->slots[slot] == NULL ? VACANT : OCCUPIED;
 }
 
+guint
+stack_get_n_slots (Stack* self)
+{
+	if (!self || !IS_STACK (self))
+		return 0;
+
+	return self->n_slots;
+}
+
+Slot
+stack_find_vacant_slot (Stack*   self,
+			gboolean synchronous)
+{
+	guint first;
+	guint slot;
+	guint async = 0;
+
+	if (!self || !IS_STACK (self))
+		return SLOT_NONE;
+
+	// one slot is always kept for a sync. bubble
+	for (slot = 0; slot < self->n_slots; slot++)
+		if (self->slots[slot] &&
+		    !bubble_is_synchronous (self->slots[slot]))
+			async++;
+
+	if (!synchronous && async >= self->n_slots - 1)
+		return SLOT_NONE;
+
+	first = synchronous ? SLOT_TOP : _first_async_slot (self);
+	for (slot = first; slot < self->n_slots; slot++)
+		if (!self->slots[slot])
+			return slot;
+
+	return SLOT_NONE;
+}
+
 // return values of -1 for x and y indicate an error by the caller
 void
 stack_get_slot_position (Stack* self,
@@ -915,6 +2202,9 @@ stack_get_slot_position (Stack* self,
                          gint*  x,
                          gint*  y)
 {
+	Defaults* d;
+	gint      offset;
+
 	// sanity checks
 	if (!x && !y)
 		return;
@@ -926,224 +2216,61 @@ stack_get_slot_position (Stack* self,
 		return;
 	}
 
-	if (slot != SLOT_TOP && slot != SLOT_BOTTOM)
+	if (slot < SLOT_TOP || (guint) slot >= self->n_slots)
 	{
 		*x = -1;
 		*y = -1;
 		return;
 	}
 
-	// initialize x and y
-	defaults_get_top_corner (self->defaults, x, y);
-
-	// differentiate returned top-left corner for top and bottom slot
-	// depending on the placement 
-	switch (defaults_get_gravity (self->defaults))
-	{
-		Defaults* d;
-
-		case GRAVITY_EAST:
-			d = self->defaults;
-
-			// the position for the sync./feedback bubble
-			if (slot == SLOT_TOP)
-				*y += defaults_get_desktop_height (d) / 2 -
-				      EM2PIXELS (defaults_get_bubble_vert_gap (d) / 2.0f, d) -
-				      bubble_height +
-				      EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-			// the position for the async. bubble
-			else if (slot == SLOT_BOTTOM)
-				*y += defaults_get_desktop_height (d) / 2 +
-				      EM2PIXELS (defaults_get_bubble_vert_gap (d) / 2.0f, d) -
-				      EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-		break;
-
-		case GRAVITY_NORTH_EAST:
-			d = self->defaults;
+	d = self->defaults;
 
-			// there's nothing to do for slot == SLOT_TOP as we
-			// already have correct x and y from the call to
-			// defaults_get_top_corner() earlier
+	// initialize x and y
+	defaults_get_top_corner (d, x, y);
 
-			// this needs to look at the height of the bubble in the
-			// top slot
-			if (slot == SLOT_BOTTOM)
-			{
-				switch (defaults_get_slot_allocation (d))
-				{
-					case SLOT_ALLOCATION_FIXED:
-						*y += EM2PIXELS (defaults_get_icon_size (d), d) +
-						      2 * EM2PIXELS (defaults_get_margin_size (d), d) +
-						      EM2PIXELS (defaults_get_bubble_vert_gap (d), d) + 2;
-					break;
-
-					case SLOT_ALLOCATION_DYNAMIC:
-						g_assert (stack_is_slot_vacant (self, SLOT_TOP) == OCCUPIED);
-						*y += bubble_get_height (self->slots[SLOT_TOP]) +
-						      EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-						      2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-					break;
-
-					default:
-					break;
-				}
+	// the slots below (or above) this one are laid out from here, based
+	// on the cached heights of the bubbles in the slots before it
+	offset = self->slot_offsets[slot];
 
-			}
-		break;
-		
+	switch (defaults_get_gravity (d))
+	{
 		case GRAVITY_WEST:
-			d = self->defaults;
-
 			*x = defaults_get_desktop_left (d);
+			// fall through
 
+		case GRAVITY_EAST:
 			// the position for the sync./feedback bubble
 			if (slot == SLOT_TOP)
 				*y += defaults_get_desktop_height (d) / 2 -
 				      EM2PIXELS (defaults_get_bubble_vert_gap (d) / 2.0f, d) -
 				      bubble_height +
 				      EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-			// the position for the async. bubble
-			else if (slot == SLOT_BOTTOM)
+			// the positions for the async. bubbles
+			else
 				*y += defaults_get_desktop_height (d) / 2 +
 				      EM2PIXELS (defaults_get_bubble_vert_gap (d) / 2.0f, d) -
-				      EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
+				      EM2PIXELS (defaults_get_bubble_shadow_size (d), d) +
+				      offset;
 		break;
 
 		case GRAVITY_NORTH_WEST:
-			d = self->defaults;
-
 			*x = defaults_get_desktop_left (d);
+			// fall through
 
-			if (slot == SLOT_BOTTOM)
-			{
-				switch (defaults_get_slot_allocation (d))
-				{
-					case SLOT_ALLOCATION_FIXED:
-						*y += EM2PIXELS (defaults_get_icon_size (d), d) +
-						      2 * EM2PIXELS (defaults_get_margin_size (d), d) +
-						      EM2PIXELS (defaults_get_bubble_vert_gap (d), d) + 2;
-					break;
-
-					case SLOT_ALLOCATION_DYNAMIC:
-						g_assert (stack_is_slot_vacant (self, SLOT_TOP) == OCCUPIED);
-						*y += bubble_get_height (self->slots[SLOT_TOP]) +
-						      EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-						      2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-					break;
-
-					default:
-					break;
-				}
-
-			}
-		break;
-		
- 		case GRAVITY_SOUTH_EAST:
- 			d = self->defaults;
- 			
-			switch (defaults_get_slot_allocation (d))
-			{
-				case SLOT_ALLOCATION_FIXED:
-					if (slot == SLOT_TOP)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  2 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-							  
-					}
-		 
-					if (slot == SLOT_BOTTOM)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  bubble_height -
-							  EM2PIXELS (defaults_get_icon_size (d), d) -
-						      2 * EM2PIXELS (defaults_get_margin_size (d), d) -
-						      3 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) +
-						      2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d) - 2;
-							  
-					}
-				break;
-
-				case SLOT_ALLOCATION_DYNAMIC:
-					if (slot == SLOT_TOP)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  2 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-					}
-		 
-					if (slot == SLOT_BOTTOM)
-					{
-						g_assert (stack_is_slot_vacant (self, SLOT_TOP) == OCCUPIED);
-						*y += defaults_get_desktop_height (d) -
-							  3 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  4 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d) -
-							  bubble_get_height (self->slots[SLOT_TOP]);
-					}
-				break;
-
-				default:
-				break;
-			}
-				
+		case GRAVITY_NORTH_EAST:
+			*y += offset;
 		break;
-		
- 		case GRAVITY_SOUTH_WEST:
- 			d = self->defaults;
- 			
- 			*x = defaults_get_desktop_left (d);
- 			
-			switch (defaults_get_slot_allocation (d))
-			{
-				case SLOT_ALLOCATION_FIXED:
-					if (slot == SLOT_TOP)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  2 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-							  
-					}
-		 
-					if (slot == SLOT_BOTTOM)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  bubble_height -
-							  EM2PIXELS (defaults_get_icon_size (d), d) -
-						      2 * EM2PIXELS (defaults_get_margin_size (d), d) -
-						      3 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) +
-						      2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d) - 2;
-							  
-					}
-				break;
-
-				case SLOT_ALLOCATION_DYNAMIC:
-					if (slot == SLOT_TOP)
-					{
-						*y += defaults_get_desktop_height (d) -
-							  2 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d);
-					}
-		 
-					if (slot == SLOT_BOTTOM)
-					{
-						g_assert (stack_is_slot_vacant (self, SLOT_TOP) == OCCUPIED);
-						*y += defaults_get_desktop_height (d) -
-							  3 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
-							  bubble_height +
-							  4 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d) -
-							  bubble_get_height (self->slots[SLOT_TOP]);
-					}
-				break;
 
-				default:
-				break;
-			}
-				
+		case GRAVITY_SOUTH_WEST:
+			*x = defaults_get_desktop_left (d);
+			// fall through
+
+		case GRAVITY_SOUTH_EAST:
+			*y += defaults_get_desktop_height (d) -
+			      2 * EM2PIXELS (defaults_get_bubble_vert_gap (d), d) -
+			      bubble_height +
+			      2 * EM2PIXELS (defaults_get_bubble_shadow_size (d), d) -
+			      offset;
 		break;
 
 		default:
@@ -1165,7 +2292,7 @@ stack_allocate_slot (Stack*  self,
 	if (!bubble || !IS_BUBBLE (bubble))
 		return FALSE;
 
-	if (slot != SLOT_TOP && slot != SLOT_BOTTOM)
+	if (slot < SLOT_TOP || (guint) slot >= self->n_slots)
 		return FALSE;
 
 	if (stack_is_slot_vacant (self, slot))
@@ -1173,6 +2300,13 @@ stack_allocate_slot (Stack*  self,
 	else
 		return FALSE;
 
+	self->slot_heights[slot] = bubble_get_height (bubble);
+
+	// only the slots after this one have to make room for it
+	_stack_reflow (self, slot + 1);
+
+	trace_mark (TRACE_SLOT_ALLOCATE, bubble_get_id (bubble));
+
 	return TRUE;
 }
 
@@ -1181,6 +2315,9 @@ gboolean
 stack_free_slot (Stack*  self,
 		 Bubble* bubble)
 {
+	guint slot;
+	guint first;
+
 	// sanity checks
 	if (!self || !IS_STACK (self))
 		return FALSE;
@@ -1188,19 +2325,76 @@ stack_free_slot (Stack*  self,
 	if (!bubble || !IS_BUBBLE (bubble))
 		return FALSE;
 
-	// check top and bottom slots for bubble pointer equality
-	if (bubble == self->slots[SLOT_TOP])
-	{
-		g_object_unref (self->slots[SLOT_TOP]);
-		self->slots[SLOT_TOP] = NULL;
-	}
-	else if (bubble == self->slots[SLOT_BOTTOM])
+	// check all slots for bubble pointer equality
+	for (slot = 0; slot < self->n_slots; slot++)
+		if (self->slots[slot] == bubble)
+			break;
+
+	if (slot == self->n_slots)
+		return FALSE;
+
+	g_object_unref (self->slots[slot]);
+	self->slots[slot] = NULL;
+
+	// close the gap, the bubbles after the freed slot move up one slot
+	first = _first_async_slot (self);
+	if (slot >= first)
 	{
-		g_object_unref (self->slots[SLOT_BOTTOM]);
-		self->slots[SLOT_BOTTOM] = NULL;
+		guint last = slot;
+
+		for (; last + 1 < self->n_slots && self->slots[last + 1]; last++)
+		{
+			self->slots[last]        = self->slots[last + 1];
+			self->slot_heights[last] = self->slot_heights[last + 1];
+		}
+
+		self->slots[last] = NULL;
 	}
-	else
-		return FALSE;
+
+	_stack_reflow (self, slot);
+
+	trace_mark (TRACE_SLOT_FREE, bubble_get_id (bubble));
 
 	return TRUE;	
 }
+
+// call this after the bubble got resized, it keeps its slot, but all the
+// bubbles after it are moved to make room for it (or to close the gap)
+void
+stack_resize_slot (Stack*  self,
+		   Bubble* bubble)
+{
+	guint slot;
+
+	if (!self || !IS_STACK (self) || !bubble)
+		return;
+
+	for (slot = 0; slot < self->n_slots; slot++)
+		if (self->slots[slot] == bubble)
+			break;
+
+	if (slot == self->n_slots ||
+	    self->slot_heights[slot] == bubble_get_height (bubble))
+		return;
+
+	self->slot_heights[slot] = bubble_get_height (bubble);
+	_stack_reflow (self, slot);
+}
+
+// defaults (gravity, font-size, ...) changed, every slot has to be laid out
+// anew
+void
+stack_reflow_slots (Stack* self)
+{
+	guint slot;
+
+	if (!self || !IS_STACK (self))
+		return;
+
+	for (slot = 0; slot < self->n_slots; slot++)
+		if (self->slots[slot])
+			self->slot_heights[slot] =
+				bubble_get_height (self->slots[slot]);
+
+	_stack_reflow (self, 0);
+}
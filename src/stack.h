@@ -30,12 +30,13 @@
 #define __STACK_H
 
 #include <glib-object.h>
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-bindings.h>
+#include <gio/gio.h>
 
 #include "defaults.h"
 #include "bubble.h"
 #include "observer.h"
+#include "rate-limit.h"
+#include "backlog.h"
 
 G_BEGIN_DECLS
 
@@ -48,14 +49,21 @@ G_BEGIN_DECLS
 
 #define MAX_STACK_SIZE 50
 
+// upper limit for the number of slots bubbles are shown in at the same time
+#define STACK_MAX_SLOTS 16
+
 #define VACANT   TRUE
 #define OCCUPIED FALSE
 
 typedef struct _Stack      Stack;
 typedef struct _StackClass StackClass;
 
+// slots are numbered from the top (or bottom, for the south gravities) corner
+// on, the top one is meant for the sync. bubble, the async. bubbles take all
+// the others (and the top one too, with dynamic slot-allocation)
 typedef enum
 {
+	SLOT_NONE = -1,
 	SLOT_TOP = 0,
 	SLOT_BOTTOM
 } Slot;
@@ -70,7 +78,20 @@ struct _Stack
 	Observer* observer;
 	GList*    list;
 	guint     next_id;
-	Bubble*   slots[2]; // NULL: vacant, non-NULL: occupied
+	Bubble*   slots[STACK_MAX_SLOTS]; // NULL: vacant, non-NULL: occupied
+	gint      slot_heights[STACK_MAX_SLOTS]; // of the bubbles in the slots
+	gint      slot_offsets[STACK_MAX_SLOTS + 1]; // distance to the corner
+	guint     n_slots;
+	GList*    staged;   // bubbles replied to, but not yet measured/laid out
+	guint     stage_id;
+	GList*    unrendered;   // queued, measured/rendered once up next, no refs
+	guint     prerender_id;
+	GDBusInterfaceSkeleton* skeleton;
+	GDBusInterfaceSkeleton* stats_skeleton;
+	RateLimit* rate_limit; // per-sender token-buckets and coalescing
+	Backlog*    backlog;   // drain-rate of the queue
+	GHashTable* summaries; // sender -> its queued "N more from X"-bubble
+	guint       dnd_release_id; // non-urgent bubbles are held while set
 };
 
 /* class structure */
@@ -104,9 +125,16 @@ stack_notify_handler (Stack*                 self,
 		      const gchar*           summary,
 		      const gchar*           body,
 		      gchar**                actions,
-		      GHashTable*            hints,
+		      GVariant*              hints,
 		      gint                   timeout,
-		      DBusGMethodInvocation* context);
+		      GDBusMethodInvocation* context);
+
+// vendor-extension, takes an array of Notify-arguments and returns the
+// array of their ids, entries refused due to the stack- or rate-limit get id 0
+gboolean
+stack_notify_batch_handler (Stack*                 self,
+			    GVariant*              notifications,
+			    GDBusMethodInvocation* context);
 
 gboolean
 stack_close_notification_handler (Stack*   self,
@@ -124,10 +152,35 @@ stack_get_server_information (Stack*  self,
 			      gchar** out_version,
 			      gchar** out_spec_ver);
 
+// number of notifications of sender refused by its token-bucket, resp. folded
+// into an identical bubble still on screen
+void
+stack_get_sender_stats (Stack*       self,
+			const gchar* sender,
+			guint*       dropped,
+			guint*       coalesced);
+
+// exports org.freedesktop.Notifications (and its Stats-interface) for this
+// stack on the given bus
+gboolean
+stack_export (Stack*           self,
+	      GDBusConnection* connection,
+	      const gchar*     object_path,
+	      GError**         error);
+
 gboolean
 stack_is_slot_vacant (Stack* self,
                       Slot   slot);
 
+guint
+stack_get_n_slots (Stack* self);
+
+// first vacant slot for a (sync.) bubble, SLOT_NONE if there's none, one slot
+// is always kept for a sync. bubble
+Slot
+stack_find_vacant_slot (Stack*   self,
+			gboolean synchronous);
+
 void
 stack_get_slot_position (Stack* self,
                          Slot   slot,
@@ -144,6 +197,13 @@ gboolean
 stack_free_slot (Stack*  self,
 		 Bubble* bubble);
 
+void
+stack_resize_slot (Stack*  self,
+		   Bubble* bubble);
+
+void
+stack_reflow_slots (Stack* self);
+
 G_END_DECLS
 
 #endif /* __STACK_H */
@@ -0,0 +1,196 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** stats.c - event-counts and latency-histograms of the notification-path
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "stats.h"
+
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BITS)
+
+static StatsSample g_samples[STATS_LAST];
+static guint       g_events[STATS_EVENT_LAST];
+
+static const gchar* g_sample_names[STATS_LAST] = {
+	"reply-latency",
+	"first-frame",
+	"tile-background",
+	"tile-icon",
+	"tile-title",
+	"tile-body",
+	"tile-indicator",
+	"frame-render"
+};
+
+static const gchar* g_event_names[STATS_EVENT_LAST] = {
+	"received",
+	"displayed",
+	"replaced",
+	"appended",
+	"dropped-dnd",
+	"rejected",
+	"coalesced",
+	"prerendered",
+	"collapsed"
+};
+
+//-- private functions ---------------------------------------------------------
+
+// the first STATS_SUB_BUCKETS usec get a bucket each, above that the position
+// of the highest set bit picks the power of two and the STATS_SUB_BITS below
+// it the linear bucket inside of that
+static guint
+_get_bucket (gint64 usec)
+{
+	guint msb;
+	guint sub;
+
+	if (usec < STATS_SUB_BUCKETS)
+		return (guint) usec;
+
+	msb = g_bit_storage ((guint64) usec) - 1;
+	if (msb >= STATS_MAX_BITS)
+		return STATS_N_BUCKETS - 1;
+
+	sub = (usec >> (msb - STATS_SUB_BITS)) & (STATS_SUB_BUCKETS - 1);
+
+	return ((msb - STATS_SUB_BITS + 1) << STATS_SUB_BITS) + sub;
+}
+
+//-- public functions ----------------------------------------------------------
+
+void
+stats_add_sample (StatsCounter counter,
+		  gint64       usec)
+{
+	StatsSample* sample;
+
+	if (counter >= STATS_LAST || usec < 0)
+		return;
+
+	sample = &g_samples[counter];
+	sample->count++;
+	sample->total += usec;
+	if (usec > sample->max)
+		sample->max = usec;
+	sample->buckets[_get_bucket (usec)]++;
+}
+
+void
+stats_get (StatsCounter counter,
+	   StatsSample* sample)
+{
+	if (counter >= STATS_LAST || !sample)
+		return;
+
+	*sample = g_samples[counter];
+}
+
+gint64
+stats_get_bucket_start (guint bucket)
+{
+	guint msb;
+
+	if (bucket >= STATS_N_BUCKETS)
+		return -1;
+
+	if (bucket < STATS_SUB_BUCKETS)
+		return bucket;
+
+	msb = (bucket >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+
+	return ((gint64) 1 << msb) +
+	       ((gint64) (bucket & (STATS_SUB_BUCKETS - 1)) <<
+		(msb - STATS_SUB_BITS));
+}
+
+gint64
+stats_get_percentile (const StatsSample* sample,
+		      gdouble            fraction)
+{
+	guint64 rank;
+	guint64 seen = 0;
+	guint   i;
+
+	if (!sample || !sample->count)
+		return 0;
+
+	fraction = CLAMP (fraction, 0.0, 1.0);
+	rank = MAX (1, (guint64) (fraction * sample->count + 0.5));
+	if (rank >= sample->count)
+		return sample->max;
+
+	for (i = 0; i < STATS_N_BUCKETS; i++)
+	{
+		seen += sample->buckets[i];
+		if (seen >= rank)
+			return MIN (stats_get_bucket_start (i), sample->max);
+	}
+
+	return sample->max;
+}
+
+const gchar*
+stats_get_name (StatsCounter counter)
+{
+	if (counter >= STATS_LAST)
+		return NULL;
+
+	return g_sample_names[counter];
+}
+
+void
+stats_count (StatsEvent event)
+{
+	if (event >= STATS_EVENT_LAST)
+		return;
+
+	g_events[event]++;
+}
+
+guint
+stats_get_count (StatsEvent event)
+{
+	if (event >= STATS_EVENT_LAST)
+		return 0;
+
+	return g_events[event];
+}
+
+const gchar*
+stats_get_event_name (StatsEvent event)
+{
+	if (event >= STATS_EVENT_LAST)
+		return NULL;
+
+	return g_event_names[event];
+}
+
+void
+stats_reset (void)
+{
+	memset (g_samples, 0, sizeof (g_samples));
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** stats.h - event-counts and latency-histograms of the notification-path
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// histograms are log-linear: every power of two (in usec) is split into
+// 2^STATS_SUB_BITS linear buckets, thus any sample is off by 1/8 at most
+#define STATS_SUB_BITS    3
+#define STATS_MAX_BITS    40 // ~12 days, larger samples land in the last bucket
+#define STATS_N_BUCKETS   ((STATS_MAX_BITS - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+typedef enum
+{
+	STATS_REPLY_LATENCY = 0, // Notify received -> D-Bus reply sent
+	STATS_FIRST_FRAME,       // Notify received -> first frame of the bubble
+	STATS_TILE_BACKGROUND,   // refresh of the background tile
+	STATS_TILE_ICON,
+	STATS_TILE_TITLE,
+	STATS_TILE_BODY,
+	STATS_TILE_INDICATOR,
+	STATS_FRAME_RENDER,      // one expose of a bubble
+	STATS_LAST
+} StatsCounter;
+
+typedef enum
+{
+	STATS_RECEIVED = 0,
+	STATS_DISPLAYED,
+	STATS_REPLACED,
+	STATS_APPENDED,
+	STATS_DROPPED_DND,       // discarded, while the user did not want them
+	STATS_REJECTED,          // refused due to the stack- or rate-limit
+	STATS_COALESCED,         // folded into an identical bubble on screen
+	STATS_PRERENDERED,       // laid out while waiting for its turn
+	STATS_COLLAPSED,         // folded into a "N more from X"-bubble
+	STATS_EVENT_LAST
+} StatsEvent;
+
+typedef struct _StatsSample
+{
+	guint   count;
+	gint64  total; // usec
+	gint64  max;   // usec
+	guint   buckets[STATS_N_BUCKETS];
+} StatsSample;
+
+void
+stats_add_sample (StatsCounter counter,
+		  gint64       usec);
+
+void
+stats_get (StatsCounter counter,
+	   StatsSample* sample);
+
+// smallest sample (usec) that ends up in the given bucket
+gint64
+stats_get_bucket_start (guint bucket);
+
+// approximated sample (usec) below which the given fraction (0.0 - 1.0) of
+// the samples lie, 0 if there are none
+gint64
+stats_get_percentile (const StatsSample* sample,
+		      gdouble            fraction);
+
+// names as used on D-Bus, e.g. "reply-latency"
+const gchar*
+stats_get_name (StatsCounter counter);
+
+void
+stats_count (StatsEvent event);
+
+guint
+stats_get_count (StatsEvent event);
+
+const gchar*
+stats_get_event_name (StatsEvent event);
+
+// resets the histograms only, event-counts keep going up for the lifetime of
+// the daemon
+void
+stats_reset (void);
+
+G_END_DECLS
+
+#endif /* __STATS_H */
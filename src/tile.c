@@ -37,6 +37,7 @@ struct _tile_private_t
 	gboolean         use_padding;
 	guint            pad_width;
 	guint            pad_height;
+	guint            ref_count;
 };
 
 tile_t*
@@ -65,6 +66,7 @@ tile_new (cairo_surface_t* source, guint blur_radius)
 	tile->priv->use_padding = FALSE;
 	tile->priv->pad_width   = 0;
 	tile->priv->pad_height  = 0;
+	tile->priv->ref_count   = 1;
 
 	blur = raico_blur_create (RAICO_BLUR_QUALITY_LOW);
 	raico_blur_set_radius (blur, blur_radius);
@@ -107,6 +109,20 @@ tile_new_for_padding (cairo_surface_t* normal,
 	tile->priv->use_padding = TRUE;
 	tile->priv->pad_width   = cairo_image_surface_get_width (normal);
 	tile->priv->pad_height  = cairo_image_surface_get_height (normal);
+	tile->priv->ref_count   = 1;
+
+	return tile;
+}
+
+// tiles can be shared (e.g. by the icon-cache), tile_destroy() only frees
+// the surfaces once the last reference is dropped
+tile_t*
+tile_ref (tile_t* tile)
+{
+	if (!tile)
+		return NULL;
+
+	tile->priv->ref_count++;
 
 	return tile;
 }
@@ -117,6 +133,9 @@ tile_destroy (tile_t* tile)
 	if (!tile)
 		return;
 
+	if (--tile->priv->ref_count > 0)
+		return;
+
 	//cairo_surface_write_to_png (tile->priv->normal, "./tile-normal.png");
 	//cairo_surface_write_to_png (tile->priv->blurred, "./tile-blurred.png");
 
@@ -46,6 +46,9 @@ tile_t*
 tile_new_for_padding (cairo_surface_t* normal,
 		      cairo_surface_t* blurred);
 
+tile_t*
+tile_ref (tile_t* tile);
+
 void
 tile_destroy (tile_t* tile);
 
@@ -0,0 +1,484 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** timer-wheel.c - one hierarchical timer-wheel for all expiry-deadlines
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include "timer-wheel.h"
+
+// four levels of 64 slots each, level n holds the timers due within 64^(n+1)
+// ticks, so level 0 covers 640 ms and level 3 more than 46 hours, timers
+// further out are parked in the farthest slot and cascade down from there
+#define WHEEL_BITS    6
+#define WHEEL_SIZE    (1 << WHEEL_BITS)
+#define WHEEL_MASK    (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS  4
+#define WHEEL_TICKS   ((gint64) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+#define TICK_USEC     ((gint64) TIMER_WHEEL_TICK_MS * 1000)
+
+typedef struct _Timer Timer;
+
+struct _Timer
+{
+	Timer*      prev;     // circular list of the slot it's in,
+	Timer*      next;     // pointing to itself if it's in none
+	guint       id;
+	gint64      deadline; // usec, relative to tick 0
+	gint64      expires;  // tick, the deadline rounded up
+	guint       interval; // msecs
+	GSourceFunc func;
+	gpointer    data;
+	gboolean    running;  // func is being called
+	gboolean    moved;    // rescheduled from within its own func
+};
+
+// each slot is the sentinel of its list
+static Timer       g_slots[WHEEL_LEVELS][WHEEL_SIZE];
+static GHashTable* g_timers  = NULL; // id -> Timer
+static GSource*    g_source  = NULL;
+static gint64      g_origin  = 0;    // usec, monotonic time of tick 0
+static gint64      g_current = 0;    // next tick to run
+static gint64      g_armed   = -1;   // tick the source wakes up for
+static guint       g_next_id = 1;
+
+//-- private functions ---------------------------------------------------------
+
+static gint64
+_to_tick (gint64 usec)
+{
+	return (usec - g_origin) / TICK_USEC;
+}
+
+static gint64
+_deadline (guint msecs)
+{
+	return g_get_monotonic_time () - g_origin + (gint64) msecs * 1000;
+}
+
+static void
+_link (Timer* head,
+       Timer* timer)
+{
+	timer->prev       = head->prev;
+	timer->next       = head;
+	head->prev->next  = timer;
+	head->prev        = timer;
+}
+
+static void
+_unlink (Timer* timer)
+{
+	timer->prev->next = timer->next;
+	timer->next->prev = timer->prev;
+	timer->prev       = timer;
+	timer->next       = timer;
+}
+
+static gboolean
+_is_empty (Timer* head)
+{
+	return head->next == head;
+}
+
+// moves all timers of head to the (empty) list other
+static void
+_splice (Timer* head,
+	 Timer* other)
+{
+	other->next = other;
+	other->prev = other;
+
+	if (_is_empty (head))
+		return;
+
+	other->next       = head->next;
+	other->prev       = head->prev;
+	other->next->prev = other;
+	other->prev->next = other;
+	head->next        = head;
+	head->prev        = head;
+}
+
+// O(1), the level follows from how far out the timer is, the slot from the
+// bits of its expiry-tick for that level
+static void
+_place (Timer* timer)
+{
+	gint64 expires = MAX (timer->expires, g_current);
+	gint64 delta   = expires - g_current;
+	gint   level   = 0;
+
+	if (delta >= WHEEL_TICKS)
+	{
+		delta   = WHEEL_TICKS - 1;
+		expires = g_current + delta;
+	}
+
+	while (delta >= (gint64) 1 << (WHEEL_BITS * (level + 1)))
+		level++;
+
+	_link (&g_slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK],
+	       timer);
+}
+
+// re-places the timers of the current slot of level one level down, returns
+// the index of that slot
+static gint
+_cascade (gint level)
+{
+	Timer  list;
+	Timer* timer;
+	gint   index;
+
+	index = (g_current >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	_splice (&g_slots[level][index], &list);
+
+	while (!_is_empty (&list))
+	{
+		timer = list.next;
+		_unlink (timer);
+		_place (timer);
+	}
+
+	return index;
+}
+
+// the tick of the next deadline, or of the next cascade which may bring one
+// closer, -1 if no timer is armed
+static gint64
+_next_tick (void)
+{
+	gint64 next = G_MAXINT64;
+	gint64 base;
+	gint64 low;
+	gint   index;
+	gint   level;
+	gint   d;
+
+	if (!g_timers || !g_hash_table_size (g_timers))
+		return -1;
+
+	index = g_current & WHEEL_MASK;
+	for (d = 0; d < WHEEL_SIZE; d++)
+		if (!_is_empty (&g_slots[0][(index + d) & WHEEL_MASK]))
+		{
+			next = g_current + d;
+			break;
+		}
+
+	for (level = 1; level < WHEEL_LEVELS; level++)
+	{
+		base  = g_current >> (WHEEL_BITS * level);
+		low   = g_current & (((gint64) 1 << (WHEEL_BITS * level)) - 1);
+		index = base & WHEEL_MASK;
+
+		// the current slot of a level was cascaded already, unless
+		// the current tick is the one doing it, so it's the last one
+		for (d = low ? 1 : 0; d <= WHEEL_SIZE; d++)
+			if (!_is_empty (&g_slots[level][(index + d) & WHEEL_MASK]))
+				break;
+
+		if (d > WHEEL_SIZE)
+			continue;
+
+		next = MIN (next, (base + d) << (WHEEL_BITS * level));
+	}
+
+	return next;
+}
+
+static void
+_arm (gint64 tick)
+{
+	g_armed = tick;
+	g_source_set_ready_time (g_source,
+				 tick < 0 ? -1 : g_origin + tick * TICK_USEC);
+}
+
+static gboolean
+_dispatch (GSource*    source,
+	   GSourceFunc callback G_GNUC_UNUSED,
+	   gpointer    data G_GNUC_UNUSED)
+{
+	timer_wheel_advance (g_source_get_time (source));
+
+	return TRUE;
+}
+
+static GSourceFuncs g_source_funcs = {
+	NULL,
+	NULL,
+	_dispatch,
+	NULL
+};
+
+static void
+_init (void)
+{
+	gint level;
+	gint i;
+
+	if (g_timers)
+		return;
+
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		for (i = 0; i < WHEEL_SIZE; i++)
+		{
+			g_slots[level][i].prev = &g_slots[level][i];
+			g_slots[level][i].next = &g_slots[level][i];
+		}
+
+	g_timers  = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_origin  = g_get_monotonic_time ();
+	g_current = 0;
+
+	g_source = g_source_new (&g_source_funcs, sizeof (GSource));
+	g_source_set_name (g_source, "notify-osd timer-wheel");
+	g_source_attach (g_source, NULL);
+	_arm (-1);
+}
+
+static Timer*
+_lookup (guint id)
+{
+	if (!g_timers || !id)
+		return NULL;
+
+	return g_hash_table_lookup (g_timers, GUINT_TO_POINTER (id));
+}
+
+static void
+_set_deadline (Timer* timer,
+	       gint64 deadline)
+{
+	gint64 expires;
+
+	// round up, firing a bit late is fine, early is not
+	expires = (deadline + TICK_USEC - 1) / TICK_USEC;
+
+	timer->deadline = deadline;
+	timer->expires  = expires;
+
+	// the dispatch of its own func re-places it once that returns
+	if (timer->running)
+	{
+		timer->moved = TRUE;
+		return;
+	}
+
+	_unlink (timer);
+	_place (timer);
+
+	if (g_armed < 0 || expires < g_armed)
+		_arm (MAX (expires, g_current));
+}
+
+static void
+_run (Timer* timer,
+      gint64 now)
+{
+	gboolean again;
+
+	timer->running = TRUE;
+	timer->moved   = FALSE;
+	again = timer->func (timer->data);
+	timer->running = FALSE;
+
+	// removed from within func
+	if (_lookup (timer->id) != timer)
+	{
+		g_slice_free (Timer, timer);
+		return;
+	}
+
+	if (again || timer->moved)
+	{
+		if (!timer->moved)
+			_set_deadline (timer,
+				       now - g_origin +
+				       (gint64) timer->interval * 1000);
+		else
+			_place (timer);
+		return;
+	}
+
+	g_hash_table_remove (g_timers, GUINT_TO_POINTER (timer->id));
+	g_slice_free (Timer, timer);
+}
+
+//-- public functions ----------------------------------------------------------
+
+guint
+timer_wheel_add (guint       msecs,
+		 GSourceFunc func,
+		 gpointer    data)
+{
+	Timer* timer;
+
+	g_return_val_if_fail (func != NULL, 0);
+
+	_init ();
+
+	// nothing to catch up with, don't walk the idle ticks later
+	if (!g_hash_table_size (g_timers))
+		g_current = _to_tick (g_get_monotonic_time ());
+
+	// ids are only handed out once, skip 0 after wrapping around
+	if (G_UNLIKELY (g_next_id == 0))
+		g_next_id = 1;
+
+	timer           = g_slice_new0 (Timer);
+	timer->prev     = timer;
+	timer->next     = timer;
+	timer->id       = g_next_id++;
+	timer->interval = msecs;
+	timer->func     = func;
+	timer->data     = data;
+
+	g_hash_table_insert (g_timers, GUINT_TO_POINTER (timer->id), timer);
+	_set_deadline (timer, _deadline (msecs));
+
+	return timer->id;
+}
+
+gboolean
+timer_wheel_remove (guint id)
+{
+	Timer* timer = _lookup (id);
+
+	if (!timer)
+		return FALSE;
+
+	// a spurious wake-up for its deadline is cheaper than finding the
+	// next one right away
+	g_hash_table_remove (g_timers, GUINT_TO_POINTER (id));
+	_unlink (timer);
+
+	// freed once its func returns
+	if (!timer->running)
+		g_slice_free (Timer, timer);
+
+	return TRUE;
+}
+
+gboolean
+timer_wheel_reschedule (guint id,
+			guint msecs)
+{
+	Timer* timer = _lookup (id);
+
+	if (!timer)
+		return FALSE;
+
+	_set_deadline (timer, _deadline (msecs));
+
+	return TRUE;
+}
+
+gboolean
+timer_wheel_extend (guint id,
+		    guint msecs)
+{
+	Timer* timer = _lookup (id);
+
+	if (!timer)
+		return FALSE;
+
+	_set_deadline (timer, timer->deadline + (gint64) msecs * 1000);
+
+	return TRUE;
+}
+
+gint
+timer_wheel_get_remaining (guint id)
+{
+	Timer* timer = _lookup (id);
+	gint64 usec;
+
+	if (!timer)
+		return -1;
+
+	usec = g_origin + timer->deadline - g_get_monotonic_time ();
+
+	return (gint) CLAMP (usec / 1000, 0, G_MAXINT);
+}
+
+guint
+timer_wheel_get_pending (void)
+{
+	return g_timers ? g_hash_table_size (g_timers) : 0;
+}
+
+void
+timer_wheel_advance (gint64 now)
+{
+	Timer  list;
+	Timer* timer;
+	gint64 target;
+	gint   index;
+	gint   level;
+	gint   n;
+
+	if (!g_timers)
+		return;
+
+	target = _to_tick (now);
+
+	while (g_current <= target && g_hash_table_size (g_timers))
+	{
+		index = g_current & WHEEL_MASK;
+
+		// level 0 wrapped around, pull the next timers down
+		if (index == 0)
+			for (level = 1; level < WHEEL_LEVELS; level++)
+				if (_cascade (level) != 0)
+					break;
+
+		// skip a run of empty slots in one go, stopping at the next
+		// cascade
+		if (_is_empty (&g_slots[0][index]))
+		{
+			for (n = index + 1; n < WHEEL_SIZE; n++)
+				if (!_is_empty (&g_slots[0][n]))
+					break;
+
+			g_current += MIN (n - index, target + 1 - g_current);
+			continue;
+		}
+
+		// timers added by the callbacks for "now" go to the next tick
+		_splice (&g_slots[0][index], &list);
+		g_current++;
+
+		while (!_is_empty (&list))
+		{
+			timer = list.next;
+			_unlink (timer);
+			_run (timer, now);
+		}
+	}
+
+	// idle, the next timer added resyncs to the clock
+	if (!g_hash_table_size (g_timers))
+		g_current = MAX (g_current, target + 1);
+
+	_arm (_next_tick ());
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** timer-wheel.h - one hierarchical timer-wheel for all expiry-deadlines
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#ifndef __TIMER_WHEEL_H
+#define __TIMER_WHEEL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// granularity of all deadlines, they never fire early but up to this late
+#define TIMER_WHEEL_TICK_MS 10
+
+// calls func with data once msecs have passed, like g_timeout_add() func is
+// called again after another msecs if it returns TRUE, all timers share one
+// GSource on the default main-context waking up only for the next deadline,
+// returns the id (> 0) of the timer
+guint
+timer_wheel_add (guint       msecs,
+		 GSourceFunc func,
+		 gpointer    data);
+
+// FALSE if there's no such timer (e.g. it fired already), safe from within
+// any timer-callback including its own
+gboolean
+timer_wheel_remove (guint id);
+
+// moves the deadline to msecs from now
+gboolean
+timer_wheel_reschedule (guint id,
+			guint msecs);
+
+// pushes the deadline back by msecs
+gboolean
+timer_wheel_extend (guint id,
+		    guint msecs);
+
+// msecs left until the timer fires, -1 if there's no such timer
+gint
+timer_wheel_get_remaining (guint id);
+
+// number of timers currently armed
+guint
+timer_wheel_get_pending (void);
+
+// fires all timers due as of now (usec, g_get_monotonic_time()), called by
+// the GSource of the wheel, exposed for the unit-tests
+void
+timer_wheel_advance (gint64 now);
+
+G_END_DECLS
+
+#endif /* __TIMER_WHEEL_H */
@@ -25,19 +25,20 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <math.h>
-
 #include "timings.h"
+#include "timer-wheel.h"
 
 G_DEFINE_TYPE (Timings, timings, G_TYPE_OBJECT);
 
 #define GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), TIMINGS_TYPE, TimingsPrivate))
 
+// both deadlines live on the shared timer-wheel, all times are monotonic usec
 struct _TimingsPrivate {
-	GTimer*  on_screen_timer;
-	GTimer*  duration_timer;
-	GTimer*  paused_timer;
+	gint64   start_time;
+	gint64   stop_time;          // 0 while started
+	gint64   pause_time;         // start of the current pause
+	gint64   paused;             // sum of all previous pauses
 	guint    timeout_id;
 	guint    max_timeout_id;
 	guint    scheduled_duration; // value interpreted as milliseconds
@@ -57,78 +58,94 @@ enum
 
 static guint g_timings_signals[LAST_SIGNAL] = { 0 };
 
-guint
-_ms_elapsed (GTimer* timer)
+// time spent in pauses up to now
+static gint64
+_paused_usec (TimingsPrivate* priv,
+	      gint64          now)
 {
-	gulong  microseconds;
-	gulong  milliseconds;
-	gdouble duration;
-	gdouble seconds;
+	if (priv->is_paused)
+		return priv->paused + now - priv->pause_time;
 
-	// sanity check
-	g_assert (timer != NULL);
+	return priv->paused;
+}
 
-	// get elapsed time
-	duration = g_timer_elapsed (timer, &microseconds);
+// time spent on screen without being paused
+static guint
+_ms_elapsed (TimingsPrivate* priv,
+	     gint64          now)
+{
+	return (now - priv->start_time - _paused_usec (priv, now)) / 1000;
+}
+
+static void
+_remove_timeout (guint* id)
+{
+	gboolean removed_successfully;
 
-	// convert result to milliseconds ...
-	milliseconds = microseconds / 1000;
-	modf (duration, &seconds);
+	// already fired or never added
+	if (*id == 0)
+		return;
 
-	// ... and return it
-	return seconds * 1000 + milliseconds;
+	removed_successfully = timer_wheel_remove (*id);
+	g_assert (removed_successfully);
+	*id = 0;
 }
 
-gboolean
+static gboolean
 _emit_completed (gpointer data)
 {
 	Timings* t;
 
-	if (!data)
-		return TRUE;
+	if (!data || !IS_TIMINGS (data))
+		return FALSE;
 
 	t = (Timings*) data;
 
-	if (!t || !IS_TIMINGS (t))
-		return TRUE;
+	// the timer-wheel drops it once this returns
+	GET_PRIVATE (t)->timeout_id = 0;
 
 	g_signal_emit (t, g_timings_signals[COMPLETED], 0);
 
 	return FALSE;
 }
 
-gboolean
+static gboolean
 _emit_limit_reached (gpointer data)
 {
 	Timings* t;
 
-	if (!data)
-		return TRUE;
+	if (!data || !IS_TIMINGS (data))
+		return FALSE;
 
 	t = (Timings*) data;
 
-	if (!t || !IS_TIMINGS (t))
-		return TRUE;
+	GET_PRIVATE (t)->max_timeout_id = 0;
 
 	g_signal_emit (t, g_timings_signals[LIMIT_REACHED], 0);
 
 	return FALSE;
 }
 
-void
+static void
 _debug_output (TimingsPrivate* priv)
 {
+	guint on_screen;
+	guint paused;
+
 	if (g_getenv ("DEBUG"))
 	{
+		on_screen = (priv->stop_time - priv->start_time) / 1000;
+		paused    = priv->paused / 1000;
+
 		g_print ("\non-screen time: %d seconds, %d ms.\n",
-			 _ms_elapsed (priv->on_screen_timer) / 1000,
-			 _ms_elapsed (priv->on_screen_timer) % 1000);
+			 on_screen / 1000,
+			 on_screen % 1000);
 		g_print ("paused time   : %d seconds, %d ms.\n",
-			 _ms_elapsed (priv->paused_timer) / 1000,
-			 _ms_elapsed (priv->paused_timer) % 1000);
+			 paused / 1000,
+			 paused % 1000);
 		g_print ("unpaused time : %d seconds, %d ms.\n",
-			 _ms_elapsed (priv->duration_timer) / 1000,
-			 _ms_elapsed (priv->duration_timer) % 1000);
+			 (on_screen - paused) / 1000,
+			 (on_screen - paused) % 1000);
 		g_print ("scheduled time: %d seconds, %d ms.\n",
 			 priv->scheduled_duration / 1000,
 			 priv->scheduled_duration % 1000);
@@ -153,35 +170,8 @@ timings_dispose (GObject* gobject)
 	g_assert (priv);
 
 	// free any allocated resources
-	if (priv->on_screen_timer)
-	{
-		g_timer_destroy (priv->on_screen_timer);
-		priv->on_screen_timer = NULL;
-	}
-
-	if (priv->duration_timer)
-	{
-		g_timer_destroy (priv->duration_timer);
-		priv->duration_timer = NULL;
-	}
-
-	if (priv->paused_timer)
-	{
-		g_timer_destroy (priv->paused_timer);
-		priv->paused_timer = NULL;
-	}
-
-	if (priv->timeout_id != 0)
-	{
-		g_source_remove (priv->timeout_id);
-		priv->timeout_id = 0;
-	}
-
-	if (priv->max_timeout_id != 0)
-	{
-		g_source_remove (priv->max_timeout_id);
-		priv->max_timeout_id = 0;
-	}
+	_remove_timeout (&priv->timeout_id);
+	_remove_timeout (&priv->max_timeout_id);
 
 	// chain up to the parent class
 	G_OBJECT_CLASS (timings_parent_class)->dispose (gobject);
@@ -271,15 +261,6 @@ timings_new (guint scheduled_duration,
 
 	priv = GET_PRIVATE (this);
 
-	priv->on_screen_timer = g_timer_new ();
-	g_timer_stop (priv->on_screen_timer);
-
-	priv->duration_timer = g_timer_new ();
-	g_timer_stop (priv->duration_timer);
-
-	priv->paused_timer = g_timer_new ();
-	g_timer_stop (priv->paused_timer);
-
 	priv->scheduled_duration = scheduled_duration;
 	priv->max_duration       = max_duration;
 	priv->is_started         = FALSE;
@@ -310,17 +291,18 @@ timings_start (Timings* t)
 		return FALSE;
 	}
 
-	// install and start the two timeout-handlers
-	priv->timeout_id = g_timeout_add (priv->scheduled_duration,
-					  _emit_completed,
-					  (gpointer) t);
-	priv->max_timeout_id = g_timeout_add (priv->max_duration,
-					      _emit_limit_reached,
-					      (gpointer) t);
+	// install the two deadlines
+	priv->timeout_id = timer_wheel_add (priv->scheduled_duration,
+					    _emit_completed,
+					    (gpointer) t);
+	priv->max_timeout_id = timer_wheel_add (priv->max_duration,
+						_emit_limit_reached,
+						(gpointer) t);
 
-	// let the on-screen- and duration-timers tick
-	g_timer_continue (priv->on_screen_timer);
-	g_timer_continue (priv->duration_timer);
+	// let the clock tick
+	priv->start_time = g_get_monotonic_time ();
+	priv->stop_time  = 0;
+	priv->paused     = 0;
 
 	// indicate that we started
 	priv->is_started = TRUE;
@@ -332,7 +314,7 @@ gboolean
 timings_stop (Timings* t)
 {
 	TimingsPrivate* priv;
-	gboolean        removed_successfully;
+	gint64          now;
 
 	// sanity checks
 	if (!t)
@@ -352,26 +334,15 @@ timings_stop (Timings* t)
 		return FALSE;
 	}
 
-	// get rid of timeouts
-	if (!priv->is_paused)
-	{
-		// remove timeout for normal scheduled duration
-		removed_successfully = g_source_remove (priv->timeout_id);
-		g_assert (removed_successfully);
-	}
+	// get rid of the timeouts for the normal scheduled duration (gone
+	// already while paused) and for enforcing the max. time-limit
+	_remove_timeout (&priv->timeout_id);
+	_remove_timeout (&priv->max_timeout_id);
 
-	// remove timeout enforcing max. time-limit
-	removed_successfully = g_source_remove (priv->max_timeout_id);
-	g_assert (removed_successfully);
-
-	// halt all timers
-	if (priv->is_paused)
-		g_timer_stop (priv->paused_timer);
-	else
-	{
-		g_timer_stop (priv->on_screen_timer);
-		g_timer_stop (priv->duration_timer);
-	}
+	// halt the clock
+	now = g_get_monotonic_time ();
+	priv->paused    = _paused_usec (priv, now);
+	priv->stop_time = now;
 
 	// indicate that we stopped (means also not paused)
 	priv->is_started = FALSE;
@@ -387,7 +358,6 @@ gboolean
 timings_pause (Timings* t)
 {
 	TimingsPrivate* priv;
-	gboolean        removed_successfully;
 
 	// sanity checks
 	if (!t)
@@ -416,14 +386,12 @@ timings_pause (Timings* t)
 		return FALSE;
 	}
 
-	// make paused-timer tick again, hold duration-timer and update flag
-	g_timer_continue (priv->paused_timer);
-	g_timer_stop (priv->duration_timer);
-	priv->is_paused = TRUE;
+	// start the pause and update flag
+	priv->pause_time = g_get_monotonic_time ();
+	priv->is_paused  = TRUE;
 
 	// try to get rid of old timeout
-	removed_successfully = g_source_remove (priv->timeout_id);
-	g_assert (removed_successfully);
+	_remove_timeout (&priv->timeout_id);
 
 	return TRUE;
 }
@@ -432,7 +400,8 @@ gboolean
 timings_continue (Timings* t)
 {
 	TimingsPrivate* priv;
-	guint           extension;
+	gint64          now;
+	guint           elapsed;
 
 	// sanity checks
 	if (!t)
@@ -461,17 +430,18 @@ timings_continue (Timings* t)
 		return FALSE;
 	}
 
-	// make duration-timer tick again, hold paused-timer and update flag
-	g_timer_continue (priv->duration_timer);
-	g_timer_stop (priv->paused_timer);
+	// end the pause and update flag
+	now = g_get_monotonic_time ();
+	priv->paused    = _paused_usec (priv, now);
 	priv->is_paused = FALSE;
 
 	// put new timeout in place
-	extension = priv->scheduled_duration -
-		    _ms_elapsed (priv->duration_timer);
-	priv->timeout_id = g_timeout_add (extension,
-					  _emit_completed,
-					  (gpointer) t);
+	elapsed = _ms_elapsed (priv, now);
+	priv->timeout_id = timer_wheel_add (
+		elapsed < priv->scheduled_duration ?
+		priv->scheduled_duration - elapsed : 0,
+		_emit_completed,
+		(gpointer) t);
 	g_assert (priv->timeout_id != 0);
 
 	return TRUE;
@@ -482,8 +452,7 @@ timings_extend (Timings* t,
 		guint    extension)
 {
 	TimingsPrivate* priv;
-	gboolean        removed_successfully;
-	guint           on_screen_time; // value interpreted as milliseconds
+	guint           scheduled_duration;
 
 	// sanity checks
 	if (!t)
@@ -513,27 +482,18 @@ timings_extend (Timings* t,
 		return TRUE;
 	}
 
-	// try to get rid of old timeout
-	removed_successfully = g_source_remove (priv->timeout_id);
-	g_assert (removed_successfully);
-
 	// ensure we don't overshoot limit with the on-screen time
-	on_screen_time = _ms_elapsed (priv->duration_timer);
+	scheduled_duration = priv->scheduled_duration;
 	if (priv->scheduled_duration + extension > priv->max_duration)
-	{
-		extension = priv->max_duration - on_screen_time;
 		priv->scheduled_duration = priv->max_duration;
-	}
 	else
-	{
 		priv->scheduled_duration += extension;
-		extension = priv->scheduled_duration - on_screen_time;
-	}
 
-	// add new timeout
-	priv->timeout_id = g_timeout_add (extension,
-					  _emit_completed,
-					  (gpointer) t);
+	// move the pending deadline back, if it didn't fire already
+	if (priv->timeout_id)
+		timer_wheel_extend (priv->timeout_id,
+				    priv->scheduled_duration -
+				    scheduled_duration);
 
 	return TRUE;
 }
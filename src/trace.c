@@ -0,0 +1,201 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** trace.c - fixed-size ring of binary trace-events, dumped as Chrome-JSON
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "trace.h"
+
+// 0 turns tracing off
+gint TRACE_ENABLED = 1;
+
+typedef struct _TraceEvent
+{
+	guint  seq;      // index+1 of the event in this slot, 0 while written
+	guint  id;
+	gint   kind;
+	gint64 start;    // usec, monotonic
+	gint64 duration; // usec, -1 for marks
+} TraceEvent;
+
+static TraceEvent   g_ring[TRACE_RING_SIZE];
+static volatile gint g_head = 0; // index of the next event to be written
+
+static const gchar* g_kind_names[TRACE_LAST] = {
+	"notify",
+	"notify-batch",
+	"recalc-size",
+	"refresh-background",
+	"refresh-icon",
+	"refresh-title",
+	"refresh-body",
+	"refresh-indicator",
+	"blur",
+	"expose",
+	"fade-in-start",
+	"fade-in-stop",
+	"fade-out-start",
+	"fade-out-stop",
+	"slot-allocate",
+	"slot-free"
+};
+
+//-- private functions ---------------------------------------------------------
+
+// every writer claims its own slot with a single atomic add, the sequence
+// number is published last so a reader can tell a complete from a torn or
+// overwritten event
+static void
+_record (TraceKind kind,
+	 guint     id,
+	 gint64    start,
+	 gint64    duration)
+{
+	TraceEvent* event;
+	guint       index;
+
+	if (!TRACE_ENABLED || kind >= TRACE_LAST)
+		return;
+
+	index = (guint) g_atomic_int_add (&g_head, 1);
+	event = &g_ring[index & (TRACE_RING_SIZE - 1)];
+
+	g_atomic_int_set ((gint*) &event->seq, 0);
+	event->id       = id;
+	event->kind     = kind;
+	event->start    = start;
+	event->duration = duration;
+	g_atomic_int_set ((gint*) &event->seq, index + 1);
+}
+
+//-- public functions ----------------------------------------------------------
+
+void
+trace_span (TraceKind kind,
+	    guint     id,
+	    gint64    start)
+{
+	if (!TRACE_ENABLED)
+		return;
+
+	_record (kind, id, start, g_get_monotonic_time () - start);
+}
+
+void
+trace_mark (TraceKind kind,
+	    guint     id)
+{
+	if (!TRACE_ENABLED)
+		return;
+
+	_record (kind, id, g_get_monotonic_time (), -1);
+}
+
+guint
+trace_get_count (void)
+{
+	return (guint) g_atomic_int_get (&g_head);
+}
+
+gchar*
+trace_to_json (void)
+{
+	GString*   json;
+	TraceEvent event;
+	guint      head;
+	guint      index;
+	gboolean   first = TRUE;
+	gint       pid   = getpid ();
+
+	json = g_string_new ("{\"traceEvents\":[");
+
+	head  = (guint) g_atomic_int_get (&g_head);
+	index = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+	for (; index != head; index++)
+	{
+		TraceEvent* slot = &g_ring[index & (TRACE_RING_SIZE - 1)];
+
+		if ((guint) g_atomic_int_get ((gint*) &slot->seq) != index + 1)
+			continue;
+
+		event = *slot;
+
+		// overwritten while we copied it
+		if ((guint) g_atomic_int_get ((gint*) &slot->seq) != index + 1)
+			continue;
+
+		g_string_append_printf (json,
+					"%s\n{\"name\":\"%s\",\"cat\":\"notify-osd\","
+					"\"pid\":%d,\"tid\":1,"
+					"\"ts\":%" G_GINT64_FORMAT ",",
+					first ? "" : ",",
+					g_kind_names[event.kind],
+					pid,
+					event.start);
+
+		if (event.duration < 0)
+			g_string_append (json, "\"ph\":\"i\",\"s\":\"t\",");
+		else
+			g_string_append_printf (json,
+						"\"ph\":\"X\",\"dur\":%"
+						G_GINT64_FORMAT ",",
+						event.duration);
+
+		g_string_append_printf (json,
+					"\"args\":{\"id\":%u}}",
+					event.id);
+		first = FALSE;
+	}
+
+	g_string_append (json, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	return g_string_free (json, FALSE);
+}
+
+gboolean
+trace_dump (const gchar* filename,
+	    GError**     error)
+{
+	gchar*   json;
+	gboolean result;
+
+	json   = trace_to_json ();
+	result = g_file_set_contents (filename, json, -1, error);
+	g_free (json);
+
+	return result;
+}
+
+void
+trace_clear (void)
+{
+	guint i;
+
+	for (i = 0; i < TRACE_RING_SIZE; i++)
+		g_atomic_int_set ((gint*) &g_ring[i].seq, 0);
+}
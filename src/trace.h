@@ -0,0 +1,88 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** trace.h - fixed-size ring of binary trace-events, dumped as Chrome-JSON
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// number of events kept, older ones get overwritten, must be a power of two
+#define TRACE_RING_SIZE 16384
+
+typedef enum
+{
+	TRACE_NOTIFY = 0,      // stack_notify_handler()
+	TRACE_NOTIFY_BATCH,    // stack_notify_batch_handler()
+	TRACE_RECALC_SIZE,     // bubble_recalc_size()
+	TRACE_REFRESH_BACKGROUND,
+	TRACE_REFRESH_ICON,
+	TRACE_REFRESH_TITLE,
+	TRACE_REFRESH_BODY,
+	TRACE_REFRESH_INDICATOR,
+	TRACE_BLUR,            // raico_blur_apply()
+	TRACE_EXPOSE,          // expose_handler()
+	TRACE_FADE_IN_START,
+	TRACE_FADE_IN_STOP,
+	TRACE_FADE_OUT_START,
+	TRACE_FADE_OUT_STOP,
+	TRACE_SLOT_ALLOCATE,
+	TRACE_SLOT_FREE,
+	TRACE_LAST
+} TraceKind;
+
+// records a span of kind for the bubble with the given id (0 if there's
+// none), lasting from start (g_get_monotonic_time()) until now, lock-free
+// and safe to call from any thread
+void
+trace_span (TraceKind kind,
+	    guint     id,
+	    gint64    start);
+
+// records a single point in time
+void
+trace_mark (TraceKind kind,
+	    guint     id);
+
+// number of events recorded since startup, not only the ones still held
+guint
+trace_get_count (void);
+
+// events still in the ring, oldest first, as Chrome trace_event JSON, load it
+// via chrome://tracing or ui.perfetto.dev
+gchar*
+trace_to_json (void);
+
+gboolean
+trace_dump (const gchar* filename,
+	    GError**     error);
+
+void
+trace_clear (void);
+
+G_END_DECLS
+
+#endif /* __TRACE_H */
@@ -33,110 +33,438 @@
 #include <pango/pango.h>
 #include <cairo.h>
 
-#define CHARACTER_LT_REGEX            "&(lt;|#60;|#x3c;)"
-#define CHARACTER_GT_REGEX            "&(gt;|#62;|#x3e;)"
-#define CHARACTER_AMP_REGEX           "&(amp;|#38;|#x26;)"
-#define CHARACTER_APOS_REGEX          "&apos;"
-#define CHARACTER_QUOT_REGEX          "&quot;"
-#define CHARACTER_NEWLINE_REGEX       " *((<br[^/>]*/?>|\r|\n)+ *)+"
+#include "atoms.h"
+
+// The sanitizer below does in one sweep what the former regex-chain did in
+// seven: strip the supported tags, decode the five entities and collapse
+// runs of <br>, CR, LF (plus surrounding blanks) into a single character.
+// Its output has to stay byte-identical to that chain, which lives on as the
+// reference in tests/test-text-filtering.c (along with the TAG_*_REGEX and
+// CHARACTER_*_REGEX patterns mentioned below), so some of the odd corners of
+// the regular expressions (e.g. "&amp;lt;" turning into "<" because the
+// passes run one after another) are reproduced on purpose.
+
+static const gchar* const stripped_tags[] = {
+	"b", "i", "u", "big", "a", "img", "span", "s", "sub", "small", "tt",
+	"html", "qt", NULL
+};
 
-#define TAG_MATCH_REGEX     "<(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)\\b[^>]*>(.*?)</\\1>|<(img|span|a)[^>]/>|<(img)[^>]*>"
-#define TAG_REPLACE_REGEX   "<(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)\\b[^>]*>|</(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)>"
+#define N_STRIPPED_TAGS (G_N_ELEMENTS (stripped_tags) - 1)
 
-struct _ReplaceMarkupData
+typedef struct _Entity
 {
-	gchar* regex;
-	gchar* replacement;
+	const gchar* name;
+	gsize        length;
+	gchar        character;
+} Entity;
+
+// same order as the passes of the regex-chain, "&" has to come first
+static const Entity entities[] = {
+	{ "amp;",  4, '&'  },
+	{ "#38;",  4, '&'  },
+	{ "#x26;", 5, '&'  },
+	{ "lt;",   3, '<'  },
+	{ "#60;",  4, '<'  },
+	{ "#x3c;", 5, '<'  },
+	{ "gt;",   3, '>'  },
+	{ "#62;",  4, '>'  },
+	{ "#x3e;", 5, '>'  },
+	{ "apos;", 5, '\'' },
+	{ "quot;", 5, '"'  }
 };
 
-typedef struct _ReplaceMarkupData ReplaceMarkupData;
+#define N_AMP_ENTITIES 3
 
-static gchar*
-strip_html (const gchar *text, const gchar *match_regex, const gchar* replace_regex)
+static gboolean
+is_word_char (const gchar* p,
+	      const gchar* end)
 {
-	GRegex   *regex;
-	gchar    *ret;
-	gboolean  match = FALSE;
-	GMatchInfo *info = NULL;
+	if (p >= end)
+		return FALSE;
 
-	regex = g_regex_new (match_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
-	match = g_regex_match (regex, text, 0, &info);
-	g_regex_unref (regex);
+	if ((guchar) *p < 0x80)
+		return g_ascii_isalnum (*p) || *p == '_';
+
+	// GRegex matches \b against unicode word-characters
+	return g_unichar_isalnum (g_utf8_get_char_validated (p, end - p));
+}
+
+static gboolean
+has_prefix (const gchar* p,
+	    const gchar* end,
+	    const gchar* prefix,
+	    gsize        length)
+{
+	return (gsize) (end - p) >= length && !memcmp (p, prefix, length);
+}
+
+// returns the index into stripped_tags[] of the tag-name at p, or -1
+static gint
+tag_name_at (const gchar*  p,
+	     const gchar*  end,
+	     const gchar** name_end)
+{
+	gint i;
 
-	if (match) {
-		regex = g_regex_new (replace_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
-		ret = g_regex_replace (regex, text, -1, 0, "", 0, NULL);
-		g_regex_unref (regex);
-	} else {
-		ret = g_strdup (text);
+	for (i = 0; stripped_tags[i]; i++)
+	{
+		gsize length = strlen (stripped_tags[i]);
+
+		if (has_prefix (p, end, stripped_tags[i], length) &&
+		    !is_word_char (p + length, end))
+		{
+			*name_end = p + length;
+			return i;
+		}
 	}
 
-	if (info)
-		g_match_info_free (info);
+	return -1;
+}
+
+// first '>' at or after from (end if there is none), cached in *gt because
+// both callers only ever ask for increasing positions
+static const gchar*
+find_gt (const gchar*  from,
+	 const gchar*  end,
+	 const gchar** gt)
+{
+	if (!*gt || (*gt < from && *gt != end))
+	{
+		*gt = memchr (from, '>', end - from);
+		if (!*gt)
+			*gt = end;
+	}
 
-	return ret;
+	return *gt;
 }
 
-static gchar*
-replace_markup (const gchar *text, const gchar *match_regex, const gchar *replace_text)
+// mirrors the check done with TAG_MATCH_REGEX, tags are only stripped if
+// there is at least one well-formed element in text
+static gboolean
+has_strippable_markup (const gchar* text,
+		       const gchar* end)
 {
-	GRegex *regex;
-	gchar  *ret;
+	const gchar* open_end[N_STRIPPED_TAGS] = { NULL };
+	const gchar* gt = NULL;
+	const gchar* name_end;
+	const gchar* p;
+	const gchar* q;
+	gint         i;
+
+	for (p = memchr (text, '<', end - text);
+	     p;
+	     p = memchr (p + 1, '<', end - p - 1))
+	{
+		q = p + 1;
 
-	regex = g_regex_new (match_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
-	ret = g_regex_replace (regex, text, -1, 0, replace_text, 0, NULL);
-	g_regex_unref (regex);
+		if (q < end && *q == '/')
+		{
+			i = tag_name_at (q + 1, end, &name_end);
+			if (i >= 0 && name_end < end && *name_end == '>' &&
+			    open_end[i] && open_end[i] <= p)
+				return TRUE;
+
+			continue;
+		}
+
+		// <(img)[^>]*>
+		if (has_prefix (q, end, "img", 3) &&
+		    find_gt (q + 3, end, &gt) != end)
+			return TRUE;
+
+		// <(img|span|a)[^>]/>, img is already covered by the above
+		if (has_prefix (q, end, "span", 4) || has_prefix (q, end, "a", 1))
+		{
+			const gchar* r = q + (*q == 's' ? 4 : 1);
+
+			if (r < end && *r != '>')
+			{
+				r = g_utf8_next_char (r);
+				if (has_prefix (r, end, "/>", 2))
+					return TRUE;
+			}
+		}
+
+		// <(b|i|...)\b[^>]*>(.*?)</\1>, remember where the first opening
+		// tag of each kind ends
+		i = tag_name_at (q, end, &name_end);
+		if (i >= 0 && !open_end[i])
+		{
+			const gchar* tag_end = find_gt (name_end, end, &gt);
 
-	return ret;
+			if (tag_end != end)
+				open_end[i] = tag_end + 1;
+		}
+	}
+
+	return FALSE;
 }
 
-gchar*
-filter_text (const gchar *text)
+// mirrors the replacement done with TAG_REPLACE_REGEX
+static gsize
+strip_markup (const gchar* text,
+	      const gchar* end,
+	      gchar*       out)
+{
+	const gchar* gt = NULL;
+	const gchar* name_end;
+	const gchar* p = text;
+	const gchar* lt;
+	gchar*       o = out;
+	gint         i;
+
+	while ((lt = memchr (p, '<', end - p)))
+	{
+		memcpy (o, p, lt - p);
+		o += lt - p;
+		p = lt + 1;
+
+		if (p < end && *p == '/')
+		{
+			i = tag_name_at (p + 1, end, &name_end);
+			if (i >= 0 && name_end < end && *name_end == '>')
+			{
+				p = name_end + 1;
+				continue;
+			}
+		}
+		else
+		{
+			i = tag_name_at (p, end, &name_end);
+			if (i >= 0 && find_gt (name_end, end, &gt) != end)
+			{
+				p = gt + 1;
+				continue;
+			}
+		}
+
+		*o++ = '<';
+	}
+
+	memcpy (o, p, end - p);
+	o += end - p;
+
+	return o - out;
+}
+
+// decodes the entity at p (pointing at '&'), returns the number of bytes
+// consumed or 0 if there is none
+static gsize
+decode_entity (const gchar* p,
+	       const gchar* end,
+	       gchar*       character)
 {
-	gchar *text1;
-
-	text1 = strip_html (text, TAG_MATCH_REGEX, TAG_REPLACE_REGEX);
-
-	static ReplaceMarkupData data[] = {
-		{ CHARACTER_AMP_REGEX, "&" },
-		{ CHARACTER_LT_REGEX, "<" },
-		{ CHARACTER_GT_REGEX, ">" },
-		{ CHARACTER_APOS_REGEX, "'" },
-		{ CHARACTER_QUOT_REGEX, "\"" },
-		{ CHARACTER_NEWLINE_REGEX, "\n" }
-		};
-
-	ReplaceMarkupData* ptr = data;
-	ReplaceMarkupData* end = data + sizeof(data) / sizeof(ReplaceMarkupData);
-	for (; ptr != end; ++ptr) {
-		gchar* tmp = replace_markup (text1, ptr->regex, ptr->replacement);
-		g_free (text1);
-		text1 = tmp;
+	gsize consumed = 0;
+	guint i;
+
+	p++;
+	for (i = 0; i < G_N_ELEMENTS (entities); i++)
+		if (has_prefix (p, end, entities[i].name, entities[i].length))
+		{
+			*character = entities[i].character;
+			consumed = 1 + entities[i].length;
+			break;
+		}
+
+	// an ampersand decoded by the first pass can start an entity for the
+	// later ones, e.g. "&amp;quot;" yields '"'
+	if (consumed && i < N_AMP_ENTITIES)
+	{
+		p += entities[i].length;
+		for (i = N_AMP_ENTITIES; i < G_N_ELEMENTS (entities); i++)
+			if (has_prefix (p, end, entities[i].name, entities[i].length))
+			{
+				*character = entities[i].character;
+				consumed += entities[i].length;
+				break;
+			}
 	}
 
-	return text1;
+	return consumed;
 }
 
-gchar*
-newline_to_space (const gchar *text)
+// collapses runs matching CHARACTER_NEWLINE_REGEX while appending to out
+typedef struct _Sanitizer
+{
+	gchar*   out;
+	gsize    length;
+	gchar    newline;     // what a run of line-breaks is replaced with
+	guint    spaces;      // blanks not yet known to be part of a run
+	gboolean brk;         // pending run contains a line-break
+	gsize    flushed;     // where the last flushed run/blanks started ...
+	gsize    flushed_end; // ... and ended
+	gssize   br_start;    // start of a possible "<br ...>" or -1
+	gboolean br_slash;    // ... which just had a '/'
+} Sanitizer;
+
+static void
+sanitizer_flush (Sanitizer* s)
+{
+	if (!s->brk && !s->spaces)
+		return;
+
+	s->flushed = s->length;
+
+	if (s->brk)
+		s->out[s->length++] = s->newline;
+	else
+		for (; s->spaces; s->spaces--)
+			s->out[s->length++] = ' ';
+
+	s->flushed_end = s->length;
+	s->spaces      = 0;
+	s->brk         = FALSE;
+}
+
+static void
+sanitizer_put (Sanitizer* s,
+	       gchar      c,
+	       gboolean   detect_br);
+
+// a "<br" not finished by "/?>" is plain text after all, so feed it again
+static void
+sanitizer_drop_br (Sanitizer* s)
+{
+	gsize i;
+	gsize stop = s->length;
+
+	s->length   = s->br_start;
+	s->br_start = -1;
+	s->br_slash = FALSE;
+
+	// writing never overtakes reading here
+	for (i = s->length; i < stop; i++)
+		sanitizer_put (s, s->out[i], FALSE);
+}
+
+static void
+sanitizer_put (Sanitizer* s,
+	       gchar      c,
+	       gboolean   detect_br)
+{
+	if (s->br_start >= 0)
+	{
+		if (c == '>')
+		{
+			// complete <br>, joins the blanks or run flushed before it
+			if (s->flushed_end == (gsize) s->br_start)
+				s->length = s->flushed;
+			else
+				s->length = s->br_start;
+			s->br_start = -1;
+			s->br_slash = FALSE;
+			s->spaces   = 0;
+			s->brk      = TRUE;
+			return;
+		}
+
+		if (!s->br_slash)
+		{
+			s->br_slash = (c == '/');
+			s->out[s->length++] = c;
+			return;
+		}
+
+		sanitizer_drop_br (s);
+	}
+
+	switch (c)
+	{
+		case ' ':
+			if (!s->brk)
+				s->spaces++;
+		break;
+
+		case '\r':
+		case '\n':
+			s->spaces = 0;
+			s->brk    = TRUE;
+		break;
+
+		default:
+			sanitizer_flush (s);
+			s->out[s->length++] = c;
+			if (detect_br && c == 'r' && s->length >= 3 &&
+			    s->out[s->length - 3] == '<' &&
+			    s->out[s->length - 2] == 'b')
+				s->br_start = s->length - 3;
+		break;
+	}
+}
+
+static gchar*
+sanitize_text (const gchar* text,
+	       gboolean     decode_entities,
+	       gchar        newline)
 {
-	gchar *text1;
+	Sanitizer    s;
+	gsize        length;
+	const gchar* p;
+	const gchar* end;
+	gchar        c;
+	gsize        consumed;
+
+	if (!text)
+		return NULL;
+
+	// nothing to do for plain text
+	if (!strpbrk (text, decode_entities ? "<&\r\n" : "<\r\n"))
+		return g_strdup (text);
+
+	length = strlen (text);
 
-	text1 = strip_html (text, TAG_MATCH_REGEX, TAG_REPLACE_REGEX);
+	s.out         = g_malloc (length + 1);
+	s.length      = 0;
+	s.newline     = newline;
+	s.spaces      = 0;
+	s.brk         = FALSE;
+	s.flushed     = 0;
+	s.flushed_end = 0;
+	s.br_start    = -1;
+	s.br_slash    = FALSE;
 
-	static ReplaceMarkupData data[] = {
-		{ CHARACTER_NEWLINE_REGEX, " " }
-		};
+	p   = text;
+	end = text + length;
 
-	ReplaceMarkupData* ptr = data;
-	ReplaceMarkupData* end = data + sizeof(data) / sizeof(ReplaceMarkupData);
-	for (; ptr != end; ++ptr) {
-		gchar* tmp = replace_markup (text1, ptr->regex, ptr->replacement);
-		g_free (text1);
-		text1 = tmp;
+	// stripping tags needs to see all of the text first, so this is the
+	// only case in which the input is touched twice (in place, though)
+	if (memchr (text, '<', length) && has_strippable_markup (text, end))
+	{
+		end = s.out + strip_markup (text, end, s.out);
+		p   = s.out;
+	}
+
+	while (p < end)
+	{
+		if (decode_entities &&
+		    *p == '&' &&
+		    (consumed = decode_entity (p, end, &c)))
+		{
+			p += consumed;
+			sanitizer_put (&s, c, TRUE);
+		}
+		else
+			sanitizer_put (&s, *p++, TRUE);
 	}
 
-	return text1;
+	if (s.br_start >= 0)
+		sanitizer_drop_br (&s);
+	sanitizer_flush (&s);
+	s.out[s.length] = '\0';
+
+	return s.out;
+}
+
+gchar*
+filter_text (const gchar *text)
+{
+	return sanitize_text (text, TRUE, '\n');
+}
+
+gchar*
+newline_to_space (const gchar *text)
+{
+	return sanitize_text (text, FALSE, ' ');
 }
 
 gboolean
@@ -188,6 +516,214 @@ copy_surface (cairo_surface_t* orig)
 	return copy;
 }
 
+// averages the source-rectangle [x0, x1) x [y0, y1) into one premultiplied
+// ARGB32 pixel, the rectangles of all target-pixels partition the source, so
+// every source-pixel is read exactly once per conversion
+static inline guint32
+box_average (const guchar* data,
+	     gint          rowstride,
+	     gint          n_channels,
+	     gint          x0,
+	     gint          y0,
+	     gint          x1,
+	     gint          y1)
+{
+	guint64 r = 0;
+	guint64 g = 0;
+	guint64 b = 0;
+	guint64 a = 0;
+	guint64 n = (guint64) (x1 - x0) * (guint64) (y1 - y0);
+	guint64 scale;
+	gint    x;
+	gint    y;
+
+	for (y = y0; y < y1; y++)
+	{
+		const guchar* p = data + (gsize) y * rowstride + x0 * n_channels;
+
+		if (n_channels == 4)
+			for (x = x0; x < x1; x++, p += 4)
+			{
+				r += p[0] * p[3];
+				g += p[1] * p[3];
+				b += p[2] * p[3];
+				a += p[3];
+			}
+		else
+			for (x = x0; x < x1; x++, p += 3)
+			{
+				r += p[0];
+				g += p[1];
+				b += p[2];
+			}
+	}
+
+	if (n_channels == 4)
+		scale = n * 255;
+	else
+	{
+		scale = n;
+		a     = n * 255;
+	}
+
+	return (guint32) ((a + n / 2) / n) << 24 |
+	       (guint32) ((r + scale / 2) / scale) << 16 |
+	       (guint32) ((g + scale / 2) / scale) << 8 |
+	       (guint32) ((b + scale / 2) / scale);
+}
+
+static void
+box_filter (const guchar* data,
+	    gint          width,
+	    gint          height,
+	    gint          rowstride,
+	    gint          n_channels,
+	    guchar*       dst,
+	    gint          dst_stride,
+	    gint          dst_width,
+	    gint          dst_height)
+{
+	gint x;
+	gint y;
+
+	for (y = 0; y < dst_height; y++)
+	{
+		guint32* out = (guint32*) (dst + (gsize) y * dst_stride);
+		gint     y0  = (gint64) y * height / dst_height;
+		gint     y1  = (gint64) (y + 1) * height / dst_height;
+
+		for (x = 0; x < dst_width; x++)
+		{
+			gint x0 = (gint64) x * width / dst_width;
+			gint x1 = (gint64) (x + 1) * width / dst_width;
+
+			out[x] = box_average (data,
+					      rowstride,
+					      n_channels,
+					      x0,
+					      y0,
+					      MAX (x1, x0 + 1),
+					      MAX (y1, y0 + 1));
+		}
+	}
+}
+
+cairo_surface_t*
+image_data_to_surface (gint          width,
+		       gint          height,
+		       gint          rowstride,
+		       gboolean      has_alpha,
+		       gint          bits_per_sample,
+		       gint          n_channels,
+		       const guchar* data,
+		       gsize         length,
+		       gint          size,
+		       gint          padding)
+{
+	cairo_surface_t* surface = NULL;
+	guchar*          pixels;
+	gint             stride;
+	gint             max_edge;
+	gint             new_width;
+	gint             new_height;
+	gint             dest_x;
+	gint             dest_y;
+
+	// never trust what comes in over D-Bus
+	if (!data || width <= 0 || height <= 0 || size <= 0 || padding < 0)
+		return NULL;
+
+	if (bits_per_sample != 8 || n_channels != (has_alpha ? 4 : 3))
+		return NULL;
+
+	if (width > G_MAXINT / n_channels || rowstride < width * n_channels)
+		return NULL;
+
+	if ((gsize) (height - 1) * rowstride + (gsize) width * n_channels >
+	    length)
+		return NULL;
+
+	// keep the aspect-ratio, center the result in the size x size square
+	max_edge   = MAX (width, height);
+	new_width  = MAX (1, (gint64) size * width / max_edge);
+	new_height = MAX (1, (gint64) size * height / max_edge);
+	dest_x     = padding + (size - new_width) / 2;
+	dest_y     = padding + (size - new_height) / 2;
+
+	// cairo hands out cleared (transparent) pixels
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+					      size + 2 * padding,
+					      size + 2 * padding);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_surface_destroy (surface);
+		return NULL;
+	}
+
+	cairo_surface_flush (surface);
+	pixels = cairo_image_surface_get_data (surface);
+	stride = cairo_image_surface_get_stride (surface);
+
+	if (new_width <= width && new_height <= height)
+	{
+		// common case, e.g. full-size avatars, filter straight into the
+		// target surface
+		box_filter (data,
+			    width,
+			    height,
+			    rowstride,
+			    n_channels,
+			    pixels + dest_y * stride + dest_x * 4,
+			    stride,
+			    new_width,
+			    new_height);
+		cairo_surface_mark_dirty (surface);
+	}
+	else
+	{
+		// tiny image, a box-filter would just duplicate pixels, convert
+		// it 1:1 and let cairo interpolate while scaling it up
+		cairo_surface_t* source;
+		cairo_t*         cr;
+
+		source = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						     width,
+						     height);
+		if (cairo_surface_status (source) != CAIRO_STATUS_SUCCESS)
+		{
+			cairo_surface_destroy (source);
+			cairo_surface_destroy (surface);
+			return NULL;
+		}
+
+		cairo_surface_flush (source);
+		box_filter (data,
+			    width,
+			    height,
+			    rowstride,
+			    n_channels,
+			    cairo_image_surface_get_data (source),
+			    cairo_image_surface_get_stride (source),
+			    width,
+			    height);
+		cairo_surface_mark_dirty (source);
+
+		cr = cairo_create (surface);
+		cairo_translate (cr, dest_x, dest_y);
+		cairo_scale (cr,
+			     (gdouble) new_width / (gdouble) width,
+			     (gdouble) new_height / (gdouble) height);
+		cairo_set_source_surface (cr, source, 0.0f, 0.0f);
+		cairo_pattern_set_filter (cairo_get_source (cr),
+					  CAIRO_FILTER_BILINEAR);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+		cairo_surface_destroy (source);
+	}
+
+	return surface;
+}
+
 // code of get_wm_name() based in large chunks on www.amsn-project.net
 gchar*
 get_wm_name (Display* dpy)
@@ -208,8 +744,8 @@ get_wm_name (Display* dpy)
 
 	screen = DefaultScreen (dpy);
 	root = RootWindow (dpy, screen);
-	supwmcheck = XInternAtom (dpy, "_NET_SUPPORTING_WM_CHECK", False);
-	wmname = XInternAtom (dpy, "_NET_WM_NAME", False);
+	supwmcheck = atoms_get (ATOM_NET_SUPPORTING_WM_CHECK);
+	wmname = atoms_get (ATOM_NET_WM_NAME);
 
 	XGetWindowProperty (dpy,
 			    root,
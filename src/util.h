@@ -49,6 +49,22 @@ copy_surface (cairo_surface_t* orig);
 gboolean
 destroy_cloned_surface (cairo_surface_t* surface);
 
+// converts raw image-data (as sent with the image_data hint) directly into a
+// premultiplied ARGB32 surface of size + 2 * padding pixels, the image gets
+// box-filtered to fit size x size, keeping its aspect-ratio, and centered,
+// returns NULL for malformed image-data
+cairo_surface_t*
+image_data_to_surface (gint          width,
+		       gint          height,
+		       gint          rowstride,
+		       gboolean      has_alpha,
+		       gint          bits_per_sample,
+		       gint          n_channels,
+		       const guchar* data,
+		       gsize         length,
+		       gint          size,
+		       gint          padding);
+
 gchar*
 get_wm_name (Display* dpy);
 
@@ -0,0 +1,498 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** bench-blur.c - throughput, allocations and quality of the raico-backends
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "exponential-blur.h"
+#include "gaussian-blur.h"
+#include "stack-blur.h"
+
+// the backends don't all honour the stride and some touch a few bytes past
+// the last pixel, so every buffer gets some slack at its end
+#define SLACK 16
+
+typedef void (*BlurFunc) (cairo_surface_t* surface, guint radius);
+
+typedef struct _Backend
+{
+	const gchar* name;
+	BlurFunc     blur;
+} Backend;
+
+static const Backend backends[] = {
+	{ "exponential", surface_exponential_blur },
+	{ "gaussian",    surface_gaussian_blur },
+	{ "stack",       surface_stack_blur }
+};
+
+// roughly the tiles of a bubble at 96 DPI and a 10pt system-font
+typedef struct _Size
+{
+	const gchar* name;
+	gint         width;
+	gint         height;
+} Size;
+
+static const Size sizes[] = {
+	{ "icon",       56,  56 },
+	{ "title",      256, 34 },
+	{ "body",       256, 160 },
+	{ "background", 340, 200 }
+};
+
+static const cairo_format_t formats[] = {
+	CAIRO_FORMAT_A8,
+	CAIRO_FORMAT_RGB24,
+	CAIRO_FORMAT_ARGB32
+};
+
+static gint   iterations = 20;
+static gint   max_radius = 16;
+static gchar* output     = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of timed runs per case (default 20)", "N" },
+	{ "max-radius", 'r', 0, G_OPTION_ARG_INT, &max_radius,
+	  "Benchmark radii 1 up to this (default 16)", "R" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+	  "Write the JSON-results to this file instead of stdout", "FILE" },
+	{ NULL }
+};
+
+//-- allocation-counting -------------------------------------------------------
+
+#ifdef __GLIBC__
+// everything allocating through malloc() and friends, including glib, cairo
+// and pixman, ends up in these instead of glibc's own
+extern void* __libc_malloc (size_t size);
+extern void* __libc_calloc (size_t n, size_t size);
+extern void* __libc_realloc (void* ptr, size_t size);
+
+static volatile gint allocations = 0;
+
+void*
+malloc (size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_malloc (size);
+}
+
+void*
+calloc (size_t n,
+	size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_calloc (n, size);
+}
+
+void*
+realloc (void*  ptr,
+	 size_t size)
+{
+	g_atomic_int_inc (&allocations);
+	return __libc_realloc (ptr, size);
+}
+
+static gint
+get_allocations (void)
+{
+	return g_atomic_int_get (&allocations);
+}
+#else
+static gint
+get_allocations (void)
+{
+	return -1;
+}
+#endif
+
+//-- surfaces ------------------------------------------------------------------
+
+static const gchar*
+format_name (cairo_format_t format)
+{
+	switch (format)
+	{
+		case CAIRO_FORMAT_A8:     return "A8";
+		case CAIRO_FORMAT_RGB24:  return "RGB24";
+		case CAIRO_FORMAT_ARGB32: return "ARGB32";
+		default:                  return "unknown";
+	}
+}
+
+// bytes per pixel and which of those carry a channel worth comparing
+static gint
+format_bpp (cairo_format_t format)
+{
+	return format == CAIRO_FORMAT_A8 ? 1 : 4;
+}
+
+static gint
+format_channels (cairo_format_t format)
+{
+	return format == CAIRO_FORMAT_A8 ? 1 :
+	       (format == CAIRO_FORMAT_RGB24 ? 3 : 4);
+}
+
+static cairo_surface_t*
+create_surface (cairo_format_t format,
+		gint           width,
+		gint           height,
+		guchar**       data)
+{
+	gint stride = cairo_format_stride_for_width (format, width);
+
+	*data = g_malloc0 (stride * height + SLACK);
+
+	return cairo_image_surface_create_for_data (*data,
+						    format,
+						    width,
+						    height,
+						    stride);
+}
+
+// something with hard edges, gradients and partial transparency, like a tile
+static void
+draw_pattern (cairo_surface_t* surface,
+	      gint             width,
+	      gint             height)
+{
+	cairo_t* cr = cairo_create (surface);
+	gint     x;
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_rgba (cr, 0.0f, 0.0f, 0.0f, 0.0f);
+	cairo_paint (cr);
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_set_source_rgba (cr, 0.07f, 0.07f, 0.07f, 0.9f);
+	cairo_rectangle (cr, 4.0f, 4.0f, width - 8.0f, height - 8.0f);
+	cairo_fill (cr);
+
+	for (x = 8; x < width - 8; x += 12)
+	{
+		cairo_set_source_rgba (cr,
+				       (x % 3) / 2.0f,
+				       (x % 5) / 4.0f,
+				       (x % 7) / 6.0f,
+				       0.5f + (x % 2) * 0.5f);
+		cairo_rectangle (cr, x, 8.0f, 6.0f, height - 16.0f);
+		cairo_fill (cr);
+	}
+
+	cairo_set_source_rgba (cr, 1.0f, 1.0f, 1.0f, 1.0f);
+	cairo_set_line_width (cr, 2.0f);
+	cairo_arc (cr,
+		   width / 2.0f,
+		   height / 2.0f,
+		   MIN (width, height) / 3.0f,
+		   0.0f,
+		   2.0f * G_PI);
+	cairo_stroke (cr);
+
+	cairo_destroy (cr);
+	cairo_surface_flush (surface);
+}
+
+//-- reference-blur and PSNR ---------------------------------------------------
+
+// separable gaussian in double precision with the kernel-size and sigma
+// surface_gaussian_blur() uses, pixels beyond the edges are transparent
+static void
+reference_blur (guchar*        data,
+		cairo_format_t format,
+		gint           width,
+		gint           height,
+		gint           stride,
+		gint           radius)
+{
+	gint     bpp      = format_bpp (format);
+	gint     channels = format_channels (format);
+	gdouble  radiusf  = radius + 1.0f;
+	gdouble  sigma;
+	gdouble* kernel;
+	gdouble* plane;
+	gdouble* tmp;
+	gdouble  sum = 0.0f;
+	gint     c;
+	gint     x;
+	gint     y;
+	gint     i;
+
+	sigma  = sqrt (-(radiusf * radiusf) / (2.0f * log (1.0f / 255.0f)));
+	kernel = g_new (gdouble, 2 * radius + 1);
+	for (i = -radius; i <= radius; i++)
+	{
+		kernel[i + radius] = exp (-(i * i) / (2.0f * sigma * sigma));
+		sum += kernel[i + radius];
+	}
+	for (i = 0; i < 2 * radius + 1; i++)
+		kernel[i] /= sum;
+
+	plane = g_new (gdouble, width * height);
+	tmp   = g_new (gdouble, width * height);
+
+	for (c = 0; c < channels; c++)
+	{
+		for (y = 0; y < height; y++)
+			for (x = 0; x < width; x++)
+				plane[y * width + x] =
+					data[y * stride + x * bpp + c];
+
+		for (y = 0; y < height; y++)
+			for (x = 0; x < width; x++)
+			{
+				sum = 0.0f;
+				for (i = -radius; i <= radius; i++)
+					if (x + i >= 0 && x + i < width)
+						sum += kernel[i + radius] *
+						       plane[y * width + x + i];
+				tmp[y * width + x] = sum;
+			}
+
+		for (y = 0; y < height; y++)
+			for (x = 0; x < width; x++)
+			{
+				sum = 0.0f;
+				for (i = -radius; i <= radius; i++)
+					if (y + i >= 0 && y + i < height)
+						sum += kernel[i + radius] *
+						       tmp[(y + i) * width + x];
+				data[y * stride + x * bpp + c] =
+					(guchar) CLAMP (sum + 0.5f, 0.0f, 255.0f);
+			}
+	}
+
+	g_free (tmp);
+	g_free (plane);
+	g_free (kernel);
+}
+
+// in dB, +inf for identical images
+static gdouble
+psnr (const guchar*  a,
+      const guchar*  b,
+      cairo_format_t format,
+      gint           width,
+      gint           height,
+      gint           stride)
+{
+	gint    bpp      = format_bpp (format);
+	gint    channels = format_channels (format);
+	gdouble error    = 0.0f;
+	gdouble mse;
+	gint    diff;
+	gint    c;
+	gint    x;
+	gint    y;
+
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			for (c = 0; c < channels; c++)
+			{
+				diff = a[y * stride + x * bpp + c] -
+				       b[y * stride + x * bpp + c];
+				error += diff * diff;
+			}
+
+	mse = error / ((gdouble) width * height * channels);
+	if (mse == 0.0f)
+		return INFINITY;
+
+	return 10.0f * log10 (255.0f * 255.0f / mse);
+}
+
+//-- measuring -----------------------------------------------------------------
+
+static void
+bench_case (GString*       json,
+	    const Backend* backend,
+	    const Size*    size,
+	    cairo_format_t format,
+	    gint           radius)
+{
+	cairo_surface_t* pristine;
+	cairo_surface_t* surface;
+	guchar*          pristine_data;
+	guchar*          surface_data;
+	guchar*          reference;
+	gint             stride;
+	gint64           start;
+	gint64           elapsed = 0;
+	gint             allocs  = 0;
+	gint             before;
+	gdouble          quality;
+	gint             i;
+
+	stride   = cairo_format_stride_for_width (format, size->width);
+	pristine = create_surface (format,
+				   size->width,
+				   size->height,
+				   &pristine_data);
+	surface  = create_surface (format,
+				   size->width,
+				   size->height,
+				   &surface_data);
+	draw_pattern (pristine, size->width, size->height);
+
+	reference = g_malloc (stride * size->height + SLACK);
+	memcpy (reference, pristine_data, stride * size->height + SLACK);
+	reference_blur (reference,
+			format,
+			size->width,
+			size->height,
+			stride,
+			radius);
+
+	for (i = 0; i < iterations; i++)
+	{
+		memcpy (surface_data, pristine_data, stride * size->height);
+		cairo_surface_mark_dirty (surface);
+
+		before = get_allocations ();
+		start  = g_get_monotonic_time ();
+		backend->blur (surface, radius);
+		elapsed += g_get_monotonic_time () - start;
+		allocs  += get_allocations () - before;
+	}
+
+	quality = psnr (surface_data,
+			reference,
+			format,
+			size->width,
+			size->height,
+			stride);
+
+	g_string_append_printf (json,
+				"    { \"backend\": \"%s\", \"size\": \"%s\", "
+				"\"width\": %d, \"height\": %d, "
+				"\"format\": \"%s\", \"radius\": %d, "
+				"\"mpixels-per-sec\": %.2f, ",
+				backend->name,
+				size->name,
+				size->width,
+				size->height,
+				format_name (format),
+				radius,
+				elapsed ?
+				(gdouble) size->width * size->height *
+				iterations / elapsed : 0.0f);
+
+#ifdef __GLIBC__
+	g_string_append_printf (json,
+				"\"allocations-per-call\": %.1f, ",
+				(gdouble) allocs / iterations);
+#else
+	g_string_append (json, "\"allocations-per-call\": null, ");
+#endif
+
+	// JSON has no notion of infinity
+	if (isinf (quality))
+		g_string_append (json, "\"psnr\": null }");
+	else
+		g_string_append_printf (json, "\"psnr\": %.2f }", quality);
+
+	cairo_surface_destroy (surface);
+	cairo_surface_destroy (pristine);
+	g_free (reference);
+	g_free (surface_data);
+	g_free (pristine_data);
+}
+
+int
+main (int    argc,
+      char** argv)
+{
+	GOptionContext* context;
+	GError*         error = NULL;
+	GString*        json;
+	guint           b;
+	guint           s;
+	guint           f;
+	gint            radius;
+	gboolean        first = TRUE;
+	gboolean        ok    = TRUE;
+
+	context = g_option_context_new ("- benchmark the raico blur-backends");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+	{
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (iterations <= 0 || max_radius <= 0)
+	{
+		g_printerr ("Invalid arguments, see --help\n");
+		return 1;
+	}
+
+	json = g_string_new ("{\n");
+	g_string_append_printf (json,
+				"  \"iterations\": %d,\n  \"cases\": [\n",
+				iterations);
+
+	for (b = 0; b < G_N_ELEMENTS (backends); b++)
+		for (s = 0; s < G_N_ELEMENTS (sizes); s++)
+			for (f = 0; f < G_N_ELEMENTS (formats); f++)
+				for (radius = 1; radius <= max_radius; radius++)
+				{
+					if (!first)
+						g_string_append (json, ",\n");
+					first = FALSE;
+
+					bench_case (json,
+						    &backends[b],
+						    &sizes[s],
+						    formats[f],
+						    radius);
+				}
+
+	g_string_append (json, "\n  ]\n}\n");
+
+	if (output)
+	{
+		if (!g_file_set_contents (output, json->str, json->len, &error))
+		{
+			g_printerr ("%s\n", error->message);
+			g_clear_error (&error);
+			ok = FALSE;
+		}
+	}
+	else
+		g_print ("%s", json->str);
+
+	g_string_free (json, TRUE);
+
+	return ok ? 0 : 1;
+}
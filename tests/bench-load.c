@@ -0,0 +1,1006 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** bench-load.c - headless load-generator and end-to-end latency benchmark
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#define NOTIFY_NAME  "org.freedesktop.Notifications"
+#define NOTIFY_PATH  "/org/freedesktop/Notifications"
+#define NOTIFY_IFACE "org.freedesktop.Notifications"
+#define STATS_IFACE  "org.freedesktop.Notifications.Stats"
+
+typedef enum
+{
+	MIX_TEXT = 0, // summary and body
+	MIX_SUMMARY,  // summary only
+	MIX_ICON,     // themed icon, summary and body
+	MIX_IMAGE,    // image_data hint of --image-size
+	MIX_APPEND,   // x-canonical-append
+	MIX_REPLACE,  // replaces the most recently returned id
+	MIX_SYNC,     // synchronous volume-bubble with a value
+	MIX_LAST
+} MixKind;
+
+static const gchar* mix_names[MIX_LAST] = {
+	"text", "summary", "icon", "image", "append", "replace", "sync"
+};
+
+typedef struct _Bench
+{
+	GDBusConnection* connection;
+	GMainLoop*       loop;
+	GRand*           rand;
+	guint            weights[MIX_LAST];
+	guint            total_weight;
+	GBytes*          image;
+	guint            sent;
+	guint            completed;
+	guint            errors;
+	guint            outstanding;
+	guint            last_id;
+	gint64*          latencies; // usec, one per completed call
+	gint64           start;
+	gint64           end;
+} Bench;
+
+typedef struct _Call
+{
+	Bench*  bench;
+	gint64  sent;
+} Call;
+
+static gint     count       = 1000;
+static gint     rate        = 0;     // notifications per second, 0 is flat out
+static gint     window      = 16;    // calls in flight at most
+static gchar*   mix         = NULL;
+static gint     image_size  = 64;
+static gint     timeout     = 500;   // of each bubble, in ms
+static gint     settle      = 60;    // max. secs to wait for the queue to drain
+static gchar*   daemon_path = NULL;
+static gint     display     = 99;
+static gchar*   output      = NULL;
+static gboolean no_spawn    = FALSE;
+static gboolean keep_limits = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "count", 'n', 0, G_OPTION_ARG_INT, &count,
+	  "Number of notifications to send (default 1000)", "N" },
+	{ "rate", 'r', 0, G_OPTION_ARG_INT, &rate,
+	  "Notifications per second, 0 sends as fast as possible", "R" },
+	{ "window", 'w', 0, G_OPTION_ARG_INT, &window,
+	  "Max. number of calls in flight (default 16)", "W" },
+	{ "mix", 'm', 0, G_OPTION_ARG_STRING, &mix,
+	  "Weighted mix, e.g. text=60,image=20,sync=20 (kinds: text, "
+	  "summary, icon, image, append, replace, sync)", "MIX" },
+	{ "image-size", 0, 0, G_OPTION_ARG_INT, &image_size,
+	  "Width/height of image_data hints (default 64)", "PIXELS" },
+	{ "timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+	  "Expire-timeout of each notification in ms (default 500)", "MS" },
+	{ "settle", 0, 0, G_OPTION_ARG_INT, &settle,
+	  "Max. seconds to wait for the queue to drain (default 60)", "SECS" },
+	{ "daemon", 'd', 0, G_OPTION_ARG_FILENAME, &daemon_path,
+	  "notify-osd binary to benchmark", "PATH" },
+	{ "display", 0, 0, G_OPTION_ARG_INT, &display,
+	  "Number of the Xvfb-display to start (default 99)", "N" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+	  "Write the JSON-results to this file instead of stdout", "FILE" },
+	{ "no-spawn", 0, 0, G_OPTION_ARG_NONE, &no_spawn,
+	  "Use the running session-bus and notification-daemon", NULL },
+	{ "keep-limits", 0, 0, G_OPTION_ARG_NONE, &keep_limits,
+	  "Don't turn off per-sender rate-limiting and coalescing", NULL },
+	{ NULL }
+};
+
+//-- setup/teardown of Xvfb, bus and daemon ------------------------------------
+
+static GPid
+spawn_xvfb (void)
+{
+	gchar*  argv[8];
+	gchar*  name;
+	gchar*  socket;
+	GPid    pid    = 0;
+	GError* error  = NULL;
+	gint    tries;
+
+	name   = g_strdup_printf (":%d", display);
+	socket = g_strdup_printf ("/tmp/.X11-unix/X%d", display);
+
+	argv[0] = "Xvfb";
+	argv[1] = name;
+	argv[2] = "-screen";
+	argv[3] = "0";
+	argv[4] = "1280x1024x24";
+	argv[5] = "-nolisten";
+	argv[6] = "tcp";
+	argv[7] = NULL;
+
+	if (!g_spawn_async (NULL,
+			    argv,
+			    NULL,
+			    G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+			    G_SPAWN_STDOUT_TO_DEV_NULL |
+			    G_SPAWN_STDERR_TO_DEV_NULL,
+			    NULL,
+			    NULL,
+			    &pid,
+			    &error))
+	{
+		g_printerr ("Could not start Xvfb: %s\n", error->message);
+		g_error_free (error);
+		pid = 0;
+	}
+	else
+		for (tries = 0; tries < 100; tries++)
+		{
+			if (g_file_test (socket, G_FILE_TEST_EXISTS))
+				break;
+			g_usleep (50000);
+		}
+
+	g_free (name);
+	g_free (socket);
+
+	return pid;
+}
+
+// private session-bus, its address is the first line it prints
+static GPid
+spawn_bus (gchar** address)
+{
+	gchar*   argv[] = { "dbus-daemon",
+			    "--session",
+			    "--nofork",
+			    "--print-address=1",
+			    NULL };
+	GPid     pid    = 0;
+	gint     out    = -1;
+	GError*  error  = NULL;
+	GString* line;
+	gchar    c;
+
+	if (!g_spawn_async_with_pipes (NULL,
+				       argv,
+				       NULL,
+				       G_SPAWN_SEARCH_PATH |
+				       G_SPAWN_DO_NOT_REAP_CHILD,
+				       NULL,
+				       NULL,
+				       &pid,
+				       NULL,
+				       &out,
+				       NULL,
+				       &error))
+	{
+		g_printerr ("Could not start dbus-daemon: %s\n", error->message);
+		g_error_free (error);
+		return 0;
+	}
+
+	line = g_string_new (NULL);
+	while (read (out, &c, 1) == 1 && c != '\n')
+		g_string_append_c (line, c);
+	close (out);
+
+	*address = g_string_free (line, FALSE);
+
+	return pid;
+}
+
+static GPid
+spawn_daemon (gchar** envp)
+{
+	gchar*  argv[] = { daemon_path, NULL };
+	GPid    pid    = 0;
+	GError* error  = NULL;
+
+	if (!g_spawn_async (NULL,
+			    argv,
+			    envp,
+			    G_SPAWN_DO_NOT_REAP_CHILD |
+			    G_SPAWN_STDOUT_TO_DEV_NULL,
+			    NULL,
+			    NULL,
+			    &pid,
+			    &error))
+	{
+		g_printerr ("Could not start %s: %s\n",
+			    daemon_path,
+			    error->message);
+		g_error_free (error);
+		return 0;
+	}
+
+	return pid;
+}
+
+static void
+stop_process (GPid pid)
+{
+	if (!pid)
+		return;
+
+	kill (pid, SIGTERM);
+	waitpid (pid, NULL, 0);
+	g_spawn_close_pid (pid);
+}
+
+static gboolean
+wait_for_daemon (GDBusConnection* connection)
+{
+	GVariant* result;
+	gboolean  owned = FALSE;
+	gint      tries;
+
+	for (tries = 0; tries < 200 && !owned; tries++)
+	{
+		result = g_dbus_connection_call_sync (connection,
+						      "org.freedesktop.DBus",
+						      "/org/freedesktop/DBus",
+						      "org.freedesktop.DBus",
+						      "NameHasOwner",
+						      g_variant_new ("(s)",
+								     NOTIFY_NAME),
+						      G_VARIANT_TYPE ("(b)"),
+						      G_DBUS_CALL_FLAGS_NONE,
+						      -1,
+						      NULL,
+						      NULL);
+		if (result)
+		{
+			g_variant_get (result, "(b)", &owned);
+			g_variant_unref (result);
+		}
+
+		if (!owned)
+			g_usleep (50000);
+	}
+
+	return owned;
+}
+
+//-- load-generation -----------------------------------------------------------
+
+static gboolean
+parse_mix (Bench*       bench,
+	   const gchar* spec)
+{
+	gchar** items;
+	gint    i;
+	gint    kind;
+
+	memset (bench->weights, 0, sizeof (bench->weights));
+
+	if (!spec)
+	{
+		bench->weights[MIX_TEXT] = 1;
+		bench->total_weight      = 1;
+		return TRUE;
+	}
+
+	items = g_strsplit (spec, ",", -1);
+	for (i = 0; items[i]; i++)
+	{
+		gchar** pair = g_strsplit (items[i], "=", 2);
+
+		for (kind = 0; kind < MIX_LAST; kind++)
+			if (!g_strcmp0 (pair[0], mix_names[kind]))
+				break;
+
+		if (kind == MIX_LAST)
+		{
+			g_printerr ("Unknown kind '%s' in --mix\n", pair[0]);
+			g_strfreev (pair);
+			g_strfreev (items);
+			return FALSE;
+		}
+
+		bench->weights[kind] += pair[1] ? atoi (pair[1]) : 1;
+		g_strfreev (pair);
+	}
+	g_strfreev (items);
+
+	bench->total_weight = 0;
+	for (kind = 0; kind < MIX_LAST; kind++)
+		bench->total_weight += bench->weights[kind];
+
+	return bench->total_weight > 0;
+}
+
+static MixKind
+pick_kind (Bench* bench)
+{
+	guint   pick = g_rand_int_range (bench->rand, 0, bench->total_weight);
+	MixKind kind;
+
+	for (kind = 0; kind < MIX_LAST - 1; kind++)
+	{
+		if (pick < bench->weights[kind])
+			break;
+		pick -= bench->weights[kind];
+	}
+
+	return kind;
+}
+
+// every notification gets its own summary, so none of them is coalesced
+static GVariant*
+build_notify (Bench*  bench,
+	      MixKind kind)
+{
+	GVariantBuilder hints;
+	const gchar*    icon    = "";
+	gchar*          summary;
+	gchar*          body;
+	guint           id      = 0;
+	GVariant*       params;
+
+	g_variant_builder_init (&hints, G_VARIANT_TYPE_VARDICT);
+	summary = g_strdup_printf ("Benchmark %u", bench->sent);
+	body    = g_strdup_printf ("This is the body of notification %u, long "
+				   "enough to wrap onto a second line.",
+				   bench->sent);
+
+	switch (kind)
+	{
+		case MIX_SUMMARY:
+			g_free (body);
+			body = g_strdup ("");
+		break;
+
+		case MIX_ICON:
+			icon = "dialog-information";
+		break;
+
+		case MIX_IMAGE:
+			g_variant_builder_add (
+				&hints,
+				"{sv}",
+				"image_data",
+				g_variant_new ("(iiibii@ay)",
+					       image_size,
+					       image_size,
+					       image_size * 4,
+					       TRUE,
+					       8,
+					       4,
+					       g_variant_new_from_bytes (
+						       G_VARIANT_TYPE_BYTESTRING,
+						       bench->image,
+						       TRUE)));
+		break;
+
+		case MIX_APPEND:
+			g_variant_builder_add (&hints,
+					       "{sv}",
+					       "x-canonical-append",
+					       g_variant_new_string ("allowed"));
+			g_free (summary);
+			summary = g_strdup ("Benchmark chat");
+		break;
+
+		case MIX_REPLACE:
+			id = bench->last_id;
+		break;
+
+		case MIX_SYNC:
+			icon = "notification-audio-volume-medium";
+			g_free (summary);
+			summary = g_strdup ("Volume");
+			g_variant_builder_add (&hints,
+					       "{sv}",
+					       "x-canonical-private-synchronous",
+					       g_variant_new_string ("volume"));
+			g_variant_builder_add (&hints,
+					       "{sv}",
+					       "value",
+					       g_variant_new_int32 (bench->sent % 101));
+		break;
+
+		default:
+		break;
+	}
+
+	params = g_variant_new ("(susss@asa{sv}i)",
+				"bench-load",
+				id,
+				icon,
+				summary,
+				body,
+				g_variant_new_strv (NULL, 0),
+				&hints,
+				timeout);
+
+	g_free (summary);
+	g_free (body);
+
+	return params;
+}
+
+static void send_more (Bench* bench);
+
+static void
+notify_done (GObject*      source,
+	     GAsyncResult* res,
+	     gpointer      user_data)
+{
+	Call*     call  = user_data;
+	Bench*    bench = call->bench;
+	GVariant* result;
+	GError*   error = NULL;
+
+	result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+						res,
+						&error);
+
+	bench->latencies[bench->completed++] = g_get_monotonic_time () -
+					       call->sent;
+	bench->outstanding--;
+
+	if (result)
+	{
+		g_variant_get (result, "(u)", &bench->last_id);
+		g_variant_unref (result);
+	}
+	else
+	{
+		bench->errors++;
+		g_error_free (error);
+	}
+
+	g_free (call);
+
+	if (bench->completed == (guint) count)
+	{
+		bench->end = g_get_monotonic_time ();
+		g_main_loop_quit (bench->loop);
+	}
+	else if (!rate)
+		send_more (bench);
+}
+
+static void
+send_one (Bench* bench)
+{
+	Call* call = g_new0 (Call, 1);
+
+	call->bench = bench;
+	call->sent  = g_get_monotonic_time ();
+
+	g_dbus_connection_call (bench->connection,
+				NOTIFY_NAME,
+				NOTIFY_PATH,
+				NOTIFY_IFACE,
+				"Notify",
+				build_notify (bench, pick_kind (bench)),
+				G_VARIANT_TYPE ("(u)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				NULL,
+				notify_done,
+				call);
+
+	bench->sent++;
+	bench->outstanding++;
+}
+
+// flat out: keep the window full, rate-limited: catch up with the schedule
+static void
+send_more (Bench* bench)
+{
+	guint due = count;
+
+	if (rate)
+		due = MIN ((guint) count,
+			   (g_get_monotonic_time () - bench->start) * rate /
+			   G_USEC_PER_SEC + 1);
+
+	while (bench->sent < due && bench->outstanding < (guint) window)
+		send_one (bench);
+}
+
+static gboolean
+tick_cb (gpointer data)
+{
+	Bench* bench = data;
+
+	send_more (bench);
+
+	return bench->sent < (guint) count;
+}
+
+//-- results -------------------------------------------------------------------
+
+static gint
+compare_int64 (gconstpointer a,
+	       gconstpointer b)
+{
+	gint64 x = *(const gint64*) a;
+	gint64 y = *(const gint64*) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static gint64
+percentile (gint64* sorted,
+	    guint   n,
+	    gdouble fraction)
+{
+	guint index;
+
+	if (!n)
+		return 0;
+
+	index = (guint) (fraction * n);
+
+	return sorted[MIN (index, n - 1)];
+}
+
+// same estimate as stats_get_percentile(), from the (start, count)-pairs
+static gint64
+histogram_percentile (GVariant* buckets,
+		      guint     total,
+		      gint64    max,
+		      gdouble   fraction)
+{
+	GVariantIter iter;
+	gint64       start;
+	guint        n;
+	guint64      rank;
+	guint64      seen = 0;
+
+	if (!total)
+		return 0;
+
+	rank = MAX (1, (guint64) (fraction * total + 0.5));
+	if (rank >= total)
+		return max;
+
+	g_variant_iter_init (&iter, buckets);
+	while (g_variant_iter_next (&iter, "(xu)", &start, &n))
+	{
+		seen += n;
+		if (seen >= rank)
+			return MIN (start, max);
+	}
+
+	return max;
+}
+
+static void
+add_histogram (GString*     json,
+	       GVariant*    histograms,
+	       const gchar* name)
+{
+	GVariant* buckets = NULL;
+	guint     total   = 0;
+	gint64    sum     = 0;
+	gint64    max     = 0;
+
+	if (histograms)
+		g_variant_lookup (histograms,
+				  name,
+				  "(uxx@a(xu))",
+				  &total,
+				  &sum,
+				  &max,
+				  &buckets);
+
+	g_string_append_printf (json,
+				"{\"count\": %u, \"p50\": %" G_GINT64_FORMAT
+				", \"p99\": %" G_GINT64_FORMAT
+				", \"p999\": %" G_GINT64_FORMAT
+				", \"max\": %" G_GINT64_FORMAT "}",
+				total,
+				buckets ? histogram_percentile (buckets, total, max, 0.5) : 0,
+				buckets ? histogram_percentile (buckets, total, max, 0.99) : 0,
+				buckets ? histogram_percentile (buckets, total, max, 0.999) : 0,
+				max);
+
+	if (buckets)
+		g_variant_unref (buckets);
+}
+
+static GVariant*
+call_stats (GDBusConnection* connection,
+	    const gchar*     method,
+	    const gchar*     type)
+{
+	GVariant* result;
+	GVariant* value;
+
+	result = g_dbus_connection_call_sync (connection,
+					      NOTIFY_NAME,
+					      NOTIFY_PATH,
+					      STATS_IFACE,
+					      method,
+					      NULL,
+					      G_VARIANT_TYPE (type),
+					      G_DBUS_CALL_FLAGS_NONE,
+					      -1,
+					      NULL,
+					      NULL);
+	if (!result)
+		return NULL;
+
+	value = g_variant_get_child_value (result, 0);
+	g_variant_unref (result);
+
+	return value;
+}
+
+// bubbles are shown one after the other, give them a chance to make it on
+// screen so their first frame is part of the histogram
+static void
+wait_for_queue (GDBusConnection* connection)
+{
+	GVariant* counters;
+	guint     depth;
+	gint64    deadline = g_get_monotonic_time () + settle * G_USEC_PER_SEC;
+
+	while (g_get_monotonic_time () < deadline)
+	{
+		counters = call_stats (connection, "GetCounters", "(a{su})");
+		if (!counters)
+			return;
+
+		depth = 0;
+		g_variant_lookup (counters, "queue-depth", "u", &depth);
+		g_variant_unref (counters);
+
+		if (!depth)
+			return;
+
+		g_usleep (100000);
+	}
+}
+
+// user/system CPU-time in seconds and peak RSS in kB, from /proc
+static void
+add_process (GString* json,
+	     GPid     pid)
+{
+	gchar*  path;
+	gchar*  contents = NULL;
+	gchar*  p;
+	gulong  utime    = 0;
+	gulong  stime    = 0;
+	gulong  hwm      = 0;
+	glong   ticks    = sysconf (_SC_CLK_TCK);
+
+	path = g_strdup_printf ("/proc/%d/stat", pid);
+	if (pid && g_file_get_contents (path, &contents, NULL, NULL))
+	{
+		// skip pid and (comm), which may contain spaces
+		p = strrchr (contents, ')');
+		if (p)
+			sscanf (p + 2,
+				"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+				"%lu %lu",
+				&utime,
+				&stime);
+		g_free (contents);
+	}
+	g_free (path);
+
+	path = g_strdup_printf ("/proc/%d/status", pid);
+	if (pid && g_file_get_contents (path, &contents, NULL, NULL))
+	{
+		p = strstr (contents, "VmHWM:");
+		if (p)
+			sscanf (p + 6, "%lu", &hwm);
+		g_free (contents);
+	}
+	g_free (path);
+
+	g_string_append_printf (json,
+				"{\"cpu_user_s\": %.3f, \"cpu_system_s\": %.3f, "
+				"\"peak_rss_kb\": %lu}",
+				(gdouble) utime / ticks,
+				(gdouble) stime / ticks,
+				hwm);
+}
+
+static gchar*
+build_results (Bench* bench,
+	       GPid   daemon)
+{
+	GString*     json = g_string_new ("{\n");
+	GVariant*    counters;
+	GVariant*    histograms;
+	GVariantIter iter;
+	const gchar* name;
+	guint        value;
+	gdouble      secs;
+	gint         kind;
+	gboolean     first;
+
+	secs = (bench->end - bench->start) / (gdouble) G_USEC_PER_SEC;
+	qsort (bench->latencies,
+	       bench->completed,
+	       sizeof (gint64),
+	       compare_int64);
+
+	g_string_append_printf (json,
+				"  \"count\": %u,\n"
+				"  \"errors\": %u,\n"
+				"  \"duration_s\": %.3f,\n"
+				"  \"throughput\": %.1f,\n"
+				"  \"rate\": %d,\n"
+				"  \"window\": %d,\n"
+				"  \"image_size\": %d,\n",
+				bench->completed,
+				bench->errors,
+				secs,
+				secs > 0.0 ? bench->completed / secs : 0.0,
+				rate,
+				window,
+				image_size);
+
+	g_string_append (json, "  \"mix\": {");
+	for (kind = 0, first = TRUE; kind < MIX_LAST; kind++)
+		if (bench->weights[kind])
+		{
+			g_string_append_printf (json,
+						"%s\"%s\": %u",
+						first ? "" : ", ",
+						mix_names[kind],
+						bench->weights[kind]);
+			first = FALSE;
+		}
+	g_string_append (json, "},\n");
+
+	g_string_append_printf (json,
+				"  \"reply_latency_us\": {\"p50\": %" G_GINT64_FORMAT
+				", \"p99\": %" G_GINT64_FORMAT
+				", \"p999\": %" G_GINT64_FORMAT
+				", \"max\": %" G_GINT64_FORMAT "},\n",
+				percentile (bench->latencies, bench->completed, 0.5),
+				percentile (bench->latencies, bench->completed, 0.99),
+				percentile (bench->latencies, bench->completed, 0.999),
+				percentile (bench->latencies, bench->completed, 1.0));
+
+	wait_for_queue (bench->connection);
+
+	// as seen by the daemon, time-to-first-frame stands in for time-to-map
+	histograms = call_stats (bench->connection,
+				 "GetHistograms",
+				 "(a{s(uxxa(xu))})");
+	g_string_append (json, "  \"daemon_reply_latency_us\": ");
+	add_histogram (json, histograms, "reply-latency");
+	g_string_append (json, ",\n  \"first_frame_us\": ");
+	add_histogram (json, histograms, "first-frame");
+	g_string_append (json, ",\n  \"frame_render_us\": ");
+	add_histogram (json, histograms, "frame-render");
+	g_string_append (json, ",\n");
+	if (histograms)
+		g_variant_unref (histograms);
+
+	g_string_append (json, "  \"counters\": {");
+	counters = call_stats (bench->connection, "GetCounters", "(a{su})");
+	if (counters)
+	{
+		g_variant_iter_init (&iter, counters);
+		for (first = TRUE;
+		     g_variant_iter_next (&iter, "{&su}", &name, &value);
+		     first = FALSE)
+			g_string_append_printf (json,
+						"%s\"%s\": %u",
+						first ? "" : ", ",
+						name,
+						value);
+		g_variant_unref (counters);
+	}
+	g_string_append (json, "},\n");
+
+	g_string_append (json, "  \"daemon\": ");
+	add_process (json, daemon);
+	g_string_append (json, "\n}\n");
+
+	return g_string_free (json, FALSE);
+}
+
+//-- main ----------------------------------------------------------------------
+
+int
+main (int    argc,
+      char** argv)
+{
+	GOptionContext* context;
+	GError*         error      = NULL;
+	Bench           bench      = { 0 };
+	GPid            xvfb       = 0;
+	GPid            bus        = 0;
+	GPid            daemon     = 0;
+	gchar*          address    = NULL;
+	gchar*          settings   = NULL;
+	gchar*          name       = NULL;
+	GVariant*       reply;
+	gchar*          results;
+	gchar**         envp;
+	guchar*         pixels;
+	gint            i;
+	gint            status     = 1;
+
+	context = g_option_context_new ("- benchmark notify-osd under load");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+	{
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (count <= 0 || window <= 0 || image_size <= 0 || !parse_mix (&bench, mix))
+	{
+		g_printerr ("Invalid arguments, see --help\n");
+		return 1;
+	}
+
+	if (!daemon_path)
+		daemon_path = g_strdup (NOTIFY_OSD_BINARY);
+
+	bench.rand      = g_rand_new_with_seed (42);
+	bench.latencies = g_new0 (gint64, count);
+
+	pixels = g_malloc (image_size * image_size * 4);
+	for (i = 0; i < image_size * image_size * 4; i++)
+		pixels[i] = g_rand_int_range (bench.rand, 0, 256);
+	bench.image = g_bytes_new_take (pixels, image_size * image_size * 4);
+
+	if (no_spawn)
+		bench.connection = g_bus_get_sync (G_BUS_TYPE_SESSION,
+						   NULL,
+						   &error);
+	else
+	{
+		xvfb = spawn_xvfb ();
+		bus  = xvfb ? spawn_bus (&address) : 0;
+		if (!bus)
+			goto out;
+
+		// the stack- and forced-shutdown-limits stay, but a single
+		// sender must not be throttled, nor must it be coalesced
+		settings = g_build_filename (g_get_tmp_dir (),
+					     "bench-load-settings-XXXXXX",
+					     NULL);
+		g_close (g_mkstemp (settings), NULL);
+		g_file_set_contents (settings,
+				     keep_limits ?
+				     "forced-shutdown-threshold = 0\n" :
+				     "forced-shutdown-threshold = 0\n"
+				     "sender-rate-burst = 0\n"
+				     "coalesce-window = 0\n",
+				     -1,
+				     NULL);
+
+		name = g_strdup_printf (":%d", display);
+		envp = g_get_environ ();
+		envp = g_environ_setenv (envp, "DISPLAY", name, TRUE);
+		envp = g_environ_setenv (envp,
+					 "DBUS_SESSION_BUS_ADDRESS",
+					 address,
+					 TRUE);
+		envp = g_environ_setenv (envp,
+					 "NOTIFY_OSD_SETTINGS",
+					 settings,
+					 TRUE);
+		daemon = spawn_daemon (envp);
+		g_strfreev (envp);
+		if (!daemon)
+			goto out;
+
+		bench.connection = g_dbus_connection_new_for_address_sync (
+			address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL,
+			NULL,
+			&error);
+	}
+
+	if (!bench.connection)
+	{
+		g_printerr ("Could not connect to the bus: %s\n",
+			    error ? error->message : "unknown error");
+		g_clear_error (&error);
+		goto out;
+	}
+
+	if (!wait_for_daemon (bench.connection))
+	{
+		g_printerr ("%s did not show up on the bus\n", NOTIFY_NAME);
+		goto out;
+	}
+
+	// start from a clean slate, e.g. when reusing a running daemon
+	reply = g_dbus_connection_call_sync (bench.connection,
+					     NOTIFY_NAME,
+					     NOTIFY_PATH,
+					     STATS_IFACE,
+					     "ResetHistograms",
+					     NULL,
+					     NULL,
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1,
+					     NULL,
+					     NULL);
+	if (reply)
+		g_variant_unref (reply);
+
+	bench.loop  = g_main_loop_new (NULL, FALSE);
+	bench.start = g_get_monotonic_time ();
+
+	if (rate)
+		g_timeout_add (1, tick_cb, &bench);
+	send_more (&bench);
+
+	g_main_loop_run (bench.loop);
+
+	results = build_results (&bench, daemon);
+	if (output)
+	{
+		if (!g_file_set_contents (output, results, -1, &error))
+		{
+			g_printerr ("Could not write %s: %s\n",
+				    output,
+				    error->message);
+			g_error_free (error);
+		}
+	}
+	else
+		g_print ("%s", results);
+	g_free (results);
+
+	g_main_loop_unref (bench.loop);
+	status = 0;
+
+out:
+	if (bench.connection)
+		g_object_unref (bench.connection);
+	stop_process (daemon);
+	stop_process (bus);
+	stop_process (xvfb);
+	if (settings)
+		g_unlink (settings);
+	g_free (settings);
+	g_free (name);
+	g_free (address);
+	g_bytes_unref (bench.image);
+	g_free (bench.latencies);
+	g_rand_free (bench.rand);
+
+	return status;
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** bench-render.c - per-layout micro-benchmark of offscreen bubble-rendering
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "defaults.h"
+#include "bubble.h"
+
+// matches the resolution offscreen bubbles lay out their text with
+#define BENCH_DPI       96.0f
+#define BENCH_FONT_SIZE 10.0f
+#define BENCH_FONT_FACE "Sans"
+
+typedef struct _Case
+{
+	BubbleLayout layout;
+	const gchar* name;
+	gboolean     has_body;
+} Case;
+
+static const Case cases[] = {
+	{ LAYOUT_ICON_ONLY,       "icon-only",       FALSE },
+	{ LAYOUT_ICON_INDICATOR,  "icon-indicator",  FALSE },
+	{ LAYOUT_ICON_TITLE,      "icon-title",      FALSE },
+	{ LAYOUT_ICON_TITLE_BODY, "icon-title-body", TRUE  },
+	{ LAYOUT_TITLE_BODY,      "title-body",      TRUE  },
+	{ LAYOUT_TITLE_ONLY,      "title-only",      FALSE }
+};
+
+// number of characters of body-text, the last one hits the 10-line-limit
+static const gint body_lengths[] = { 20, 100, 400, 1000 };
+
+// mouse-over distance, 1.0 is the regular look, 0.0 the pointer on top of it
+static const gdouble distances[] = { 1.0f, 0.5f, 0.0f };
+
+static const gchar* lorem =
+	"Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do "
+	"eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad "
+	"minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip "
+	"ex ea commodo consequat. ";
+
+static gint   iterations = 50;
+static gchar* png_dir    = NULL;
+static gchar* output     = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of timed runs per measurement (default 50)", "N" },
+	{ "png-dir", 'p', 0, G_OPTION_ARG_FILENAME, &png_dir,
+	  "Write one PNG per layout, body-length and distance to this "
+	  "directory", "DIR" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+	  "Write the JSON-results to this file instead of stdout", "FILE" },
+	{ NULL }
+};
+
+//-- bubbles -------------------------------------------------------------------
+
+static gchar*
+make_body (gint length)
+{
+	GString* body = g_string_sized_new (length);
+
+	while ((gint) body->len < length)
+		g_string_append (body, lorem);
+
+	g_string_truncate (body, length);
+
+	return g_string_free (body, FALSE);
+}
+
+static Bubble*
+make_bubble (Defaults*   defaults,
+	     const Case* c,
+	     const gchar* body)
+{
+	Bubble*    bubble;
+	GdkPixbuf* pixbuf;
+
+	bubble = bubble_new (defaults);
+	bubble_set_offscreen (bubble, TRUE);
+
+	switch (c->layout)
+	{
+		case LAYOUT_ICON_ONLY:
+			bubble_set_title (bubble, "Eject");
+			bubble_set_icon_only (bubble, TRUE);
+		break;
+
+		case LAYOUT_ICON_INDICATOR:
+			bubble_set_title (bubble, "Volume");
+			bubble_set_value (bubble, 60);
+		break;
+
+		case LAYOUT_ICON_TITLE:
+			bubble_set_title (bubble, "Wireless signal lost");
+		break;
+
+		default:
+			bubble_set_title (bubble, "Jane Doe");
+			if (c->has_body)
+				bubble_set_message_body (bubble, body);
+		break;
+	}
+
+	if (c->layout != LAYOUT_TITLE_BODY && c->layout != LAYOUT_TITLE_ONLY)
+	{
+		// the bubble takes over the reference
+		pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 128, 128);
+		gdk_pixbuf_fill (pixbuf, 0x3465a4ff);
+		bubble_set_icon_from_pixbuf (bubble, pixbuf);
+	}
+
+	return bubble;
+}
+
+//-- measuring -----------------------------------------------------------------
+
+static gint
+compare_times (gconstpointer a,
+	       gconstpointer b)
+{
+	gint64 x = *(const gint64*) a;
+	gint64 y = *(const gint64*) b;
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// times are sorted in place
+static void
+add_times (GString* json,
+	   gint64*  times,
+	   gint     n)
+{
+	gint64 sum = 0;
+	gint   i;
+
+	qsort (times, n, sizeof (gint64), compare_times);
+	for (i = 0; i < n; i++)
+		sum += times[i];
+
+	g_string_append_printf (json,
+				"\"min\": %" G_GINT64_FORMAT ", "
+				"\"p50\": %" G_GINT64_FORMAT ", "
+				"\"p99\": %" G_GINT64_FORMAT ", "
+				"\"max\": %" G_GINT64_FORMAT ", "
+				"\"mean\": %.1f",
+				times[0],
+				times[n / 2],
+				times[MIN ((gint) (0.99f * n), n - 1)],
+				times[n - 1],
+				(gdouble) sum / n);
+}
+
+static gboolean
+write_png (cairo_surface_t* surface,
+	   const Case*      c,
+	   gint             body_length,
+	   gdouble          distance)
+{
+	cairo_status_t status;
+	gchar*         name;
+	gchar*         filename;
+
+	name = g_strdup_printf ("%s-b%04d-d%03d.png",
+				c->name,
+				body_length,
+				(gint) (distance * 100.0f));
+	filename = g_build_filename (png_dir, name, NULL);
+	status = cairo_surface_write_to_png (surface, filename);
+	if (status != CAIRO_STATUS_SUCCESS)
+		g_printerr ("Could not write %s: %s\n",
+			    filename,
+			    cairo_status_to_string (status));
+
+	g_free (filename);
+	g_free (name);
+
+	return status == CAIRO_STATUS_SUCCESS;
+}
+
+// one layout at one body-length: bubble_recalc_size() on fresh bubbles (it
+// skips re-rendering unchanged tiles otherwise) and full frames per distance
+static gboolean
+bench_case (GString*    json,
+	    Defaults*   defaults,
+	    const Case* c,
+	    gint        body_length)
+{
+	Bubble*          bubble = NULL;
+	cairo_surface_t* surface;
+	gint64*          times;
+	gint64           start;
+	gchar*           body;
+	gint             width  = 0;
+	gint             height = 0;
+	gint             i;
+	guint            d;
+	gboolean         ok     = TRUE;
+
+	body  = make_body (body_length);
+	times = g_new0 (gint64, iterations);
+
+	for (i = 0; i < iterations; i++)
+	{
+		if (bubble)
+			g_object_unref (bubble);
+		bubble = make_bubble (defaults, c, body);
+
+		start = g_get_monotonic_time ();
+		bubble_recalc_size (bubble);
+		times[i] = g_get_monotonic_time () - start;
+	}
+
+	if (bubble_get_layout (bubble) != c->layout)
+	{
+		g_printerr ("%s: got layout %d instead\n",
+			    c->name,
+			    bubble_get_layout (bubble));
+		ok = FALSE;
+	}
+
+	bubble_get_size (bubble, &width, &height);
+
+	g_string_append_printf (json,
+				"    { \"layout\": \"%s\", \"body-length\": %d, "
+				"\"width\": %d, \"height\": %d,\n"
+				"      \"recalc-size\": { ",
+				c->name,
+				c->has_body ? body_length : 0,
+				width,
+				height);
+	add_times (json, times, iterations);
+	g_string_append (json, " },\n      \"render\": [\n");
+
+	for (d = 0; d < G_N_ELEMENTS (distances); d++)
+	{
+		for (i = 0; i < iterations; i++)
+		{
+			start = g_get_monotonic_time ();
+			surface = bubble_render_to_surface (bubble,
+							    distances[d]);
+			times[i] = g_get_monotonic_time () - start;
+
+			if (!surface)
+			{
+				ok = FALSE;
+				break;
+			}
+
+			if (png_dir && i == 0)
+				ok &= write_png (surface,
+						 c,
+						 c->has_body ? body_length : 0,
+						 distances[d]);
+
+			cairo_surface_destroy (surface);
+		}
+
+		if (!ok)
+			break;
+
+		g_string_append_printf (json,
+					"%s        { \"distance\": %.2f, ",
+					d > 0 ? ",\n" : "",
+					distances[d]);
+		add_times (json, times, iterations);
+		g_string_append (json, " }");
+	}
+
+	g_string_append (json, "\n      ] }");
+
+	g_object_unref (bubble);
+	g_free (times);
+	g_free (body);
+
+	return ok;
+}
+
+int
+main (int    argc,
+      char** argv)
+{
+	GOptionContext* context;
+	GError*         error   = NULL;
+	Defaults*       defaults;
+	GString*        json;
+	guint           c;
+	guint           l;
+	gboolean        first   = TRUE;
+	gboolean        ok      = TRUE;
+
+	context = g_option_context_new ("- benchmark offscreen bubble-rendering");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error))
+	{
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (iterations <= 0)
+	{
+		g_printerr ("Invalid arguments, see --help\n");
+		return 1;
+	}
+
+	if (png_dir && g_mkdir_with_parents (png_dir, 0755) != 0)
+	{
+		g_printerr ("Could not create %s\n", png_dir);
+		return 1;
+	}
+
+	// Defaults still needs a display, e.g. Xvfb, to be created at all
+	if (!gtk_init_check (NULL, NULL))
+	{
+		g_printerr ("Could not open a display\n");
+		return 1;
+	}
+
+	// the bubble-geometry derives from these, pin them so results and PNGs
+	// don't depend on the desktop-settings of the machine running this
+	defaults = defaults_new ();
+	g_object_set (defaults,
+		      "text-font-face",   BENCH_FONT_FACE,
+		      "system-font-size", (gdouble) BENCH_FONT_SIZE,
+		      "screen-dpi",       (gdouble) BENCH_DPI,
+		      "pixels-per-em",    (gdouble) (BENCH_FONT_SIZE *
+							 BENCH_DPI / 72.0f),
+		      NULL);
+
+	json = g_string_new ("{\n");
+	g_string_append_printf (json,
+				"  \"dpi\": %.1f,\n  \"iterations\": %d,\n"
+				"  \"unit\": \"usec\",\n  \"cases\": [\n",
+				BENCH_DPI,
+				iterations);
+
+	for (c = 0; c < G_N_ELEMENTS (cases); c++)
+		for (l = 0; l < G_N_ELEMENTS (body_lengths); l++)
+		{
+			// body-length is meaningless without a body
+			if (!cases[c].has_body && l > 0)
+				break;
+
+			if (!first)
+				g_string_append (json, ",\n");
+			first = FALSE;
+
+			ok &= bench_case (json,
+					  defaults,
+					  &cases[c],
+					  body_lengths[l]);
+		}
+
+	g_string_append (json, "\n  ]\n}\n");
+
+	if (output)
+	{
+		if (!g_file_set_contents (output, json->str, json->len, &error))
+		{
+			g_printerr ("%s\n", error->message);
+			g_clear_error (&error);
+			ok = FALSE;
+		}
+	}
+	else
+		g_print ("%s", json->str);
+
+	g_string_free (json, TRUE);
+	g_object_unref (defaults);
+
+	return ok ? 0 : 1;
+}
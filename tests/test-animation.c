@@ -0,0 +1,174 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-animation.c - unit-tests for the shared animation frame-clock
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "animation.h"
+
+#define FRAME (G_USEC_PER_SEC / ANIMATION_FPS)
+
+typedef struct _Record
+{
+	guint      frames;
+	guint      done;
+	gdouble    value;
+	gboolean   stop_in_frame;
+	Animation* started;
+} Record;
+
+static void
+frame_cb (Animation* animation,
+	  gdouble    value,
+	  gpointer   data)
+{
+	Record* record = (Record*) data;
+
+	record->frames++;
+	record->value = value;
+
+	if (record->stop_in_frame)
+		animation_stop (animation);
+}
+
+static void
+done_cb (Animation* animation,
+	 gpointer   data)
+{
+	((Record*) data)->done++;
+}
+
+static void
+test_animation_ramp ()
+{
+	Record     inc    = { 0 };
+	Record     dec    = { 0 };
+	Animation* up;
+	Animation* down;
+	gint64     now    = g_get_monotonic_time ();
+
+	up   = animation_start (100, EGG_ALPHA_RAMP_INC, frame_cb, done_cb, &inc);
+	down = animation_start (100, EGG_ALPHA_RAMP_DEC, frame_cb, done_cb, &dec);
+
+	// a decreasing ramp has to be fully visible before its first frame
+	g_assert_cmpfloat (animation_get_value (up), <, 0.01f);
+	g_assert_cmpfloat (animation_get_value (down), >, 0.99f);
+
+	animation_advance (now + 50000);
+	g_assert_cmpuint (inc.frames, ==, 1);
+	g_assert_cmpfloat (inc.value, >, 0.4f);
+	g_assert_cmpfloat (inc.value, <, 0.6f);
+	g_assert_cmpfloat (dec.value, >, 0.4f);
+	g_assert_cmpfloat (dec.value, <, 0.6f);
+	g_assert_cmpuint (inc.done, ==, 0);
+
+	// progress is based on time, a late tick completes it all the same
+	animation_advance (now + 500000);
+	g_assert_cmpuint (inc.frames, ==, 2);
+	g_assert_cmpfloat (inc.value, >, 0.99f);
+	g_assert_cmpfloat (dec.value, <, 0.01f);
+	g_assert_cmpuint (inc.done, ==, 1);
+	g_assert_cmpuint (dec.done, ==, 1);
+
+	// both are gone now
+	animation_advance (now + 600000);
+	g_assert_cmpuint (inc.frames, ==, 2);
+	g_assert_cmpuint (inc.done, ==, 1);
+}
+
+static void
+test_animation_stop ()
+{
+	Record         open  = { 0 };
+	Record         fade  = { 0 };
+	Animation*     forever;
+	Animation*     once;
+	AnimationStats stats;
+	gint64         now   = g_get_monotonic_time ();
+
+	forever = animation_start (0, NULL, frame_cb, done_cb, &open);
+	once    = animation_start (1000, NULL, frame_cb, done_cb, &fade);
+	fade.stop_in_frame = TRUE;
+
+	animation_advance (now + FRAME);
+	animation_advance (now + 2 * FRAME);
+	g_assert_cmpuint (open.frames, ==, 2);
+	g_assert_cmpfloat (open.value, ==, 0.0f);
+
+	// stopping from within the frame-callback never calls done
+	g_assert_cmpuint (fade.frames, ==, 1);
+	g_assert_cmpuint (fade.done, ==, 0);
+
+	animation_get_stats (&stats);
+	g_assert_cmpuint (stats.active, ==, 1);
+
+	animation_stop (forever);
+	animation_advance (now + 3 * FRAME);
+	g_assert_cmpuint (open.frames, ==, 2);
+	g_assert_cmpuint (open.done, ==, 0);
+
+	animation_get_stats (&stats);
+	g_assert_cmpuint (stats.active, ==, 0);
+}
+
+static void
+test_animation_dropped_frames ()
+{
+	Record         record = { 0 };
+	Animation*     animation;
+	AnimationStats stats;
+	gint64         now    = g_get_monotonic_time ();
+
+	animation = animation_start (0, NULL, frame_cb, NULL, &record);
+	animation_reset_stats ();
+
+	animation_advance (now);
+	animation_advance (now + FRAME);
+	animation_advance (now + 2 * FRAME + FRAME / 4);
+
+	// the clock stalled for four frames, three of them never happened
+	animation_advance (now + 6 * FRAME);
+
+	animation_get_stats (&stats);
+	g_assert_cmpuint (stats.frames, ==, 4);
+	g_assert_cmpuint (stats.dropped, ==, 3);
+	g_assert_cmpuint (record.frames, ==, 4);
+
+	animation_stop (animation);
+}
+
+GTestSuite *
+test_animation_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("animation");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_animation_ramp));
+	g_test_suite_add(ts, TC(test_animation_stop));
+	g_test_suite_add(ts, TC(test_animation_dropped_frames));
+
+	return ts;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-backlog.c - unit-tests for the backlog-policy of the stack
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "backlog.h"
+
+extern gint BACKLOG_THRESHOLD;
+extern gint BACKLOG_MIN_TIMEOUT;
+
+static void
+test_backlog_scale ()
+{
+	gint old_threshold   = BACKLOG_THRESHOLD;
+	gint old_min_timeout = BACKLOG_MIN_TIMEOUT;
+
+	// 0 disables the policy
+	BACKLOG_THRESHOLD = 0;
+	g_assert_cmpuint (backlog_scale_timeout (5000, 200), ==, 5000);
+	g_assert_cmpuint (backlog_scale_fade (200, 200), ==, 200);
+
+	BACKLOG_THRESHOLD   = 4;
+	BACKLOG_MIN_TIMEOUT = 1500;
+
+	// untouched up to the threshold
+	g_assert_cmpuint (backlog_scale_timeout (5000, 4), ==, 5000);
+	g_assert_cmpuint (backlog_scale_fade (200, 4), ==, 200);
+
+	// shrinking with the depth beyond it
+	g_assert_cmpuint (backlog_scale_timeout (5000, 8), ==, 2500);
+	g_assert_cmpuint (backlog_scale_fade (200, 8), ==, 100);
+
+	// down to the floor, fades down to a single msec
+	g_assert_cmpuint (backlog_scale_timeout (5000, 200), ==, 1500);
+	g_assert_cmpuint (backlog_scale_fade (200, 1000), ==, 1);
+	g_assert_cmpuint (backlog_scale_fade (0, 1000), ==, 0);
+
+	// bubbles shorter than the floor aren't made any longer
+	g_assert_cmpuint (backlog_scale_timeout (1000, 200), ==, 1000);
+
+	BACKLOG_THRESHOLD   = old_threshold;
+	BACKLOG_MIN_TIMEOUT = old_min_timeout;
+}
+
+static void
+test_backlog_drain_rate ()
+{
+	Backlog* backlog = backlog_new ();
+	gint64   now     = 1000 * G_USEC_PER_SEC;
+	gint     i;
+
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), ==, 0);
+
+	// one every two seconds
+	for (i = 0; i < 10; i++)
+		backlog_note_drained (backlog, now + i * 2 * G_USEC_PER_SEC);
+	now += 20 * G_USEC_PER_SEC;
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), ==, 10);
+
+	// older ones fall out of the window
+	now += 45 * G_USEC_PER_SEC;
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), ==, 7);
+	now += 60 * G_USEC_PER_SEC;
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), ==, 0);
+
+	// 1000 in 10 seconds overflow the ring, the rate gets extrapolated
+	for (i = 0; i < 1000; i++)
+		backlog_note_drained (backlog, now + i * 10 * 1000);
+	now += 10 * G_USEC_PER_SEC;
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), >=, 5000);
+	g_assert_cmpuint (backlog_get_drain_rate (backlog, now), <=, 7000);
+
+	backlog_free (backlog);
+}
+
+GTestSuite *
+test_backlog_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("backlog");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_backlog_scale));
+	g_test_suite_add(ts, TC(test_backlog_drain_rate));
+
+	return ts;
+}
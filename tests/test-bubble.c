@@ -27,11 +27,15 @@
 *******************************************************************************/
 
 #include <unistd.h>
+#include <string.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 
 #include "bubble.h"
 #include "util.h"
+#include "icon-cache.h"
+
+extern gint BUBBLE_ICON_LOAD_TIMEOUT;
 
 static
 gboolean
@@ -123,6 +127,202 @@ test_bubble_get_attributes (gpointer fixture, gconstpointer user_data)
 	g_object_unref (defaults);
 }
 
+// a busy machine must not make the bubble give up waiting for its icon, the
+// "icon-ready" of that would end the test before the icon is there
+static
+void
+wait_for_icon (Bubble* bubble)
+{
+	GMainLoop* loop;
+	GSource*   guard;
+	guint      guard_id;
+	gulong     handler_id;
+
+	loop = g_main_loop_new (NULL, FALSE);
+	handler_id = g_signal_connect_swapped (G_OBJECT (bubble),
+					       "icon-ready",
+					       G_CALLBACK (g_main_loop_quit),
+					       loop);
+	guard_id = g_timeout_add (5000, (GSourceFunc) stop_main_loop, loop);
+	g_main_loop_run (loop);
+
+	guard = g_main_context_find_source_by_id (NULL, guard_id);
+	if (guard)
+		g_source_destroy (guard);
+	g_signal_handler_disconnect (bubble, handler_id);
+	g_main_loop_unref (loop);
+}
+
+// top_srcdir is relative for in-tree builds, but only absolute paths (or
+// file://-URIs) are taken as files instead of as icon-names
+static
+gchar*
+get_avatar_path (void)
+{
+	gchar* cwd;
+	gchar* path;
+
+	if (g_path_is_absolute (SRCDIR))
+		return g_strdup (SRCDIR"/icons/avatar.png");
+
+	cwd  = g_get_current_dir ();
+	path = g_build_filename (cwd, SRCDIR, "icons", "avatar.png", NULL);
+	g_free (cwd);
+
+	return path;
+}
+
+static
+void
+test_bubble_icon_async (gpointer fixture, gconstpointer user_data)
+{
+	Bubble*    bubble;
+	Defaults*  defaults;
+	gchar*     path;
+	gint       old_timeout = BUBBLE_ICON_LOAD_TIMEOUT;
+
+	icon_cache_clear ();
+	BUBBLE_ICON_LOAD_TIMEOUT = 10000;
+
+	defaults = defaults_new ();
+	bubble = bubble_new (defaults);
+	bubble_set_title (bubble, "Async");
+	bubble_set_message_body (bubble, "Icon is decoded in the background");
+	path = get_avatar_path ();
+	bubble_set_icon_from_path (bubble, path);
+	g_free (path);
+
+	// layout already accounts for the icon still being loaded
+	g_assert (bubble_is_icon_pending (bubble));
+	g_assert (bubble_get_icon_pixbuf (bubble) == NULL);
+	bubble_determine_layout (bubble);
+	g_assert_cmpint (bubble_get_layout (bubble), ==, LAYOUT_ICON_TITLE_BODY);
+
+	wait_for_icon (bubble);
+
+	g_assert (!bubble_is_icon_pending (bubble));
+	g_assert (bubble_get_icon_pixbuf (bubble) != NULL);
+
+	BUBBLE_ICON_LOAD_TIMEOUT = old_timeout;
+	g_object_unref (bubble);
+	g_object_unref (defaults);
+}
+
+static
+void
+test_bubble_icon_path (gpointer fixture, gconstpointer user_data)
+{
+	Bubble*    bubble;
+	Defaults*  defaults;
+	gchar*     path;
+	gchar*     uri;
+	gint       old_timeout = BUBBLE_ICON_LOAD_TIMEOUT;
+
+	icon_cache_clear ();
+	BUBBLE_ICON_LOAD_TIMEOUT = 10000;
+
+	defaults = defaults_new ();
+	path = get_avatar_path ();
+	uri  = g_strconcat ("file://", path, NULL);
+
+	// app_icon of Notify can be a path or an URI instead of a theme-name
+	bubble = bubble_new (defaults);
+	bubble_set_icon (bubble, path);
+	wait_for_icon (bubble);
+	g_assert (bubble_get_icon_pixbuf (bubble) != NULL);
+	g_object_unref (bubble);
+
+	icon_cache_clear ();
+	bubble = bubble_new (defaults);
+	bubble_set_icon (bubble, uri);
+	wait_for_icon (bubble);
+	g_assert (bubble_get_icon_pixbuf (bubble) != NULL);
+	g_object_unref (bubble);
+
+	BUBBLE_ICON_LOAD_TIMEOUT = old_timeout;
+	g_free (uri);
+	g_free (path);
+	g_object_unref (defaults);
+}
+
+static
+void
+test_bubble_icon_keeps_source (gpointer fixture, gconstpointer user_data)
+{
+	Bubble*    bubble;
+	Defaults*  defaults;
+	GdkPixbuf* pixbuf;
+
+	defaults = defaults_new ();
+	bubble = bubble_new (defaults);
+	bubble_set_title (bubble, "Avatar");
+	bubble_set_message_body (bubble, "Not a square one");
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 200, 100);
+	gdk_pixbuf_fill (pixbuf, 0xff0000ff);
+	bubble_set_icon_from_pixbuf (bubble, pixbuf);
+
+	// updates/appends must not rescale the icon over and over again
+	bubble_recalc_size (bubble);
+	bubble_recalc_size (bubble);
+	g_assert (bubble_get_icon_pixbuf (bubble) == pixbuf);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 200);
+	g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 100);
+	g_assert_cmpint (bubble_get_layout (bubble), ==, LAYOUT_ICON_TITLE_BODY);
+
+	g_object_unref (bubble);
+	g_object_unref (defaults);
+}
+
+static
+void
+test_bubble_render_offscreen (gpointer fixture, gconstpointer user_data)
+{
+	Bubble*          bubble;
+	Defaults*        defaults;
+	cairo_surface_t* first;
+	cairo_surface_t* second;
+	gint             width;
+	gint             height;
+	gint             size;
+	guint32*         center;
+
+	defaults = defaults_new ();
+	bubble = bubble_new (defaults);
+	bubble_set_offscreen (bubble, TRUE);
+	g_assert (bubble_is_offscreen (bubble));
+
+	// nothing to draw before the bubble has been measured
+	g_assert (bubble_render_to_surface (bubble, 1.0f) == NULL);
+
+	bubble_set_title (bubble, "Offscreen");
+	bubble_set_message_body (bubble, "Rendered without ever being shown");
+	bubble_recalc_size (bubble);
+	bubble_get_size (bubble, &width, &height);
+
+	first  = bubble_render_to_surface (bubble, 1.0f);
+	second = bubble_render_to_surface (bubble, 1.0f);
+	g_assert (first != NULL && second != NULL);
+	g_assert_cmpint (cairo_image_surface_get_width (first), ==, width);
+	g_assert_cmpint (cairo_image_surface_get_height (first), ==, height);
+
+	// the bubble-background is opaque-ish in its center, and repeated
+	// renderings of the same bubble have to be identical
+	size = cairo_image_surface_get_stride (first) * height;
+	center = (guint32*) (cairo_image_surface_get_data (first) +
+			     (height / 2) * cairo_image_surface_get_stride (first)) +
+		 width / 2;
+	g_assert_cmpuint (*center >> 24, >, 0);
+	g_assert (!memcmp (cairo_image_surface_get_data (first),
+			   cairo_image_surface_get_data (second),
+			   size));
+
+	cairo_surface_destroy (first);
+	cairo_surface_destroy (second);
+	g_object_unref (bubble);
+	g_object_unref (defaults);
+}
+
 GTestSuite *
 test_bubble_create_test_suite (void)
 {
@@ -155,6 +355,38 @@ test_bubble_create_test_suite (void)
 					      test_bubble_set_attributes,
 					      NULL));
 
+	g_test_suite_add (ts,
+			  g_test_create_case ("can load icons asynchronously",
+					      0,
+					      NULL,
+					      NULL,
+					      test_bubble_icon_async,
+					      NULL));
+
+	g_test_suite_add (ts,
+			  g_test_create_case ("can load icons given as path",
+					      0,
+					      NULL,
+					      NULL,
+					      test_bubble_icon_path,
+					      NULL));
+
+	g_test_suite_add (ts,
+			  g_test_create_case ("keeps the source icon when resized",
+					      0,
+					      NULL,
+					      NULL,
+					      test_bubble_icon_keeps_source,
+					      NULL));
+
+	g_test_suite_add (ts,
+			  g_test_create_case ("can render offscreen",
+					      0,
+					      NULL,
+					      NULL,
+					      test_bubble_render_offscreen,
+					      NULL));
+
 	g_test_suite_add (ts,
 			  g_test_create_case ("can get bubble attributes",
 					      0,
@@ -31,12 +31,13 @@
 #include "stack.h"
 
 #define TEST_DBUS_NAME "org.freedesktop.Notificationstest"
+#define TEST_BATCH_PATH "/org/freedesktop/NotificationsBatchTest"
 
 static
 void
 test_dbus_instance (gpointer fixture, gconstpointer user_data)
 {
-	DBusGConnection* connection = NULL;
+	GDBusConnection* connection = NULL;
 
 	connection = dbus_create_service_instance (TEST_DBUS_NAME);
 	g_assert (connection != NULL);
@@ -46,17 +47,18 @@ static
 void
 test_dbus_collision (gpointer fixture, gconstpointer user_data)
 {
-	//DBusGConnection* connection = NULL;
+	//GDBusConnection* connection = NULL;
 
 	/* HACK: as we did not destroy the instance after the first test above,
-	   this second creation should fail */
+	   this second creation should fail, GDBus does not survive a fork(),
+	   so this needs a fresh process instead of g_test_trap_fork() */
 
-	if (g_test_trap_fork (0, G_TEST_TRAP_SILENCE_STDOUT |
-                               G_TEST_TRAP_SILENCE_STDERR))
-        {
+	if (g_test_subprocess ())
+	{
 		dbus_create_service_instance (TEST_DBUS_NAME);
 		exit (0); /* should never be triggered */
-        }
+	}
+	g_test_trap_subprocess (NULL, 0, 0);
 	g_test_trap_assert_failed();
 }
 
@@ -73,10 +75,14 @@ test_dbus_get_capabilities (gpointer fixture, gconstpointer user_data)
 	g_assert (!g_strcmp0 (caps[0], "body"));
 
 	int i = 0;
+	gboolean batch = FALSE;
 	while (caps[i] != NULL)
 	{
+		if (!g_strcmp0 (caps[i], "x-canonical-notify-batch"))
+			batch = TRUE;
 		g_assert (!g_strrstr (caps[i++], "actions"));
 	}
+	g_assert (batch);
 }
 
 static void
@@ -92,6 +98,176 @@ test_dbus_get_server_information (gpointer fixture, gconstpointer user_data)
 	g_assert (g_strrstr (specver, "1.1"));
 }
 
+static void
+add_entry (GVariantBuilder* batch,
+	   guint            replaces_id,
+	   const gchar*     summary,
+	   const gchar*     body,
+	   gboolean         append)
+{
+	GVariantBuilder hints;
+
+	// critical ones, so do-not-disturb can't drop them while we wait
+	g_variant_builder_init (&hints, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&hints, "{sv}", "urgency", g_variant_new_byte (2));
+	if (append)
+		g_variant_builder_add (&hints,
+				       "{sv}",
+				       "x-canonical-append",
+				       g_variant_new_string ("allowed"));
+
+	g_variant_builder_add (batch,
+			       "(susssasa{sv}i)",
+			       "test-dbus",
+			       replaces_id,
+			       "",
+			       summary,
+			       body,
+			       NULL,
+			       &hints,
+			       -1);
+}
+
+static void
+batch_done (GObject*      source,
+	    GAsyncResult* result,
+	    gpointer      user_data)
+{
+	GVariant** reply = (GVariant**) user_data;
+	GError*    error = NULL;
+
+	*reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+						result,
+						&error);
+	g_assert_no_error (error);
+}
+
+// the stack handles the call in this very process, so it can't be a
+// blocking one
+static GVariant*
+call_notify_batch (GDBusConnection* connection,
+		   GVariantBuilder* batch)
+{
+	GVariant* reply = NULL;
+	GVariant* ids;
+
+	g_dbus_connection_call (connection,
+				g_dbus_connection_get_unique_name (connection),
+				TEST_BATCH_PATH,
+				"org.freedesktop.Notifications",
+				"NotifyBatch",
+				g_variant_new ("(a(susssasa{sv}i))", batch),
+				G_VARIANT_TYPE ("(au)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				NULL,
+				batch_done,
+				&reply);
+
+	while (!reply)
+		g_main_context_iteration (NULL, TRUE);
+
+	ids = g_variant_get_child_value (reply, 0);
+	g_variant_unref (reply);
+
+	return ids;
+}
+
+static Bubble*
+find_bubble (Stack* stack,
+	     guint  id)
+{
+	GList* list;
+
+	for (list = stack->list; list != NULL; list = g_list_next (list))
+		if (bubble_get_id (BUBBLE (list->data)) == id)
+			return BUBBLE (list->data);
+
+	return NULL;
+}
+
+static void
+test_dbus_notify_batch (gpointer fixture, gconstpointer user_data)
+{
+	GDBusConnection* connection;
+	Defaults*        defaults;
+	Observer*        observer;
+	Stack*           stack;
+	GVariantBuilder  batch;
+	GVariant*        ids[3];
+	const guint32*   first;
+	const guint32*   second;
+	const guint32*   full;
+	gsize            n;
+	gsize            i;
+	const gchar*     body;
+	guint            length;
+	GError*          error = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	defaults = defaults_new ();
+	observer = observer_new ();
+	stack    = stack_new (defaults, observer);
+	g_assert (stack_export (stack, connection, TEST_BATCH_PATH, &error));
+	g_assert_no_error (error);
+
+	// one id per entry, in the order of the entries
+	g_variant_builder_init (&batch, G_VARIANT_TYPE ("a(susssasa{sv}i)"));
+	add_entry (&batch, 0, "One", "first", FALSE);
+	add_entry (&batch, 0, "Two", "second", FALSE);
+	add_entry (&batch, 0, "Chat", "Hi", TRUE);
+	ids[0] = call_notify_batch (connection, &batch);
+	first  = g_variant_get_fixed_array (ids[0], &n, sizeof (guint32));
+	g_assert_cmpuint (n, ==, 3);
+	g_assert_cmpuint (first[0], >, 0);
+	g_assert_cmpuint (first[1], >, first[0]);
+	g_assert_cmpuint (first[2], >, first[1]);
+	g_assert_cmpstr (bubble_get_title (find_bubble (stack, first[1])),
+			 ==,
+			 "Two");
+
+	// replaces_id and append work per entry, like with Notify
+	g_variant_builder_init (&batch, G_VARIANT_TYPE ("a(susssasa{sv}i)"));
+	add_entry (&batch, first[0], "One", "updated", FALSE);
+	add_entry (&batch, 0, "Chat", "there", TRUE);
+	add_entry (&batch, 0, "Three", "third", FALSE);
+	ids[1] = call_notify_batch (connection, &batch);
+	second = g_variant_get_fixed_array (ids[1], &n, sizeof (guint32));
+	g_assert_cmpuint (n, ==, 3);
+	g_assert_cmpuint (second[0], ==, first[0]);
+	g_assert_cmpuint (second[1], ==, first[2]);
+	g_assert_cmpuint (second[2], >, first[2]);
+	g_assert_cmpstr (bubble_get_message_body (find_bubble (stack, first[0])),
+			 ==,
+			 "updated");
+	body = bubble_get_message_body (find_bubble (stack, first[2]));
+	g_assert (g_str_has_prefix (body, "Hi"));
+	g_assert (g_str_has_suffix (body, "there"));
+
+	// entries over the stack-limit are refused with id 0, the others
+	// still get through
+	length = g_list_length (stack->list);
+	g_variant_builder_init (&batch, G_VARIANT_TYPE ("a(susssasa{sv}i)"));
+	for (i = 0; i < MAX_STACK_SIZE; i++)
+		add_entry (&batch, 0, "Flood", "more", FALSE);
+	ids[2] = call_notify_batch (connection, &batch);
+	full   = g_variant_get_fixed_array (ids[2], &n, sizeof (guint32));
+	g_assert_cmpuint (n, ==, MAX_STACK_SIZE);
+	for (i = 0; i < n; i++)
+		if (i <= MAX_STACK_SIZE - length)
+			g_assert_cmpuint (full[i], >, 0);
+		else
+			g_assert_cmpuint (full[i], ==, 0);
+	g_assert_cmpuint (full[n - 1], ==, 0);
+
+	for (i = 0; i < G_N_ELEMENTS (ids); i++)
+		g_variant_unref (ids[i]);
+	g_object_unref (stack);
+	g_object_unref (connection);
+}
+
 GTestSuite *
 test_dbus_create_test_suite (void)
 {
@@ -134,5 +310,14 @@ test_dbus_create_test_suite (void)
 					     (GTestFixtureFunc) test_dbus_get_server_information,
 					     NULL)
 		);
+
+	g_test_suite_add(ts,
+			 g_test_create_case ("can notify in batches",
+					     0,
+					     NULL,
+					     NULL,
+					     (GTestFixtureFunc) test_dbus_notify_batch,
+					     NULL)
+		);
 	return ts;
 }
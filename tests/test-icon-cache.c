@@ -0,0 +1,206 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-icon-cache.c - unit-tests for the shared icon-cache
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#include <time.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "icon-cache.h"
+
+extern gint ICON_CACHE_SIZE;
+
+static tile_t*
+create_tile (void)
+{
+	cairo_surface_t* surface;
+	tile_t*          tile;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 16, 16);
+	tile = tile_new (surface, 2);
+	cairo_surface_destroy (surface);
+
+	return tile;
+}
+
+static void
+test_icon_cache_hit_miss ()
+{
+	GdkPixbuf*     pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 8, 8);
+	tile_t*        tile   = create_tile ();
+	GdkPixbuf*     cached_pixbuf = NULL;
+	tile_t*        cached_tile   = NULL;
+	IconCacheStats stats;
+
+	icon_cache_clear ();
+	icon_cache_reset_stats ();
+
+	g_assert (!icon_cache_lookup ("firefox", 48, &cached_pixbuf, &cached_tile));
+
+	icon_cache_insert ("firefox", 48, pixbuf, tile);
+
+	// different pixel-size is a different entry
+	g_assert (!icon_cache_lookup ("firefox", 32, &cached_pixbuf, &cached_tile));
+	g_assert (icon_cache_lookup ("firefox", 48, &cached_pixbuf, &cached_tile));
+	g_assert (cached_pixbuf == pixbuf);
+	g_assert (cached_tile == tile);
+
+	icon_cache_get_stats (&stats);
+	g_assert_cmpuint (stats.hits, ==, 1);
+	g_assert_cmpuint (stats.misses, ==, 2);
+	g_assert_cmpuint (stats.size, ==, 1);
+
+	// references handed out have to survive clearing the cache
+	icon_cache_clear ();
+	g_object_unref (pixbuf);
+	tile_destroy (tile);
+	g_assert_cmpint (gdk_pixbuf_get_width (cached_pixbuf), ==, 8);
+
+	g_object_unref (cached_pixbuf);
+	tile_destroy (cached_tile);
+}
+
+static void
+test_icon_cache_eviction ()
+{
+	GdkPixbuf*     pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 8, 8);
+	tile_t*        tile   = create_tile ();
+	GdkPixbuf*     cached_pixbuf;
+	tile_t*        cached_tile;
+	IconCacheStats stats;
+	gint           old_size = ICON_CACHE_SIZE;
+
+	icon_cache_clear ();
+	icon_cache_reset_stats ();
+	ICON_CACHE_SIZE = 2;
+
+	icon_cache_insert ("one", 48, pixbuf, tile);
+	icon_cache_insert ("two", 48, pixbuf, tile);
+
+	// touch "one" so "two" becomes the least recently used entry
+	g_assert (icon_cache_lookup ("one", 48, &cached_pixbuf, &cached_tile));
+	g_object_unref (cached_pixbuf);
+	tile_destroy (cached_tile);
+
+	icon_cache_insert ("three", 48, pixbuf, tile);
+
+	g_assert (!icon_cache_lookup ("two", 48, &cached_pixbuf, &cached_tile));
+	g_assert (icon_cache_lookup ("one", 48, &cached_pixbuf, &cached_tile));
+	g_object_unref (cached_pixbuf);
+	tile_destroy (cached_tile);
+
+	icon_cache_get_stats (&stats);
+	g_assert_cmpuint (stats.evictions, ==, 1);
+	g_assert_cmpuint (stats.size, ==, 2);
+
+	icon_cache_clear ();
+	ICON_CACHE_SIZE = old_size;
+	g_object_unref (pixbuf);
+	tile_destroy (tile);
+}
+
+static void
+test_icon_cache_mtime ()
+{
+	GdkPixbuf*     pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 8, 8);
+	tile_t*        tile   = create_tile ();
+	GdkPixbuf*     cached_pixbuf;
+	tile_t*        cached_tile;
+	IconCacheStats stats;
+	gchar*         filename;
+	struct utimbuf times;
+	gint           fd;
+
+	icon_cache_clear ();
+	icon_cache_reset_stats ();
+
+	fd = g_file_open_tmp ("notify-osd-icon-XXXXXX", &filename, NULL);
+	g_assert (fd >= 0);
+	close (fd);
+
+	icon_cache_insert (filename, 48, pixbuf, tile);
+	g_assert (icon_cache_lookup (filename, 48, &cached_pixbuf, &cached_tile));
+	g_object_unref (cached_pixbuf);
+	tile_destroy (cached_tile);
+
+	// pretend an application rewrote the file
+	times.actime  = time (NULL) + 10;
+	times.modtime = time (NULL) + 10;
+	g_assert (utime (filename, &times) == 0);
+
+	g_assert (!icon_cache_lookup (filename, 48, &cached_pixbuf, &cached_tile));
+
+	icon_cache_get_stats (&stats);
+	g_assert_cmpuint (stats.invalidations, ==, 1);
+	g_assert_cmpuint (stats.size, ==, 0);
+
+	g_unlink (filename);
+	g_free (filename);
+	g_object_unref (pixbuf);
+	tile_destroy (tile);
+}
+
+static void
+test_icon_cache_theme_changed ()
+{
+	GdkPixbuf*     pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 8, 8);
+	tile_t*        tile   = create_tile ();
+	GdkPixbuf*     cached_pixbuf;
+	tile_t*        cached_tile;
+	IconCacheStats stats;
+
+	icon_cache_clear ();
+	icon_cache_reset_stats ();
+
+	icon_cache_insert ("firefox", 48, pixbuf, tile);
+	g_signal_emit_by_name (gtk_icon_theme_get_default (), "changed");
+	g_assert (!icon_cache_lookup ("firefox", 48, &cached_pixbuf, &cached_tile));
+
+	icon_cache_get_stats (&stats);
+	g_assert_cmpuint (stats.invalidations, ==, 1);
+
+	g_object_unref (pixbuf);
+	tile_destroy (tile);
+}
+
+GTestSuite *
+test_icon_cache_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("icon-cache");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_icon_cache_hit_miss));
+	g_test_suite_add(ts, TC(test_icon_cache_eviction));
+	g_test_suite_add(ts, TC(test_icon_cache_mtime));
+	g_test_suite_add(ts, TC(test_icon_cache_theme_changed));
+
+	return ts;
+}
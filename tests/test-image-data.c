@@ -0,0 +1,166 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-image-data.c - unit-tests for the image_data to surface conversion
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "util.h"
+
+static guint32
+get_pixel (cairo_surface_t* surface,
+	   gint             x,
+	   gint             y)
+{
+	guchar* data   = cairo_image_surface_get_data (surface);
+	gint    stride = cairo_image_surface_get_stride (surface);
+
+	return ((guint32*) (data + y * stride))[x];
+}
+
+static void
+test_image_data_downscale ()
+{
+	cairo_surface_t* surface;
+	guchar*          pixels;
+	gint             x;
+	gint             y;
+
+	// 64x64 RGBA, left half opaque red, right half fully transparent
+	pixels = g_malloc0 (64 * 64 * 4);
+	for (y = 0; y < 64; y++)
+		for (x = 0; x < 32; x++)
+		{
+			pixels[y * 256 + x * 4 + 0] = 0xff;
+			pixels[y * 256 + x * 4 + 3] = 0xff;
+		}
+
+	surface = image_data_to_surface (64, 64, 256, TRUE, 8, 4,
+					 pixels, 64 * 64 * 4, 16, 2);
+	g_assert (surface != NULL);
+	g_assert_cmpint (cairo_image_surface_get_width (surface), ==, 20);
+	g_assert_cmpint (cairo_image_surface_get_height (surface), ==, 20);
+
+	// padding stays transparent
+	g_assert_cmphex (get_pixel (surface, 0, 0), ==, 0x00000000);
+	g_assert_cmphex (get_pixel (surface, 2, 2), ==, 0xffff0000);
+	g_assert_cmphex (get_pixel (surface, 17, 17), ==, 0x00000000);
+
+	cairo_surface_destroy (surface);
+
+	// averaging happens on premultiplied pixels, 2:1 across the edge
+	surface = image_data_to_surface (64, 64, 256, TRUE, 8, 4,
+					 pixels, 64 * 64 * 4, 1, 0);
+	g_assert (surface != NULL);
+	g_assert_cmphex (get_pixel (surface, 0, 0), ==, 0x80800000);
+
+	cairo_surface_destroy (surface);
+	g_free (pixels);
+}
+
+static void
+test_image_data_centered ()
+{
+	cairo_surface_t* surface;
+	guchar*          pixels;
+	gint             i;
+
+	// 40x20 opaque RGB with a padded rowstride
+	pixels = g_malloc0 (20 * 128);
+	for (i = 0; i < 20 * 128; i += 1)
+		pixels[i] = 0x40;
+
+	surface = image_data_to_surface (40, 20, 128, FALSE, 8, 3,
+					 pixels, 20 * 128, 20, 0);
+	g_assert (surface != NULL);
+
+	// scaled to 20x10 and centered vertically
+	g_assert_cmphex (get_pixel (surface, 10, 4), ==, 0x00000000);
+	g_assert_cmphex (get_pixel (surface, 0, 5), ==, 0xff404040);
+	g_assert_cmphex (get_pixel (surface, 19, 14), ==, 0xff404040);
+	g_assert_cmphex (get_pixel (surface, 10, 15), ==, 0x00000000);
+
+	cairo_surface_destroy (surface);
+	g_free (pixels);
+}
+
+static void
+test_image_data_upscale ()
+{
+	cairo_surface_t* surface;
+	guchar           pixels[2 * 2 * 4];
+	gint             i;
+
+	for (i = 0; i < 2 * 2 * 4; i++)
+		pixels[i] = 0xff;
+
+	surface = image_data_to_surface (2, 2, 8, TRUE, 8, 4,
+					 pixels, sizeof (pixels), 8, 0);
+	g_assert (surface != NULL);
+	cairo_surface_flush (surface);
+	g_assert_cmphex (get_pixel (surface, 4, 4), ==, 0xffffffff);
+
+	cairo_surface_destroy (surface);
+}
+
+static void
+test_image_data_malformed ()
+{
+	guchar pixels[16 * 16 * 4] = { 0 };
+
+	// short pixel-array
+	g_assert (!image_data_to_surface (16, 16, 64, TRUE, 8, 4,
+					  pixels, 16 * 15 * 4, 8, 0));
+
+	// rowstride smaller than a row
+	g_assert (!image_data_to_surface (16, 16, 32, TRUE, 8, 4,
+					  pixels, sizeof (pixels), 8, 0));
+
+	// alpha-flag not matching the number of channels
+	g_assert (!image_data_to_surface (16, 16, 64, FALSE, 8, 4,
+					  pixels, sizeof (pixels), 8, 0));
+
+	// only 8 bits per sample are supported
+	g_assert (!image_data_to_surface (8, 16, 64, TRUE, 16, 4,
+					  pixels, sizeof (pixels), 8, 0));
+
+	g_assert (!image_data_to_surface (0, 16, 64, TRUE, 8, 4,
+					  pixels, sizeof (pixels), 8, 0));
+}
+
+GTestSuite *
+test_image_data_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("image-data");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_image_data_downscale));
+	g_test_suite_add(ts, TC(test_image_data_centered));
+	g_test_suite_add(ts, TC(test_image_data_upscale));
+	g_test_suite_add(ts, TC(test_image_data_malformed));
+
+	return ts;
+}
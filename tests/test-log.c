@@ -0,0 +1,114 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-log.c - unit-tests for the asynchronous notification-log
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "defaults.h"
+#include "bubble.h"
+#include "log.h"
+
+extern gint LOG_MAX_SIZE;
+extern gint LOG_MAX_FILES;
+
+static void
+test_log_write_and_rotate ()
+{
+	Defaults* defaults;
+	Bubble*   bubble;
+	gchar*    dirname;
+	gchar*    filename;
+	gchar*    rotated;
+	gchar*    contents;
+	gint      old_size  = LOG_MAX_SIZE;
+	gint      old_files = LOG_MAX_FILES;
+	gint      i;
+
+	dirname  = g_dir_make_tmp ("notify-osd-log-XXXXXX", NULL);
+	g_assert (dirname != NULL);
+	filename = g_build_filename (dirname, "notify-osd.log", NULL);
+	rotated  = g_strconcat (filename, ".1", NULL);
+
+	defaults = defaults_new ();
+	bubble   = bubble_new (defaults);
+	bubble_set_title (bubble, "Title");
+	bubble_set_message_body (bubble, "Body");
+
+	g_assert (log_open (filename));
+	log_bubble (bubble, "test-log", "replaced");
+	log_close ();
+
+	// everything is written once the log is closed
+	g_assert (g_file_get_contents (filename, &contents, NULL, NULL));
+	g_assert (strstr (contents, ", test-log replaced] Title\nBody\n\n"));
+	g_free (contents);
+
+	// the log is appended to, and rotated once it gets too large
+	LOG_MAX_SIZE  = 256;
+	LOG_MAX_FILES = 1;
+
+	for (i = 0; i < 8; i++)
+	{
+		g_assert (log_open (filename));
+		log_bubble (bubble, "test-log", NULL);
+		log_close ();
+	}
+
+	g_assert (g_file_test (rotated, G_FILE_TEST_EXISTS));
+	g_assert (g_file_get_contents (filename, &contents, NULL, NULL));
+	g_assert_cmpint (strlen (contents), <=, LOG_MAX_SIZE);
+	g_free (contents);
+
+	g_assert_cmpuint (log_get_dropped (), ==, 0);
+
+	LOG_MAX_SIZE  = old_size;
+	LOG_MAX_FILES = old_files;
+
+	g_unlink (rotated);
+	g_unlink (filename);
+	g_rmdir (dirname);
+	g_free (rotated);
+	g_free (filename);
+	g_free (dirname);
+	g_object_unref (bubble);
+	g_object_unref (defaults);
+}
+
+GTestSuite *
+test_log_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("log");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_log_write_and_rotate));
+
+	return ts;
+}
@@ -45,6 +45,15 @@ GTestSuite *test_synchronous_create_test_suite (void);
 GTestSuite *test_dnd_create_test_suite (void);
 GTestSuite *test_filtering_create_test_suite (void);
 GTestSuite *test_timings_create_test_suite (void);
+GTestSuite *test_icon_cache_create_test_suite (void);
+GTestSuite *test_image_data_create_test_suite (void);
+GTestSuite *test_stats_create_test_suite (void);
+GTestSuite *test_rate_limit_create_test_suite (void);
+GTestSuite *test_trace_create_test_suite (void);
+GTestSuite *test_log_create_test_suite (void);
+GTestSuite *test_animation_create_test_suite (void);
+GTestSuite *test_backlog_create_test_suite (void);
+GTestSuite *test_timer_wheel_create_test_suite (void);
 
 int
 main (int    argc,
@@ -72,6 +81,15 @@ main (int    argc,
 	g_test_suite_add_suite (suite, test_synchronous_create_test_suite ());
 	g_test_suite_add_suite (suite, test_dnd_create_test_suite ());
 	g_test_suite_add_suite (suite, test_timings_create_test_suite ());
+	g_test_suite_add_suite (suite, test_icon_cache_create_test_suite ());
+	g_test_suite_add_suite (suite, test_image_data_create_test_suite ());
+	g_test_suite_add_suite (suite, test_stats_create_test_suite ());
+	g_test_suite_add_suite (suite, test_rate_limit_create_test_suite ());
+	g_test_suite_add_suite (suite, test_trace_create_test_suite ());
+	g_test_suite_add_suite (suite, test_log_create_test_suite ());
+	g_test_suite_add_suite (suite, test_animation_create_test_suite ());
+	g_test_suite_add_suite (suite, test_backlog_create_test_suite ());
+	g_test_suite_add_suite (suite, test_timer_wheel_create_test_suite ());
 
 	result = g_test_run ();
 
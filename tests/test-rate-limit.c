@@ -0,0 +1,144 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-rate-limit.c - unit-tests for per-sender rate-limiting/coalescing
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "rate-limit.h"
+
+extern gint RATE_LIMIT_BURST;
+extern gint RATE_LIMIT_RATE;
+extern gint RATE_LIMIT_COALESCE_WINDOW;
+
+static void
+test_rate_limit_token_bucket ()
+{
+	RateLimit* rl        = rate_limit_new ();
+	gint       old_burst = RATE_LIMIT_BURST;
+	gint       old_rate  = RATE_LIMIT_RATE;
+	gint64     now       = 1000 * G_USEC_PER_SEC;
+	guint      dropped;
+	guint      coalesced;
+	gint       i;
+
+	RATE_LIMIT_BURST = 3;
+	RATE_LIMIT_RATE  = 2;
+
+	for (i = 0; i < 3; i++)
+		g_assert (rate_limit_take_token (rl, ":1.1", now));
+	g_assert (!rate_limit_take_token (rl, ":1.1", now));
+
+	// buckets are per sender
+	g_assert (rate_limit_take_token (rl, ":1.2", now));
+
+	// two tokens per second come back, but never more than the burst
+	g_assert (rate_limit_take_token (rl, ":1.1", now + G_USEC_PER_SEC / 2));
+	g_assert (!rate_limit_take_token (rl, ":1.1", now + G_USEC_PER_SEC / 2));
+	now += 60 * G_USEC_PER_SEC;
+	for (i = 0; i < 3; i++)
+		g_assert (rate_limit_take_token (rl, ":1.1", now));
+	g_assert (!rate_limit_take_token (rl, ":1.1", now));
+
+	rate_limit_get_sender_stats (rl, ":1.1", &dropped, &coalesced);
+	g_assert_cmpuint (dropped, ==, 3);
+	g_assert_cmpuint (coalesced, ==, 0);
+
+	rate_limit_get_sender_stats (rl, ":1.2", &dropped, NULL);
+	g_assert_cmpuint (dropped, ==, 0);
+
+	// idle senders are forgotten, stats and all
+	g_assert (rate_limit_take_token (rl, ":1.3", now + 11 * 60 * G_USEC_PER_SEC));
+	rate_limit_get_sender_stats (rl, ":1.1", &dropped, NULL);
+	g_assert_cmpuint (dropped, ==, 0);
+
+	// 0 disables the bucket
+	RATE_LIMIT_BURST = 0;
+	g_assert (rate_limit_take_token (rl, ":1.1", now));
+
+	RATE_LIMIT_BURST = old_burst;
+	RATE_LIMIT_RATE  = old_rate;
+	rate_limit_free (rl);
+}
+
+static void
+test_rate_limit_coalesce ()
+{
+	RateLimit* rl         = rate_limit_new ();
+	gint       old_window = RATE_LIMIT_COALESCE_WINDOW;
+	gint64     now        = 1000 * G_USEC_PER_SEC;
+	guint      repeat     = 0;
+	guint      coalesced;
+
+	RATE_LIMIT_COALESCE_WINDOW = 1000;
+
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Hi", now), ==, 0);
+	g_assert_cmpuint (rate_limit_coalesce (rl, ":1.1", "Mail", "Hi", now), ==, 0);
+	rate_limit_remember (rl, ":1.1", "Mail", "Hi", 7, now);
+
+	// finding it doesn't count it as coalesced yet
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Hi", now + 500000), ==, 7);
+	rate_limit_get_sender_stats (rl, ":1.1", NULL, &coalesced);
+	g_assert_cmpuint (coalesced, ==, 0);
+
+	repeat = rate_limit_coalesce (rl, ":1.1", "Mail", "Hi", now + 500000);
+	g_assert_cmpuint (repeat, ==, 2);
+
+	// the window restarts with each repetition
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Hi", now + 1400000), ==, 7);
+	repeat = rate_limit_coalesce (rl, ":1.1", "Mail", "Hi", now + 1400000);
+	g_assert_cmpuint (repeat, ==, 3);
+
+	// other senders or content do not match
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.2", "Mail", "Hi", now + 1400000), ==, 0);
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Ho", now + 1400000), ==, 0);
+
+	// ...nor anything older than the window
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Hi", now + 2500000), ==, 0);
+
+	// forgotten ids are not coalesced with
+	rate_limit_remember (rl, ":1.1", "Mail", "Hi", 8, now);
+	rate_limit_forget (rl, ":1.1", 8);
+	g_assert_cmpuint (rate_limit_find_recent (rl, ":1.1", "Mail", "Hi", now), ==, 0);
+	g_assert_cmpuint (rate_limit_coalesce (rl, ":1.1", "Mail", "Hi", now), ==, 0);
+
+	rate_limit_get_sender_stats (rl, ":1.1", NULL, &coalesced);
+	g_assert_cmpuint (coalesced, ==, 2);
+
+	RATE_LIMIT_COALESCE_WINDOW = old_window;
+	rate_limit_free (rl);
+}
+
+GTestSuite *
+test_rate_limit_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("rate-limit");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_rate_limit_token_bucket));
+	g_test_suite_add(ts, TC(test_rate_limit_coalesce));
+
+	return ts;
+}
@@ -32,6 +32,8 @@
 #include "defaults.h"
 #include "bubble.h"
 
+extern gint STACK_SLOTS;
+
 static
 void
 test_stack_new ()
@@ -184,6 +186,70 @@ test_stack_slots ()
 	g_object_unref (G_OBJECT (stack));
 }
 
+static void
+test_stack_n_slots ()
+{
+	Stack*    stack    = NULL;
+	Defaults* defaults = defaults_new ();
+	Observer* observer = observer_new ();
+	Bubble*   bubbles[3];
+	gint      old_slots = STACK_SLOTS;
+	gint      x;
+	gint      y[4];
+	gint      i;
+
+	// out-of-range settings are clamped
+	STACK_SLOTS = 1;
+	stack = stack_new (defaults, observer);
+	g_assert_cmpuint (stack_get_n_slots (stack), ==, 2);
+	g_object_unref (G_OBJECT (stack));
+
+	STACK_SLOTS = 4;
+	stack = stack_new (defaults, observer);
+	g_assert_cmpuint (stack_get_n_slots (stack), ==, 4);
+	g_assert_cmpint (stack_is_slot_vacant (stack, 3), ==, VACANT);
+	g_assert_cmpint (stack_is_slot_vacant (stack, 4), ==, FALSE);
+
+	// async. bubbles fill the slots in order, but leave one for a sync. one
+	for (i = 0; i < 3; i++)
+	{
+		bubbles[i] = bubble_new (defaults);
+		bubble_set_title (bubbles[i], "Slot");
+		bubble_set_message_body (bubbles[i], "Stacked below the others");
+		bubble_recalc_size (bubbles[i]);
+		g_assert_cmpint (stack_find_vacant_slot (stack, FALSE), ==, i);
+		g_assert (stack_allocate_slot (stack, bubbles[i], i));
+	}
+	g_assert_cmpint (stack_find_vacant_slot (stack, FALSE), ==, SLOT_NONE);
+	g_assert_cmpint (stack_find_vacant_slot (stack, TRUE), ==, 3);
+
+	// every slot makes room for the bubble in the one before it, the vacant
+	// one is asked for with a bubble just as high as the others
+	for (i = 0; i < 4; i++)
+	{
+		stack_get_slot_position (stack,
+					 i,
+					 bubble_get_height (bubbles[MIN (i, 2)]),
+					 &x,
+					 &y[i]);
+		g_assert_cmpint (y[i], >, -1);
+	}
+	for (i = 1; i < 4; i++)
+		g_assert_cmpint (ABS (y[i] - y[i - 1]),
+				 >,
+				 bubble_get_height (bubbles[i - 1]) / 2);
+
+	for (i = 2; i >= 0; i--)
+	{
+		g_assert (stack_free_slot (stack, bubbles[i]));
+		g_object_unref (bubbles[i]);
+	}
+	g_assert_cmpint (stack_find_vacant_slot (stack, FALSE), ==, SLOT_TOP);
+
+	g_object_unref (G_OBJECT (stack));
+	STACK_SLOTS = old_slots;
+}
+
 GTestSuite *
 test_stack_create_test_suite (void)
 {
@@ -197,6 +263,7 @@ test_stack_create_test_suite (void)
 	g_test_suite_add(ts, TC(test_stack_del));
 	g_test_suite_add(ts, TC(test_stack_push));
 	g_test_suite_add(ts, TC(test_stack_slots));
+	g_test_suite_add(ts, TC(test_stack_n_slots));
 
 	return ts;
 }
@@ -0,0 +1,137 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-stats.c - unit-tests for the latency counters
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <glib.h>
+
+#include "stats.h"
+
+static void
+test_stats_samples ()
+{
+	StatsSample sample;
+
+	stats_reset ();
+
+	stats_add_sample (STATS_REPLY_LATENCY, 100);
+	stats_add_sample (STATS_REPLY_LATENCY, 300);
+	stats_add_sample (STATS_FIRST_FRAME, 5000);
+
+	// bogus samples are ignored
+	stats_add_sample (STATS_REPLY_LATENCY, -1);
+	stats_add_sample (STATS_LAST, 1);
+
+	stats_get (STATS_REPLY_LATENCY, &sample);
+	g_assert_cmpuint (sample.count, ==, 2);
+	g_assert_cmpint (sample.total, ==, 400);
+	g_assert_cmpint (sample.max, ==, 300);
+
+	stats_get (STATS_FIRST_FRAME, &sample);
+	g_assert_cmpuint (sample.count, ==, 1);
+	g_assert_cmpint (sample.max, ==, 5000);
+
+	stats_reset ();
+	stats_get (STATS_REPLY_LATENCY, &sample);
+	g_assert_cmpuint (sample.count, ==, 0);
+	g_assert_cmpint (sample.max, ==, 0);
+}
+
+static void
+test_stats_histogram ()
+{
+	StatsSample sample;
+	gint        i;
+
+	stats_reset ();
+
+	// 90 fast samples, 10 slow ones
+	for (i = 0; i < 90; i++)
+		stats_add_sample (STATS_FRAME_RENDER, 100);
+	for (i = 0; i < 10; i++)
+		stats_add_sample (STATS_FRAME_RENDER, 20000);
+
+	stats_get (STATS_FRAME_RENDER, &sample);
+	g_assert_cmpuint (sample.count, ==, 100);
+
+	// buckets are at most 1/8 wide
+	g_assert_cmpint (stats_get_percentile (&sample, 0.5), <=, 100);
+	g_assert_cmpint (stats_get_percentile (&sample, 0.5), >, 100 - 100 / 8);
+	g_assert_cmpint (stats_get_percentile (&sample, 0.99), <=, 20000);
+	g_assert_cmpint (stats_get_percentile (&sample, 0.99), >, 20000 - 20000 / 8);
+	g_assert_cmpint (stats_get_percentile (&sample, 1.0), ==, 20000);
+
+	// small values are exact, the buckets are contiguous
+	g_assert_cmpint (stats_get_bucket_start (0), ==, 0);
+	g_assert_cmpint (stats_get_bucket_start (5), ==, 5);
+	for (i = 1; i < STATS_N_BUCKETS; i++)
+		g_assert_cmpint (stats_get_bucket_start (i), >,
+				 stats_get_bucket_start (i - 1));
+	g_assert_cmpint (stats_get_bucket_start (STATS_N_BUCKETS), ==, -1);
+
+	// huge samples are clamped into the last bucket
+	stats_add_sample (STATS_TILE_ICON, G_MAXINT64);
+	stats_get (STATS_TILE_ICON, &sample);
+	g_assert_cmpuint (sample.buckets[STATS_N_BUCKETS - 1], ==, 1);
+
+	stats_reset ();
+	stats_get (STATS_FRAME_RENDER, &sample);
+	g_assert_cmpint (stats_get_percentile (&sample, 0.5), ==, 0);
+}
+
+static void
+test_stats_events ()
+{
+	guint received = stats_get_count (STATS_RECEIVED);
+	guint rejected = stats_get_count (STATS_REJECTED);
+
+	stats_count (STATS_RECEIVED);
+	stats_count (STATS_RECEIVED);
+	stats_count (STATS_REJECTED);
+	stats_count (STATS_EVENT_LAST);
+
+	g_assert_cmpuint (stats_get_count (STATS_RECEIVED), ==, received + 2);
+	g_assert_cmpuint (stats_get_count (STATS_REJECTED), ==, rejected + 1);
+	g_assert_cmpstr (stats_get_event_name (STATS_DROPPED_DND), ==, "dropped-dnd");
+	g_assert_cmpstr (stats_get_name (STATS_FIRST_FRAME), ==, "first-frame");
+
+	// only the histograms are reset
+	stats_reset ();
+	g_assert_cmpuint (stats_get_count (STATS_RECEIVED), ==, received + 2);
+}
+
+GTestSuite *
+test_stats_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("stats");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_stats_samples));
+	g_test_suite_add(ts, TC(test_stats_histogram));
+	g_test_suite_add(ts, TC(test_stats_events));
+
+	return ts;
+}
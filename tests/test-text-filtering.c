@@ -25,10 +25,120 @@
 **
 *******************************************************************************/
 
+#include <string.h>
 #include <glib.h>
 
 #include "util.h"
 
+// the regex-chain notify-osd used to filter text with, the reference the
+// single-pass filter_text() and newline_to_space() are compared against
+
+#define CHARACTER_LT_REGEX            "&(lt;|#60;|#x3c;)"
+#define CHARACTER_GT_REGEX            "&(gt;|#62;|#x3e;)"
+#define CHARACTER_AMP_REGEX           "&(amp;|#38;|#x26;)"
+#define CHARACTER_APOS_REGEX          "&apos;"
+#define CHARACTER_QUOT_REGEX          "&quot;"
+#define CHARACTER_NEWLINE_REGEX       " *((<br[^/>]*/?>|\r|\n)+ *)+"
+
+#define TAG_MATCH_REGEX     "<(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)\\b[^>]*>(.*?)</\\1>|<(img|span|a)[^>]/>|<(img)[^>]*>"
+#define TAG_REPLACE_REGEX   "<(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)\\b[^>]*>|</(b|i|u|big|a|img|span|s|sub|small|tt|html|qt)>"
+
+struct _ReplaceMarkupData
+{
+	gchar* regex;
+	gchar* replacement;
+};
+
+typedef struct _ReplaceMarkupData ReplaceMarkupData;
+
+static gchar*
+strip_html (const gchar *text, const gchar *match_regex, const gchar* replace_regex)
+{
+	GRegex   *regex;
+	gchar    *ret;
+	gboolean  match = FALSE;
+	GMatchInfo *info = NULL;
+
+	regex = g_regex_new (match_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
+	match = g_regex_match (regex, text, 0, &info);
+	g_regex_unref (regex);
+
+	if (match) {
+		regex = g_regex_new (replace_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
+		ret = g_regex_replace (regex, text, -1, 0, "", 0, NULL);
+		g_regex_unref (regex);
+	} else {
+		ret = g_strdup (text);
+	}
+
+	if (info)
+		g_match_info_free (info);
+
+	return ret;
+}
+
+static gchar*
+replace_markup (const gchar *text, const gchar *match_regex, const gchar *replace_text)
+{
+	GRegex *regex;
+	gchar  *ret;
+
+	regex = g_regex_new (match_regex, G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
+	ret = g_regex_replace (regex, text, -1, 0, replace_text, 0, NULL);
+	g_regex_unref (regex);
+
+	return ret;
+}
+
+static gchar*
+filter_text_regex (const gchar *text)
+{
+	gchar *text1;
+
+	text1 = strip_html (text, TAG_MATCH_REGEX, TAG_REPLACE_REGEX);
+
+	static ReplaceMarkupData data[] = {
+		{ CHARACTER_AMP_REGEX, "&" },
+		{ CHARACTER_LT_REGEX, "<" },
+		{ CHARACTER_GT_REGEX, ">" },
+		{ CHARACTER_APOS_REGEX, "'" },
+		{ CHARACTER_QUOT_REGEX, "\"" },
+		{ CHARACTER_NEWLINE_REGEX, "\n" }
+		};
+
+	ReplaceMarkupData* ptr = data;
+	ReplaceMarkupData* end = data + sizeof(data) / sizeof(ReplaceMarkupData);
+	for (; ptr != end; ++ptr) {
+		gchar* tmp = replace_markup (text1, ptr->regex, ptr->replacement);
+		g_free (text1);
+		text1 = tmp;
+	}
+
+	return text1;
+}
+
+static gchar*
+newline_to_space_regex (const gchar *text)
+{
+	gchar *text1;
+
+	text1 = strip_html (text, TAG_MATCH_REGEX, TAG_REPLACE_REGEX);
+
+	static ReplaceMarkupData data[] = {
+		{ CHARACTER_NEWLINE_REGEX, " " }
+		};
+
+	ReplaceMarkupData* ptr = data;
+	ReplaceMarkupData* end = data + sizeof(data) / sizeof(ReplaceMarkupData);
+	for (; ptr != end; ++ptr) {
+		gchar* tmp = replace_markup (text1, ptr->regex, ptr->replacement);
+		g_free (text1);
+		text1 = tmp;
+	}
+
+	return text1;
+}
+
 typedef struct {
 	const gchar *before;
 	const gchar *expected;
@@ -39,49 +149,49 @@ typedef struct {
 	guint        expected;
 } IntegerExtraction;
 
+static const TextComparisons filter_tests[] = {
+	{ "<a href=\"http://www.ubuntu.com/\">Ubuntu</a>", "Ubuntu"                                  },
+	{ "Don't rock the boat",                           "Don't rock the boat"                     },
+	{ "Kick him while he&apos;s down",                 "Kick him while he's down"                },
+	{ "\"Film spectators are quiet vampires.\"",       "\"Film spectators are quiet vampires.\"" },
+	{ "Peace &amp; Love",                              "Peace & Love"                            },
+	{ "War & Peace",                                   "War & Peace"                             },
+	{ "Law &#38; Order",                               "Law & Order"                             },
+	{ "Love &#x26; War",                               "Love & War"                              },
+	{ "7 > 3",                                         "7 > 3"                                   },
+	{ "7 &gt; 3",                                      "7 > 3"                                   },
+	{ "7 &#62; 3",                                     "7 > 3"                                   },
+	{ "7 &#x3e; 3",                                    "7 > 3"                                   },
+	{ "14 < 42",                                       "14 < 42"                                 },
+	{ "14 &lt; 42",                                    "14 < 42"                                 },
+	{ "14 &#60; 42",                                   "14 < 42"                                 },
+	{ "14 &#x3c; 42",                                  "14 < 42"                                 },
+	{ "><",                                            "><"                                      },
+	{ "<>",                                            "<>"                                      },
+	{ "< this is not a tag >",                         "< this is not a tag >"                   },
+	{ "<i>Not italic</i>",                             "Not italic"                              },
+	{ "<b>So broken</i>",                              "<b>So broken</i>"                        },
+	{ "<img src=\"foobar.png\" />Nothing to see",      "Nothing to see"                          },
+	{ "<u>Test</u>",                                   "Test"                                    },
+	{ "<b>Bold</b>",                                   "Bold"                                    },
+	{ "<span>Span</span>",                             "Span"                                    },
+	{ "<s>E-flat</s>",                                 "E-flat"                                  },
+	{ "<sub>Sandwich</sub>",                           "Sandwich",                               },
+	{ "<small>Fry</small>",                            "Fry"                                     },
+	{ "<tt>Testing tag</tt>",                          "Testing tag"                             },
+	{ "<html>Surrounded by html</html>",               "Surrounded by html"                      },
+	{ "<qt>Surrounded by qt</qt>",                     "Surrounded by qt"                        },
+	{ "First line  <br dumb> \r \n Second line",       "First line\nSecond line"                  },
+	{ "First line\n<br /> <br>\n2nd line\r\n3rd line", "First line\n2nd line\n3rd line"            },
+	{ NULL, NULL }
+};
+
 static void
 test_text_filter ()
 {
-	static const TextComparisons tests[] = {
-		{ "<a href=\"http://www.ubuntu.com/\">Ubuntu</a>", "Ubuntu"                                  },
-		{ "Don't rock the boat",                           "Don't rock the boat"                     },
-		{ "Kick him while he&apos;s down",                 "Kick him while he's down"                },
-		{ "\"Film spectators are quiet vampires.\"",       "\"Film spectators are quiet vampires.\"" },
-		{ "Peace &amp; Love",                              "Peace & Love"                            },
-		{ "War & Peace",                                   "War & Peace"                             },
-		{ "Law &#38; Order",                               "Law & Order"                             },
-		{ "Love &#x26; War",                               "Love & War"                              },
-		{ "7 > 3",                                         "7 > 3"                                   },
-		{ "7 &gt; 3",                                      "7 > 3"                                   },
-		{ "7 &#62; 3",                                     "7 > 3"                                   },
-		{ "7 &#x3e; 3",                                    "7 > 3"                                   },
-		{ "14 < 42",                                       "14 < 42"                                 },
-		{ "14 &lt; 42",                                    "14 < 42"                                 },
-		{ "14 &#60; 42",                                   "14 < 42"                                 },
-		{ "14 &#x3c; 42",                                  "14 < 42"                                 },
-		{ "><",                                            "><"                                      },
-		{ "<>",                                            "<>"                                      },
-		{ "< this is not a tag >",                         "< this is not a tag >"                   },
-		{ "<i>Not italic</i>",                             "Not italic"                              },
-		{ "<b>So broken</i>",                              "<b>So broken</i>"                        },
-		{ "<img src=\"foobar.png\" />Nothing to see",      "Nothing to see"                          },
-		{ "<u>Test</u>",                                   "Test"                                    },
-		{ "<b>Bold</b>",                                   "Bold"                                    },
-		{ "<span>Span</span>",                             "Span"                                    },
-		{ "<s>E-flat</s>",                                 "E-flat"                                  },
-		{ "<sub>Sandwich</sub>",                           "Sandwich",                               },
-		{ "<small>Fry</small>",                            "Fry"                                     },
-		{ "<tt>Testing tag</tt>",                          "Testing tag"                             },
-		{ "<html>Surrounded by html</html>",               "Surrounded by html"                      },
-		{ "<qt>Surrounded by qt</qt>",                     "Surrounded by qt"                        },
-		{ "First line  <br dumb> \r \n Second line",       "First line\nSecond line"                  },
-		{ "First line\n<br /> <br>\n2nd line\r\n3rd line", "First line\n2nd line\n3rd line"            },
-		{ NULL, NULL }
-	};
-
-	for (int i = 0; tests[i].before != NULL; i++) {
-		char *filtered = filter_text (tests[i].before);
-		g_assert_cmpstr (filtered, ==, tests[i].expected);
+	for (int i = 0; filter_tests[i].before != NULL; i++) {
+		char *filtered = filter_text (filter_tests[i].before);
+		g_assert_cmpstr (filtered, ==, filter_tests[i].expected);
 		g_free (filtered);
 	}
 }
@@ -102,6 +212,112 @@ test_newline_to_space ()
 	}
 }
 
+// corner cases in which the old regex-chain behaves a bit oddly, the
+// single-pass filter has to do exactly the same
+static const gchar* differential_tests[] = {
+	"&amp;lt;b&amp;gt;",
+	"&amp;amp;lt;",
+	"&lt;br&gt;",
+	"&amp;quot;&amp;apos;&amp;#60;",
+	"<br<x> x",
+	"<brown> fox",
+	"<br/x>",
+	"<br\n>",
+	"a  <b>  <br>  b",
+	"a \n <br/> \r\n <br / > b",
+	"<b>bold <i>unclosed</b>",
+	"<bé>no tag</b>",
+	"<b-x>tag</b>",
+	"</b><b>",
+	"<a x/>",
+	"<a/>",
+	"<span/>",
+	"<span //>",
+	"<img",
+	"<img>",
+	"<b>no close",
+	"<b <i>>x</b>",
+	"trailing blanks \n  ",
+	"  \n leading blanks",
+	"&&&amp;&amp",
+	"",
+	NULL
+};
+
+static void
+test_text_filter_differential ()
+{
+	const gchar* texts[G_N_ELEMENTS (filter_tests) +
+			   G_N_ELEMENTS (differential_tests)];
+	guint        n = 0;
+
+	for (int i = 0; filter_tests[i].before != NULL; i++)
+		texts[n++] = filter_tests[i].before;
+	for (int i = 0; differential_tests[i] != NULL; i++)
+		texts[n++] = differential_tests[i];
+
+	for (guint i = 0; i < n; i++) {
+		gchar* fast = filter_text (texts[i]);
+		gchar* slow = filter_text_regex (texts[i]);
+		g_assert_cmpstr (fast, ==, slow);
+		g_free (fast);
+		g_free (slow);
+
+		fast = newline_to_space (texts[i]);
+		slow = newline_to_space_regex (texts[i]);
+		g_assert_cmpstr (fast, ==, slow);
+		g_free (fast);
+		g_free (slow);
+	}
+}
+
+static gdouble
+filter_throughput (gchar*       (*filter) (const gchar*),
+		   const gchar* text,
+		   guint        rounds)
+{
+	GTimer* timer = g_timer_new ();
+	gdouble seconds;
+
+	for (guint i = 0; i < rounds; i++)
+		g_free (filter (text));
+
+	seconds = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	return (gdouble) strlen (text) * rounds / seconds / (1024.0 * 1024.0);
+}
+
+static void
+test_text_filter_throughput ()
+{
+	GString* text;
+	gdouble  fast;
+	gdouble  slow;
+
+	if (!g_test_perf ())
+		return;
+
+	// a typical chat/mail body, markup, entities and line-breaks included
+	text = g_string_new (NULL);
+	for (int i = 0; i < 16; i++)
+		g_string_append (text,
+				 "<b>Joe</b> says: Tom &amp; Jerry &lt;3 "
+				 "&quot;cheese&quot;<br/>\n"
+				 "  see <a href=\"http://www.ubuntu.com/\">this</a>"
+				 " and that\r\n");
+
+	fast = filter_throughput (filter_text, text->str, 10000);
+	slow = filter_throughput (filter_text_regex, text->str, 1000);
+
+	g_test_maximized_result (fast,
+				 "filter_text(): %.1f MB/s, regex-chain: %.1f MB/s",
+				 fast,
+				 slow);
+
+	g_string_free (text, TRUE);
+}
+
 static void
 test_extract_font_face ()
 {
@@ -133,6 +349,8 @@ test_filtering_create_test_suite (void)
 #define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
 
 	g_test_suite_add(ts, TC(test_text_filter));
+	g_test_suite_add(ts, TC(test_text_filter_differential));
+	g_test_suite_add(ts, TC(test_text_filter_throughput));
 	g_test_suite_add(ts, TC(test_newline_to_space));
 	g_test_suite_add(ts, TC(test_extract_font_face));
 
@@ -0,0 +1,207 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-timer-wheel.c - unit-tests for the shared timer-wheel
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+#include <glib.h>
+
+#include "timer-wheel.h"
+
+#define MSEC G_GINT64_CONSTANT (1000)
+
+typedef struct _Record
+{
+	GString* order;
+	guint    remove; // timer-id to remove from within the callback
+	gint     repeat; // times to return TRUE
+} Record;
+
+static Record* g_record = NULL;
+
+static gboolean
+fire_cb (gpointer data)
+{
+	g_string_append (g_record->order, (const gchar*) data);
+
+	if (g_record->remove)
+	{
+		g_assert (timer_wheel_remove (g_record->remove));
+		g_record->remove = 0;
+	}
+
+	if (g_record->repeat > 0)
+	{
+		g_record->repeat--;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+record_init (Record* record)
+{
+	record->order  = g_string_new ("");
+	record->remove = 0;
+	record->repeat = 0;
+	g_record       = record;
+
+	// leftovers of other tests would fire once the clock is advanced
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 0);
+}
+
+static void
+record_free (Record* record)
+{
+	g_string_free (record->order, TRUE);
+	g_record = NULL;
+}
+
+static void
+test_timer_wheel_order ()
+{
+	Record record;
+	gint64 now;
+
+	record_init (&record);
+	now = g_get_monotonic_time ();
+
+	// one per level: 640 ms, 41 s and 43 min are the level-boundaries
+	timer_wheel_add (2700000, fire_cb, "d");
+	timer_wheel_add (70000, fire_cb, "c");
+	timer_wheel_add (1000, fire_cb, "b");
+	timer_wheel_add (50, fire_cb, "a");
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 4);
+
+	timer_wheel_advance (now + 30 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "");
+
+	// never early, at most a tick late
+	timer_wheel_advance (now + 80 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "a");
+
+	timer_wheel_advance (now + 980 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "a");
+	timer_wheel_advance (now + 1030 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "ab");
+
+	// these have to cascade down level by level
+	timer_wheel_advance (now + 69980 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "ab");
+	timer_wheel_advance (now + 70030 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "abc");
+
+	timer_wheel_advance (now + 2699980 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "abc");
+	timer_wheel_advance (now + 2700030 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "abcd");
+
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 0);
+	record_free (&record);
+}
+
+static void
+test_timer_wheel_remove_and_move ()
+{
+	Record record;
+	gint64 now;
+	guint  a;
+	guint  b;
+	guint  c;
+
+	record_init (&record);
+	now = g_get_monotonic_time ();
+
+	a = timer_wheel_add (100, fire_cb, "a");
+	b = timer_wheel_add (200, fire_cb, "b");
+	c = timer_wheel_add (300, fire_cb, "c");
+
+	g_assert (timer_wheel_remove (b));
+	g_assert (!timer_wheel_remove (b));
+	g_assert_cmpint (timer_wheel_get_remaining (b), ==, -1);
+
+	// a now comes after c
+	g_assert (timer_wheel_reschedule (a, 5000));
+	g_assert_cmpint (timer_wheel_get_remaining (a), >, 4900);
+	g_assert (timer_wheel_extend (c, 1000));
+	g_assert_cmpint (timer_wheel_get_remaining (c), >, 1200);
+
+	timer_wheel_advance (now + 1000 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "");
+	timer_wheel_advance (now + 1350 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "c");
+	g_assert (!timer_wheel_reschedule (c, 100));
+
+	timer_wheel_advance (now + 5050 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "ca");
+
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 0);
+	record_free (&record);
+}
+
+static void
+test_timer_wheel_callbacks ()
+{
+	Record record;
+	gint64 now;
+	guint  b;
+
+	record_init (&record);
+	now = g_get_monotonic_time ();
+
+	// a repeats twice and removes b, due in the same tick, the first time
+	timer_wheel_add (100, fire_cb, "a");
+	b = timer_wheel_add (100, fire_cb, "b");
+	record.remove = b;
+	record.repeat = 2;
+
+	timer_wheel_advance (now + 150 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "a");
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 1);
+
+	timer_wheel_advance (now + 300 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "aa");
+	timer_wheel_advance (now + 450 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "aaa");
+
+	timer_wheel_advance (now + 600 * MSEC);
+	g_assert_cmpstr (record.order->str, ==, "aaa");
+
+	g_assert_cmpuint (timer_wheel_get_pending (), ==, 0);
+	record_free (&record);
+}
+
+GTestSuite *
+test_timer_wheel_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("timer-wheel");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_timer_wheel_order));
+	g_test_suite_add(ts, TC(test_timer_wheel_remove_and_move));
+	g_test_suite_add(ts, TC(test_timer_wheel_callbacks));
+
+	return ts;
+}
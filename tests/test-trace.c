@@ -0,0 +1,115 @@
+/*******************************************************************************
+**3456789 123456789 123456789 123456789 123456789 123456789 123456789 123456789
+**      10        20        30        40        50        60        70        80
+**
+** notify-osd
+**
+** test-trace.c - unit-tests for the trace-event ring
+**
+** Copyright 2009 Canonical Ltd.
+**
+** This program is free software: you can redistribute it and/or modify it
+** under the terms of the GNU General Public License version 3, as published
+** by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranties of
+** MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+** PURPOSE.  See the GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License along
+** with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+*******************************************************************************/
+
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "trace.h"
+
+static guint
+count_events (const gchar* json,
+	      const gchar* name)
+{
+	gchar*       needle = g_strdup_printf ("\"name\":\"%s\"", name);
+	const gchar* p      = json;
+	guint        count  = 0;
+
+	while ((p = strstr (p, needle)))
+	{
+		count++;
+		p++;
+	}
+
+	g_free (needle);
+
+	return count;
+}
+
+static void
+test_trace_events ()
+{
+	gchar* json;
+	guint  before = trace_get_count ();
+
+	trace_clear ();
+
+	trace_span (TRACE_REFRESH_TITLE, 7, g_get_monotonic_time () - 100);
+	trace_mark (TRACE_SLOT_ALLOCATE, 7);
+	trace_mark (TRACE_LAST, 7);
+
+	g_assert_cmpuint (trace_get_count (), ==, before + 2);
+
+	json = trace_to_json ();
+	g_assert (g_str_has_prefix (json, "{\"traceEvents\":["));
+	g_assert_cmpuint (count_events (json, "refresh-title"), ==, 1);
+	g_assert_cmpuint (count_events (json, "slot-allocate"), ==, 1);
+	g_assert (strstr (json, "\"ph\":\"X\""));
+	g_assert (strstr (json, "\"ph\":\"i\""));
+	g_assert (strstr (json, "\"args\":{\"id\":7}"));
+	g_free (json);
+
+	trace_clear ();
+	json = trace_to_json ();
+	g_assert_cmpuint (count_events (json, "refresh-title"), ==, 0);
+	g_free (json);
+}
+
+static void
+test_trace_wrap ()
+{
+	gchar* json;
+	gint   i;
+
+	trace_clear ();
+
+	// only the most recent TRACE_RING_SIZE events survive
+	trace_mark (TRACE_FADE_IN_START, 1);
+	for (i = 0; i < TRACE_RING_SIZE; i++)
+		trace_mark (TRACE_FADE_OUT_STOP, 2);
+
+	json = trace_to_json ();
+	g_assert_cmpuint (count_events (json, "fade-in-start"), ==, 0);
+	g_assert_cmpuint (count_events (json, "fade-out-stop"), ==,
+			  TRACE_RING_SIZE);
+	g_free (json);
+
+	trace_clear ();
+}
+
+GTestSuite *
+test_trace_create_test_suite (void)
+{
+	GTestSuite *ts = NULL;
+
+	ts = g_test_create_suite ("trace");
+
+#define TC(x) g_test_create_case(#x, 0, NULL, NULL, x, NULL)
+
+	g_test_suite_add(ts, TC(test_trace_events));
+	g_test_suite_add(ts, TC(test_trace_wrap));
+
+	return ts;
+}